@@ -0,0 +1,265 @@
+/**
+ * @file bench.hpp
+ * @author agent
+ * @brief inputs and programs shared by benchmarks
+ * @date 2026-10-18
+ *
+ * @details
+ *
+ * every input is generated from a fixed seed, so results are comparable between runs and commits.
+ * programs are hand written bytecode, see backend/bytecode/opcode.hpp.
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Dot product lowered by ArrayKernel.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <bit>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "defs.hpp"
+#include "backend/bytecode/kernel.hpp"
+#include "backend/bytecode/verifier.hpp"
+#include "runtime/interpreter.hpp"
+
+namespace rulejit::bench {
+
+constexpr u64 kSeed = 0x5eed;
+
+/**
+ * @brief source text of about n bytes, mixes identifiers, numbers, operators, strings and comments
+ *
+ */
+inline std::string generateSource(usize n) {
+    static constexpr const char* kWords[] = {"func", "var", "return", "if", "else", "while", "struct", "impl",
+                                             "trait", "value", "count", "result", "index", "node", "left", "right"};
+    static constexpr const char* kSymbols[] = {"+", "-", "*", "/", "==", ">=", "<=", "=", "->", "(", ")",
+                                               "{", "}", ",", ".", ":"};
+    std::mt19937_64 rng{kSeed};
+    std::string s;
+    s.reserve(n + 64);
+    while (s.size() < n) {
+        switch (rng() % 8) {
+        case 0: case 1: case 2:
+            s += kWords[rng() % std::size(kWords)];
+            s += std::to_string(rng() % 100);
+            break;
+        case 3:
+            s += std::to_string(rng() % 100000);
+            break;
+        case 4:
+            s += std::to_string(rng() % 1000) + "." + std::to_string(rng() % 1000) + "e" + std::to_string(rng() % 10);
+            break;
+        case 5:
+            s += kSymbols[rng() % std::size(kSymbols)];
+            break;
+        case 6:
+            s += "\"text " + std::to_string(rng() % 1000) + "\"";
+            break;
+        case 7:
+            s += rng() % 4 == 0 ? "// comment\n" : ";\n";
+            break;
+        }
+        s += ' ';
+    }
+    return s;
+}
+
+/**
+ * @brief VM with one thread
+ *
+ */
+struct Machine {
+    using Section = CodeManager::Section;
+
+    VM vm{};
+    CodeManager cm;
+    Interpreter in{&vm.ctx, &vm.globalMemory};
+    ThreadVM& t = vm.threads.emplace_back();
+
+    Machine() { vm.ctx.cm = &cm; }
+    Machine(const Machine&) = delete;
+    auto& operator=(const Machine&) = delete;
+
+    const Section* load(Section&& s) {
+        auto r = in.load(std::move(s));
+        if (!r) {
+            std::fprintf(stderr, "bad benchmark program at %zu: %s\n", r.error().ip, r.error().reason);
+            std::abort();
+        }
+        return *r;
+    }
+
+    // f(args...) -> u64
+    template <typename... Args>
+    u64 run(const Section* f, Args... args) {
+        reg argv[sizeof...(Args)]{std::bit_cast<reg>(args)...};
+        reg ret{};
+        if (in.execute(t, f, argv, {&ret, 1}) != ExecResult::kReturned) {
+            std::fprintf(stderr, "benchmark program failed\n");
+            std::abort();
+        }
+        return ret.as<u64>();
+    }
+};
+
+using I = Instruction;
+using O = OPCode;
+
+inline reg u64Reg(u64 v) {
+    return std::bit_cast<reg>(v);
+}
+
+/**
+ * @brief fib(n) -> u64, recursive, call bound
+ *
+ */
+inline const CodeManager::Section* makeFib(Machine& m) {
+    CodeManager::Section s;
+    s.name = "fib";
+    s.info = {0, 8, 1, 1, {}};
+    s.constant = {u64Reg(2), u64Reg(1), reg{}};
+    s.code = {
+        I::makeABo(O::LOADc, 2, 0),   I::makeABC(O::Lu, 3, 0, 2),   I::makeABi(O::BEZ, 3, 1),
+        I::makeABo(O::RET, 0, 1),     I::makeABo(O::LOADc, 2, 1),   I::makeABo(O::LOADc, 3, 2),
+        I::makeABC(O::SUBu, 4, 0, 2), I::makeABC(O::CALLf, 3, 1, 1), I::makeABC(O::MOV, 1, 5, 0),
+        I::makeABC(O::SUBu, 4, 4, 2), I::makeABC(O::CALLf, 3, 1, 1), I::makeABC(O::ADDu, 1, 1, 5),
+        I::makeABo(O::RET, 1, 1),
+    };
+    // refers to itself, so patch after it has an address
+    auto* p = m.cm.add(std::move(s));
+    p->constant.set(2, std::bit_cast<reg>(static_cast<const CodeManager::Section*>(p)));
+    p->addressSlots.push_back({CodeManager::Section::AddressSlot::Kind::kFunction, false, 2});
+    m.cm.seal(p);
+    if (!Verifier::verify(*p)) {
+        std::abort();
+    }
+    return p;
+}
+
+/**
+ * @brief sum(n) = n + ... + 1, dispatch bound
+ *
+ */
+inline const CodeManager::Section* makeSum(Machine& m) {
+    CodeManager::Section s;
+    s.name = "sum";
+    s.info = {0, 5, 1, 1, {}};
+    s.constant = {u64Reg(0), u64Reg(1)};
+    s.code = {
+        I::makeABo(O::LOADc, 2, 0),   I::makeABo(O::LOADc, 3, 1),   I::makeABC(O::MOV, 4, 0, 0),
+        I::makeABi(O::BEZ, 4, 3),     I::makeABC(O::ADDu, 2, 2, 4), I::makeABC(O::SUBu, 4, 4, 3),
+        I::makeAi(O::BR, -4),         I::makeABo(O::RET, 2, 1),
+    };
+    return m.load(std::move(s));
+}
+
+/**
+ * @brief sieve(buf, n) -> count of primes below n, buf is reg[n]. dispatch and memory bound
+ *
+ */
+inline const CodeManager::Section* makeSieve(Machine& m) {
+    CodeManager::Section s;
+    s.name = "sieve";
+    s.info = {0, 10, 2, 1, {}};
+    s.info.pointerReg.set(0);
+    s.constant = {u64Reg(0), u64Reg(1), u64Reg(2)};
+    s.code = {
+        // R3 = 0, R4 = 1, clear buf by R5
+        I::makeABo(O::LOADc, 3, 0), I::makeABo(O::LOADc, 4, 1), I::makeABC(O::MOV, 5, 3, 0),
+        I::makeABC(O::Lu, 6, 5, 1), I::makeABi(O::BEZ, 6, 3), I::makeABC(O::STORErr, 0, 3, 5),
+        I::makeABC(O::ADDu, 5, 5, 4), I::makeAi(O::BR, -5),
+        // R7 = i, R2 = count
+        I::makeABo(O::LOADc, 7, 2), I::makeABC(O::MOV, 2, 3, 0),
+        I::makeABC(O::Lu, 6, 7, 1), I::makeABi(O::BEZ, 6, 11), I::makeABC(O::LOADrr, 8, 0, 7),
+        I::makeABi(O::BNZ, 8, 7), I::makeABC(O::ADDu, 2, 2, 4), I::makeABC(O::MULu, 9, 7, 7),
+        // mark multiples by R9
+        I::makeABC(O::Lu, 6, 9, 1), I::makeABi(O::BEZ, 6, 3), I::makeABC(O::STORErr, 0, 4, 9),
+        I::makeABC(O::ADDu, 9, 9, 7), I::makeAi(O::BR, -5),
+        I::makeABC(O::ADDu, 7, 7, 4), I::makeAi(O::BR, -13),
+        I::makeABo(O::RET, 2, 1),
+    };
+    return m.load(std::move(s));
+}
+
+/**
+ * @brief get(self) -> [self + 0], method of trait object
+ *
+ */
+inline const CodeManager::Section* makeGetter(Machine& m) {
+    CodeManager::Section s;
+    s.name = "get";
+    s.info = {0, 2, 1, 1, {}};
+    s.info.pointerReg.set(0);
+    s.code = {I::makeABC(O::LOADao, 1, 0, 0), I::makeABo(O::RET, 1, 1)};
+    return m.load(std::move(s));
+}
+
+/**
+ * @brief dispatch(vt0, vt1, obj, n) -> sum of {i & 1 ? vt1 : vt0, obj}.get() for i in [n, 1].
+ * monomorphic if vt0 == vt1
+ *
+ */
+inline const CodeManager::Section* makeDispatch(Machine& m) {
+    CodeManager::Section s;
+    s.name = "dispatch";
+    s.info = {0, 12, 4, 1, {}};
+    s.info.pointerReg.set(2);
+    s.info.pointerReg.set(10);
+    s.constant = {u64Reg(0), u64Reg(1)};
+    s.traitCallSites = {{0, 0, 1, 0}};
+    s.code = {
+        I::makeABo(O::LOADc, 5, 0),    I::makeABo(O::LOADc, 6, 1),   I::makeABC(O::MOV, 7, 3, 0),
+        I::makeABi(O::BEZ, 7, 8),      I::makeABC(O::AND, 8, 7, 6),  I::makeABC(O::MOV, 9, 0, 0),
+        I::makeABC(O::CMOV, 9, 1, 8),  I::makeABC(O::MOV, 10, 2, 0), I::makeABo(O::CALLv, 9, 0),
+        I::makeABC(O::ADDu, 5, 5, 11), I::makeABC(O::SUBu, 7, 7, 6), I::makeAi(O::BR, -9),
+        I::makeABo(O::RET, 5, 1),
+    };
+    return m.load(std::move(s));
+}
+
+/**
+ * @brief dot(lhs, rhs) -> f64 bits, lhs / rhs are f64[n] without header. vector bound below 256 elements
+ *
+ */
+inline const CodeManager::Section* makeDot(Machine& m, usize n) {
+    CodeManager::Section s;
+    s.name = "dot";
+    s.info = {0, 3 + ArrayKernel::kDotScratch, 2, 1, {}};
+    s.info.pointerReg.set(0);
+    s.info.pointerReg.set(1);
+    if (!ArrayKernel::emitDot(s, 2, 0, 1, 0, ArrayType{{n}, TypeToken{TypeManager::kF64}}, 3)) {
+        std::abort();
+    }
+    s.code.push_back(I::makeABo(O::RET, 2, 1));
+    return m.load(std::move(s));
+}
+
+/**
+ * @brief callN(n) -> fn(...fn(0)), fn is function value of (u64) -> u64
+ *
+ */
+inline const CodeManager::Section* makeCallLoop(Machine& m, const CodeManager::Section* fn) {
+    CodeManager::Section s;
+    s.name = "callLoop";
+    s.info = {0, 8, 1, 1, {}};
+    s.constant = {u64Reg(0), u64Reg(1), std::bit_cast<reg>(fn)};
+    s.code = {
+        I::makeABo(O::LOADc, 2, 0),   I::makeABo(O::LOADc, 3, 1),   I::makeABC(O::MOV, 4, 0, 0),
+        I::makeABi(O::BEZ, 4, 6),     I::makeABo(O::LOADc, 5, 2),   I::makeABC(O::MOV, 6, 2, 0),
+        I::makeABC(O::CALLf, 5, 1, 1), I::makeABC(O::MOV, 2, 7, 0), I::makeABC(O::SUBu, 4, 4, 3),
+        I::makeAi(O::BR, -7),         I::makeABo(O::RET, 2, 1),
+    };
+    return m.load(std::move(s));
+}
+
+}
@@ -0,0 +1,108 @@
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "bench.hpp"
+#include "runtime/ffi.hpp"
+#include "runtime/vtable.hpp"
+
+using namespace rulejit;
+
+// call bound
+static void BM_Fib(benchmark::State& state) {
+    bench::Machine m;
+    auto* fib = bench::makeFib(m);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m.run(fib, u64(state.range(0))));
+    }
+}
+BENCHMARK(BM_Fib)->DenseRange(15, 25, 5);
+
+// dispatch bound, 4 instructions per iteration
+static void BM_SumLoop(benchmark::State& state) {
+    bench::Machine m;
+    auto* sum = bench::makeSum(m);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m.run(sum, u64(state.range(0))));
+    }
+    state.SetItemsProcessed(i64(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_SumLoop)->Range(1 << 10, 1 << 20);
+
+static void BM_Sieve(benchmark::State& state) {
+    bench::Machine m;
+    auto* sieve = bench::makeSieve(m);
+    std::vector<reg> buf(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m.run(sieve, buf.data(), u64(buf.size())));
+    }
+    state.SetItemsProcessed(i64(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_Sieve)->Range(1 << 10, 1 << 20);
+
+// fixed-size f64 array, vector opcodes then scalar loop past 256 elements
+static void BM_Dot(benchmark::State& state) {
+    bench::Machine m;
+    usize n = usize(state.range(0));
+    auto* dot = bench::makeDot(m, n);
+    std::vector<reg> lhs(n, std::bit_cast<reg>(1.5)), rhs(n, std::bit_cast<reg>(2.0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m.run(dot, lhs.data(), rhs.data()));
+    }
+    state.SetItemsProcessed(i64(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_Dot)->Arg(64)->Arg(256)->Arg(1024);
+
+// trait method call through inline cache, state.range(0) is 1 if receiver type alternates (cache miss each call)
+static void BM_TraitCall(benchmark::State& state) {
+    bench::Machine m;
+    auto* get = bench::makeGetter(m);
+    auto* dispatch = bench::makeDispatch(m);
+    VTable tables[2]{{1, 0, 1, std::make_unique<reg[]>(1)}, {2, 0, 1, std::make_unique<reg[]>(1)}};
+    for (auto& vt : tables) {
+        vt.slots[0] = std::bit_cast<reg>(get);
+    }
+    const VTable* vt1 = state.range(0) ? &tables[1] : &tables[0];
+    reg obj = bench::u64Reg(7);
+    constexpr u64 kCalls = 1 << 16;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m.run(dispatch, &tables[0], vt1, &obj, kCalls));
+    }
+    state.SetItemsProcessed(i64(state.iterations() * kCalls));
+}
+BENCHMARK(BM_TraitCall)->Arg(0)->Arg(1);
+
+static u64 increase(u64 v) noexcept {
+    return v + 1;
+}
+
+// extern function bound by ExternRegistry, called through CALLf
+static void BM_ExternCall(benchmark::State& state) {
+    bench::Machine m;
+    ExternRegistry externs{&m.cm};
+    auto* loop = bench::makeCallLoop(m, externs.def<&increase>("increase"));
+    constexpr u64 kCalls = 1 << 16;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m.run(loop, kCalls));
+    }
+    state.SetItemsProcessed(i64(state.iterations() * kCalls));
+}
+BENCHMARK(BM_ExternCall);
+
+// the same loop calling a bytecode function, as baseline of BM_ExternCall
+static void BM_BytecodeCall(benchmark::State& state) {
+    bench::Machine m;
+    CodeManager::Section inc;
+    inc.info = {0, 3, 1, 1, {}};
+    inc.constant = {bench::u64Reg(1)};
+    inc.code = {bench::I::makeABo(bench::O::LOADc, 2, 0), bench::I::makeABC(bench::O::ADDu, 1, 0, 2),
+                bench::I::makeABo(bench::O::RET, 1, 1)};
+    auto* loop = bench::makeCallLoop(m, m.load(std::move(inc)));
+    constexpr u64 kCalls = 1 << 16;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m.run(loop, kCalls));
+    }
+    state.SetItemsProcessed(i64(state.iterations() * kCalls));
+}
+BENCHMARK(BM_BytecodeCall);
@@ -0,0 +1,24 @@
+#include <benchmark/benchmark.h>
+
+#include "bench.hpp"
+#include "frontend/lexer/lexer.hpp"
+
+using namespace rulejit;
+
+// tokenize generated source of state.range(0) bytes
+static void BM_LexerGenerated(benchmark::State& state) {
+    std::string src = bench::generateSource(state.range(0));
+    usize tokens = 0;
+    for (auto _ : state) {
+        LexerContext ctx{src};
+        auto it = ctx.first();
+        while (it.type != LexerContext::TokenType::kEOF && it.type != LexerContext::TokenType::kUnknown) {
+            it = ctx.next(it.iter);
+            ++tokens;
+        }
+        benchmark::DoNotOptimize(it);
+    }
+    state.SetBytesProcessed(i64(state.iterations()) * i64(src.size()));
+    state.counters["tokens"] = benchmark::Counter(double(tokens), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_LexerGenerated)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
@@ -0,0 +1,122 @@
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "bench.hpp"
+#include "ir/type.hpp"
+#include "runtime/gc/mem.hpp"
+#include "tools/string_pool.hpp"
+
+using namespace rulejit;
+
+namespace {
+
+// boxed i64, one of base types made by TypeManager
+constexpr u32 kBoxedI64 = TypeManager::kI64;
+
+struct Heap {
+    tools::StringPool sp;
+    TypeManager tm{&sp};
+    Memory mem{&tm};
+    // (next, value), list node
+    TypeToken node = tm.tupleTypeOf({TypeToken{TypeManager::kAny}, TypeToken{TypeManager::kI64}});
+
+    void collect() {
+        while (!mem.singleThreadGcStep()) {
+        }
+    }
+};
+
+}
+
+// state.range(0) objects die young, minor GC has nothing to copy
+static void BM_MinorChurn(benchmark::State& state) {
+    Heap h;
+    for (auto _ : state) {
+        for (i64 i = 0; i < state.range(0); ++i) {
+            reg* p = h.mem.allocHeap(TypeToken{kBoxedI64});
+            p[0].as<u64>() = u64(i);
+            benchmark::DoNotOptimize(p);
+        }
+        h.collect();
+    }
+    state.SetItemsProcessed(i64(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_MinorChurn)->Range(1 << 10, 1 << 18);
+
+// one in 8 objects is kept by root, survivors are promoted to old generation, which grows to state.range(0) / 8
+static void BM_OldRetention(benchmark::State& state) {
+    Heap h;
+    std::vector<reg*> kept(state.range(0) / 8, nullptr);
+    for (auto& p : kept) {
+        h.mem.registerGcRoot(&p);
+    }
+    for (auto _ : state) {
+        for (i64 i = 0; i < state.range(0); ++i) {
+            reg* p = h.mem.allocHeap(TypeToken{kBoxedI64});
+            p[0].as<u64>() = u64(i);
+            if (i % 8 == 0) {
+                kept[i / 8] = p;
+            }
+        }
+        h.collect();
+    }
+    state.SetItemsProcessed(i64(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_OldRetention)->Range(1 << 12, 1 << 18);
+
+// pause of minor GC copying state.range(0) live objects on state.range(1) GC threads
+static void BM_MinorPause(benchmark::State& state) {
+    Heap h;
+    h.mem.setGcWorkers(usize(state.range(1)));
+    std::vector<reg*> kept(state.range(0), nullptr);
+    for (auto& p : kept) {
+        h.mem.registerGcRoot(&p);
+        p = h.mem.allocHeap(TypeToken{kBoxedI64});
+    }
+    for (auto _ : state) {
+        h.mem.collectMinor();
+    }
+    state.SetItemsProcessed(i64(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_MinorPause)->ArgsProduct({{1 << 14, 1 << 18}, {1, 2, 4}})->UseRealTime();
+
+// pause of full major GC over linked list of 4 * state.range(0) promoted nodes, 3 in 4 of them garbage,
+// state.range(1) enables compaction of sparse pages after sweeping
+static void BM_MajorCollect(benchmark::State& state) {
+    Heap h;
+    h.mem.setCompaction(state.range(1) != 0);
+    reg* head = nullptr;
+    h.mem.registerGcRoot(&head);
+    for (auto _ : state) {
+        state.PauseTiming();
+        head = nullptr;
+        for (i64 i = 0; i < 4 * state.range(0); ++i) {
+            reg* p = h.mem.allocHeap(h.node);
+            h.mem.writeWithBarrier(&p[0].as<reg*>(), head);
+            p[1].as<u64>() = u64(i);
+            head = p;
+        }
+        // promoted after surviving 5 minor GCs
+        for (int k = 0; k < 7; ++k) {
+            h.mem.collectMinor();
+        }
+        // keep one in 4 nodes, pages become sparse after sweeping
+        for (reg* p = head; p != nullptr; p = p[0].as<reg*>()) {
+            reg* next = p[0].as<reg*>();
+            for (int k = 0; k < 3 && next != nullptr; ++k) {
+                next = next[0].as<reg*>();
+            }
+            h.mem.writeWithBarrier(&p[0].as<reg*>(), next);
+        }
+        // sweeping counts live objects of pages, sparse ones are picked by next major GC
+        h.mem.collectMajor();
+        state.ResumeTiming();
+        h.mem.collectMajor();
+        while (!h.mem.compactStep()) {
+        }
+    }
+    state.counters["major_bytes"] = double(h.mem.majorHeapBytes());
+    state.SetItemsProcessed(i64(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_MajorCollect)->ArgsProduct({{1 << 12, 1 << 16}, {0, 1}})->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,45 @@
+#include <random>
+
+#include <benchmark/benchmark.h>
+
+#include "bench.hpp"
+#include "ir/type.hpp"
+#include "tools/string_pool.hpp"
+
+using namespace rulejit;
+
+// intern state.range(0) distinct names, each taken 8 times
+static void BM_StringIntern(benchmark::State& state) {
+    std::vector<std::string> names;
+    std::mt19937_64 rng{bench::kSeed};
+    for (i64 i = 0; i < state.range(0); ++i) {
+        names.push_back("name_" + std::to_string(rng()));
+    }
+    for (auto _ : state) {
+        tools::StringPool sp;
+        for (int round = 0; round < 8; ++round) {
+            for (auto& n : names) {
+                benchmark::DoNotOptimize(sp.take(std::string_view{n}));
+            }
+        }
+    }
+    state.SetItemsProcessed(i64(state.iterations()) * state.range(0) * 8);
+}
+BENCHMARK(BM_StringIntern)->Range(1 << 8, 1 << 16);
+
+// array types of base types nested up to state.range(0) levels, all but the first lookup hit cache
+static void BM_ArrayTypeIntern(benchmark::State& state) {
+    tools::StringPool sp;
+    TypeManager tm{&sp};
+    for (auto _ : state) {
+        for (u32 base = 1; base <= 5; ++base) {
+            TypeToken t{base};
+            for (i64 depth = 0; depth < state.range(0); ++depth) {
+                t = tm.arrayTypeOf(t);
+            }
+            benchmark::DoNotOptimize(t);
+        }
+    }
+    state.SetItemsProcessed(i64(state.iterations()) * state.range(0) * 5);
+}
+BENCHMARK(BM_ArrayTypeIntern)->Range(1, 64);
@@ -0,0 +1,203 @@
+/**
+ * @file kernel.hpp
+ * @author agent
+ * @brief lower operations over fixed-size numeric arrays to vector opcodes
+ * @date 2026-10-18
+ *
+ * @details
+ *
+ * static list is laid out like struct (see memory model in opcode.hpp), so element i of f64[N] is at
+ * [R[ptr] + first + i]. elements reachable by 8-bit OFFSET (first + i < 256) are fully unrolled: kVectorLanes
+ * elements per vector opcode, and the rest by scalar opcode. elements after them are handled by a scalar loop
+ * indexed by register (LOADrr / STORErr), its bounds are appended to CONST of the section.
+ * only arrays of f64 with static size are lowered, emitters return false for others and emit nothing.
+ *
+ * all emitters use a block of scratch registers, which should not overlap with other registers passed in.
+ * there is no codegen from IR yet, emitters are called by code building sections by hand (see bench/bench.hpp).
+ *
+ * NOTE: dot product sums lanes separately, so result may differ from sequential sum in the last bits.
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Check element type, loop over elements out of OFFSET range.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <algorithm>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "defs.hpp"
+#include "backend/bytecode/opcode.hpp"
+#include "ir/type.hpp"
+#include "runtime/vm.hpp"
+
+namespace rulejit {
+
+struct ArrayKernel {
+    using Section = CodeManager::Section;
+
+    // scratch registers used by emitDot()
+    static constexpr u32 kDotScratch = 3 * kVectorLanes;
+    // scratch registers used by emitElementwise()
+    static constexpr u32 kElementwiseScratch = 2 * kVectorLanes;
+
+    /**
+     * @brief element count of array with static size
+     *
+     * @return std::optional<usize> nullopt if dynamic
+     */
+    static std::optional<usize> fixedLength(const ArrayType& t) {
+        if (t.size.empty()) {
+            return std::nullopt;
+        }
+        usize n = 1;
+        for (auto s : t.size) {
+            n *= s;
+        }
+        return n;
+    }
+
+    /**
+     * @brief R[dst] = sum of lhs[i] * rhs[i], lhs / rhs are pointer registers to array of type t
+     *
+     * @return false if t is not f64 array of static size, or is empty
+     */
+    static bool emitDot(Section& s, u8 dst, u8 lhs, u8 rhs, u8 first, const ArrayType& t, u8 scratch) {
+        auto len = f64Length(t);
+        if (!len || *len == 0 || scratch + kDotScratch > 256 || !canLoop(s, first, *len)) {
+            return false;
+        }
+        usize n = *len;
+        auto& code = s.code;
+        u8 acc = scratch, x = scratch + kVectorLanes, y = scratch + 2 * kVectorLanes;
+        auto at = [&](usize i) { return static_cast<u8>(first + i); };
+        usize unrolled = std::min(n, kMaxOffset - first);
+
+        usize i;
+        if (unrolled >= kVectorLanes) {
+            code.push_back(Instruction::makeABC(OPCode::VLOADao, acc, lhs, at(0)));
+            code.push_back(Instruction::makeABC(OPCode::VLOADao, y, rhs, at(0)));
+            code.push_back(Instruction::makeABC(OPCode::VMULf, acc, acc, y));
+            for (i = kVectorLanes; i + kVectorLanes <= unrolled; i += kVectorLanes) {
+                code.push_back(Instruction::makeABC(OPCode::VLOADao, x, lhs, at(i)));
+                code.push_back(Instruction::makeABC(OPCode::VLOADao, y, rhs, at(i)));
+                code.push_back(Instruction::makeABC(OPCode::VFMAf, acc, x, y));
+            }
+            code.push_back(Instruction::makeABC(OPCode::VHADDf, dst, acc, 0));
+        } else {
+            code.push_back(Instruction::makeABC(OPCode::LOADao, dst, lhs, at(0)));
+            code.push_back(Instruction::makeABC(OPCode::LOADao, y, rhs, at(0)));
+            code.push_back(Instruction::makeABC(OPCode::MULf, dst, dst, y));
+            i = 1;
+        }
+        for (; i < unrolled; ++i) {
+            code.push_back(Instruction::makeABC(OPCode::LOADao, x, lhs, at(i)));
+            code.push_back(Instruction::makeABC(OPCode::LOADao, y, rhs, at(i)));
+            code.push_back(Instruction::makeABC(OPCode::MULf, x, x, y));
+            code.push_back(Instruction::makeABC(OPCode::ADDf, dst, dst, x));
+        }
+        emitLoop(s, first + unrolled, first + n, x + 1, y + 1, [&](u8 index) {
+            code.push_back(Instruction::makeABC(OPCode::LOADrr, x, lhs, index));
+            code.push_back(Instruction::makeABC(OPCode::LOADrr, y, rhs, index));
+            code.push_back(Instruction::makeABC(OPCode::MULf, x, x, y));
+            code.push_back(Instruction::makeABC(OPCode::ADDf, dst, dst, x));
+        });
+        return true;
+    }
+
+    /**
+     * @brief dst[i] = lhs[i] op rhs[i], dst / lhs / rhs are pointer registers to array of type t
+     *
+     * @param op one of VADDf, VSUBf, VMULf, VDIVf
+     * @return false if op is not supported, or t is not f64 array of static size
+     */
+    static bool emitElementwise(Section& s, OPCode op, u8 dst, u8 lhs, u8 rhs, u8 first, const ArrayType& t,
+                                u8 scratch) {
+        OPCode scalar;
+        switch (op) {
+        case OPCode::VADDf: scalar = OPCode::ADDf; break;
+        case OPCode::VSUBf: scalar = OPCode::SUBf; break;
+        case OPCode::VMULf: scalar = OPCode::MULf; break;
+        case OPCode::VDIVf: scalar = OPCode::DIVf; break;
+        default: return false;
+        }
+        auto len = f64Length(t);
+        if (!len || scratch + kElementwiseScratch > 256 || !canLoop(s, first, *len)) {
+            return false;
+        }
+        usize n = *len;
+        auto& code = s.code;
+        u8 x = scratch, y = scratch + kVectorLanes;
+        auto at = [&](usize i) { return static_cast<u8>(first + i); };
+        usize unrolled = std::min(n, kMaxOffset - first);
+
+        usize i = 0;
+        for (; i + kVectorLanes <= unrolled; i += kVectorLanes) {
+            code.push_back(Instruction::makeABC(OPCode::VLOADao, x, lhs, at(i)));
+            code.push_back(Instruction::makeABC(OPCode::VLOADao, y, rhs, at(i)));
+            code.push_back(Instruction::makeABC(op, x, x, y));
+            code.push_back(Instruction::makeABC(OPCode::VSTOREao, dst, x, at(i)));
+        }
+        for (; i < unrolled; ++i) {
+            code.push_back(Instruction::makeABC(OPCode::LOADao, x, lhs, at(i)));
+            code.push_back(Instruction::makeABC(OPCode::LOADao, y, rhs, at(i)));
+            code.push_back(Instruction::makeABC(scalar, x, x, y));
+            code.push_back(Instruction::makeABC(OPCode::STOREao, dst, x, at(i)));
+        }
+        emitLoop(s, first + unrolled, first + n, x + 1, y + 1, [&](u8 index) {
+            code.push_back(Instruction::makeABC(OPCode::LOADrr, x, lhs, index));
+            code.push_back(Instruction::makeABC(OPCode::LOADrr, y, rhs, index));
+            code.push_back(Instruction::makeABC(scalar, x, x, y));
+            code.push_back(Instruction::makeABC(OPCode::STORErr, dst, x, index));
+        });
+        return true;
+    }
+
+  private:
+    // elements before it are reachable by OFFSET
+    static constexpr usize kMaxOffset = 256;
+    // CONST slots appended by emitLoop()
+    static constexpr usize kLoopConstants = 3;
+
+    static std::optional<usize> f64Length(const ArrayType& t) {
+        if (t.elementType != TypeManager::kF64) {
+            return std::nullopt;
+        }
+        return fixedLength(t);
+    }
+
+    // bounds of loop fit in CONST of s, LOADc takes 16-bit OFFSET
+    static bool canLoop(const Section& s, u8 first, usize n) {
+        return first + n <= kMaxOffset || s.constant.size() + kLoopConstants <= (1 << 16);
+    }
+
+    /**
+     * @brief for (R[counter] = begin; R[counter] < end; ++R[counter]) body(counter), nothing if begin == end
+     *
+     * @param counter R[counter..counter+2] hold index, end and 1
+     */
+    template <typename Body>
+    static void emitLoop(Section& s, usize begin, usize end, u8 counter, u8 cond, Body&& body) {
+        if (begin >= end) {
+            return;
+        }
+        auto& code = s.code;
+        u8 index = counter, last = counter + 1, one = counter + 2;
+        for (auto [r, v] : {std::pair<u8, u64>{index, begin}, {last, end}, {one, 1}}) {
+            usize slot = s.constant.append(std::bit_cast<reg>(v));
+            code.push_back(Instruction::makeABo(OPCode::LOADc, r, static_cast<u16>(slot)));
+        }
+        usize head = code.size();
+        body(index);
+        code.push_back(Instruction::makeABC(OPCode::ADDu, index, index, one));
+        code.push_back(Instruction::makeABC(OPCode::Lu, cond, index, last));
+        code.push_back(Instruction::makeABi(OPCode::BNZ, cond, static_cast<i16>(i64(head) - i64(code.size() + 1))));
+    }
+};
+
+}
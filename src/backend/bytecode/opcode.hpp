@@ -10,10 +10,19 @@
  * <table>
  * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
  * <tr><td>nanaglutamate</td><td>2024-11-14</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Add CALLv for trait method call.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Add Instruction encoding, return count of CALLc / CALLf and LOADcp.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Add packed f64 vector opcodes.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Refer to AUTO stack implementation.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Replace TRAP with exception table of Section.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Add TAGi / UNTAG / TAGOF for immediates of dynamic and any.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Typed boxes, lazy STATIC init, INSTAN* reserved.</td></tr>
  * </table>
  */
 #pragma once
 
+#include "defs.hpp"
+
 /**
  * memory model:
  * 
@@ -30,7 +39,7 @@
  *                     ^^^^^ function args
  *                          ^^^ returned values
  * 
- * layout on 'auto' stack (object on 'auto' stack never moves):
+ * layout on 'auto' stack (object on 'auto' stack never moves, see runtime/auto_stack.hpp):
  *   chunk 1: |[  frame1     ][  frame2 ][  frame3  ] --unused-- |
  *   chunk 2: |[  frame4 ][  frame5           ]                  |
  *                                             ^ HEAD
@@ -41,11 +50,14 @@
  *   3. function are stored as struct contains function pointer
  *      while closure are stored as struct contains function pointer and capture pointer
  *   4. trait object are stored as struct contains function table pointer (with type indentifier) and data pointer (may boxed struct)
+ *      function table is a dense VTable built per (type, trait) when ImplToken is loaded, see runtime/vtable.hpp
  *   5. dynamic object are stored as class contains native map pointer, which has member
  *     a. '.' for real object (boxed if struct)
  *     b. '..' for meta-table
  *     c. '[]' for dyn[] which stores user set member by '[]'
  *     d. other user set member by '.'
+ *      small int, bool, char and None held by dynamic / any are immediates tagged in low 3 bit of pointer instead,
+ *      see helper::PtrTag in runtime/gc/mem.hpp. they are built by TAGi or loaded from CONST by LOADcp
  *   6. list object are stored like struct (0: T, 1: T, ...) (static list) 
  *      or class (len: usize, 0: T, 1: T, ...) (dynamic list) 
  *   7. sum type are stored as indexed-enum, may use illegal state to store index (such as Opt<class>(0) for None)
@@ -63,9 +75,11 @@
  * 
  * exception:
  *   1. recommand to return a Opt<T> or Except<T, E> for error (or any type impl 'Err'). throw is also supported:
- *     a. when enter try-catch block, exception trap is recorded
- *     b. when exception throws (must implies Throw), unfold the stack
- *     c. when meet exception trap, jump to target location, clear current exception trap and resume (may check exception type and re-throw it)
+ *     a. try-catch block is recorded in exception table of Section when emitted (IP range -> handler, type filter),
+ *        entering it costs nothing
+ *     b. when exception throws (must implies Throw), search exception table of each frame by binary search and
+ *        unfold the stack
+ *     c. when meet range covers throwing IP, jump to its handler and resume (may check exception type and re-throw it)
  * 
  * function load:
  *   1. when a function is load, all token it referenced is load
@@ -88,6 +102,11 @@
  *  ABi   : |  OpCode(8)    |  REG(8)       |  IMM(16)                      |
  *  Ai    : |  OpCode(8)    |  IMM(24)                                      |
  * 
+ * vector opcode (V*):
+ *   operate on kVectorLanes consecutive registers as one packed f64 vector, 'R[A..]' is R[A], ..., R[A+3].
+ *   lane mask is 1 / 0 per lane like scalar compare. fixed-size array kernels are emitted by
+ *   backend/bytecode/kernel.hpp.
+ * 
  */
 
 namespace rulejit {
@@ -113,6 +132,14 @@ enum class OPCode : uint8_t {
         // STOREa, STOREap, // attr
         // R[A] = if (R[C]) R[B] else R[A]
         CMOV, 
+        // R[A..] = R[B..] op R[C..]
+        VADDf, VSUBf, VMULf, VDIVf, 
+        // R[A..] = R[A..] + R[B..] * R[C..]
+        VFMAf, 
+        // R[A..] = lane mask of R[B..] op R[C..]
+        VGEf, VLEf, VGf, VLf, 
+        // R[A..] = if (R[C..]) R[B..] else R[A..], per lane
+        VSEL, 
         // // R[A] = *(((type*)&R[B]) + R[C]), extract member from R[B] ([unsigned] short low / high or char lowlow / ... or float)
         // EXTsr, EXTcr, 
         // EXTusr, EXTucr, 
@@ -127,10 +154,18 @@ enum class OPCode : uint8_t {
         // [R[A] + imm] = R[B]
         STOREi, STOREip, // imm diff
     // ABCo
-        // R[A] = new(AUTO[OFFSET]) type(R[B])
+        // R[A] = new(AUTO[OFFSET]) box(R[B]), one reg boxed on AUTO stack without header, it never moves
         ALLOCsr, // stack register
         // throw type(R[A])(R[B], ..., R[B+OFFSET])
         THROW, 
+        // R[A] = [R[B] + OFFSET]
+        LOADao, LOADaop, 
+        // [R[A] + OFFSET] = R[B]
+        STOREao, STOREaop, 
+        // R[A..] = [R[B] + OFFSET], ..., [R[B] + OFFSET + 3]
+        VLOADao, 
+        // [R[A] + OFFSET], ..., [R[A] + OFFSET + 3] = R[B..]
+        VSTOREao, 
         // // R[A] = *(((type*)&R[B]) + OFFSET), extract member from R[B]
         // EXTs, EXTc, 
         // EXTus, EXTuc, 
@@ -141,10 +176,17 @@ enum class OPCode : uint8_t {
         // EMPf, 
     // ABiCo
     // ABoCo
-        // R[A] = STATIC[OFFSETb] if initialized, else call function related to the static object to init it.
+        // R[A] = STATIC[OFFSETb] if initialized, else call initializer of the slot to init it first
+        // (see Section::staticInits), exception thrown by initializer is thrown here
         LOADst, LOADstp, // load static
-        // R[A] = new(AUTO[OFFSETc]) type(CONST[OFFSETb])
+        // R[A] = new(AUTO[OFFSETc]) box(CONST[OFFSETb]), as ALLOCsr
         ALLOCsc, // stack const
+        // {R[A], R[A+1]}(R[A+2], ..., R[A+OFFSETb]), all arg will not modified
+        // returned values are placed at R[A+OFFSETb+1], ..., R[A+OFFSETb+OFFSETc]
+        CALLc, // call closure
+        // R[A](R[A+1], ..., R[A+OFFSETb]), all arg will not modified
+        // returned values are placed at R[A+OFFSETb+1], ..., R[A+OFFSETb+OFFSETc]
+        CALLf, // call function
     // ABr
         // R[A] = !R[B]
         NOT, 
@@ -154,40 +196,97 @@ enum class OPCode : uint8_t {
         // STORE, STOREp, 
         // R[A] = f R[B]
         DTRANSuf, DTRANSfu, DTRANSif, DTRANSfi, 
+        // R[A] = immediate of small int R[B], highest bit is dropped. int out of 63 bit should be boxed
+        TAGi, 
+        // R[A] = payload of immediate R[B], int is sign extended
+        UNTAG, 
+        // R[A] = tag of R[B], 0 if R[B] is object or null
+        TAGOF, 
         // R[A] = R[B]
         MOV, 
-        // R[A] = new type(R[B])
+        // R[A..] = R[B], ..., R[B]
+        VSPLAT, 
+        // R[A] = R[B] + ... + R[B+3]
+        VHADDf, 
+        // R[A] = new box(R[B]), object of boxed base type: any if R[B] is pointer, otherwise u64
         ALLOChr, // heap register
     // ABo
-        // R[A] = new type(CONST[OFFSET])
+        // R[A] = new box(CONST[OFFSET]), object of boxed u64
         ALLOChc, // heap const
-        // R[A] = [R[B] + OFFSET]
-        LOADao, LOADaop, 
-        // [R[A] + OFFSET] = R[B]
-        STOREao, STOREaop, 
-        // {R[A], R[A+1]}(R[A+2], ..., R[A+OFFSET]), all arg will not modified
-        CALLc, // call closure
-        // R[A](R[A+1], ..., R[A+OFFSET]), all arg will not modified
-        CALLf, // call function
-        // return (R[A], ..., R[A + OFFSET])
+        // {R[A], R[A+1]}.method(R[A+2], ...), R[A] is VTable*, R[A+1] is data pointer.
+        // method slot, arg count and returned value count are recorded in Section::traitCallSites[OFFSET]
+        CALLv, // call trait method
+        // return (R[A], ..., R[A + OFFSET - 1])
         RET, 
         // R[A] = (function template R[A])<R[A+1], ..., R[A+OFFSET]>
+        // reserved, rejected by Verifier. templates are instantiated before loading
         INSTANf, 
         // R[A] = (type template R[A])<R[A+1], ..., R[A+OFFSET]>
+        // reserved, as INSTANf
         INSTANt, 
         // R[A] = CONST[OFFSET]
-        LOADc, 
+        LOADc, LOADcp, 
     // ABi
         // if (R[A] op 0) IP += IMM;
         BEZ, BNZ, 
     // Ai
-        // branch
+        // IP += IMM
         BR, 
-        // register exception TRAP
-        TRAP, 
     __TOTAL_COUNT, 
 };
 
 static_assert(static_cast<size_t>(OPCode::__TOTAL_COUNT) < 0x80);
 
+// lanes of vector opcode, 4 x f64 fits one AVX register
+constexpr u32 kVectorLanes = 4;
+
+enum class OPFormat : u8 {
+    kNone, kABC, kABCi, kABCo, kABiCo, kABoCo, kABr, kABo, kABi, kAi, 
+};
+
+/**
+ * @brief get encoding format of op, opcodes in OPCode are grouped by format
+ * 
+ */
+constexpr OPFormat formatOf(OPCode op) {
+    if (op < OPCode::ADDu) return OPFormat::kNone;
+    if (op < OPCode::LOADi) return OPFormat::kABC;
+    if (op < OPCode::ALLOCsr) return OPFormat::kABCi;
+    if (op < OPCode::LOADst) return OPFormat::kABCo;
+    if (op < OPCode::NOT) return OPFormat::kABoCo;
+    if (op < OPCode::ALLOChc) return OPFormat::kABr;
+    if (op < OPCode::BEZ) return OPFormat::kABo;
+    if (op < OPCode::BR) return OPFormat::kABi;
+    return OPFormat::kAi;
+}
+
+/**
+ * @brief one encoded instruction, see 'opcode' in memory model above
+ * 
+ * when executing, IP is index of next instruction, so IMM of branch is relative to next instruction.
+ */
+struct Instruction {
+    u32 raw;
+
+    constexpr OPCode op() const { return static_cast<OPCode>(raw & 0xFF); }
+    constexpr u8 a() const { return static_cast<u8>(raw >> 8); }
+    constexpr u8 b() const { return static_cast<u8>(raw >> 16); }
+    constexpr u8 c() const { return static_cast<u8>(raw >> 24); }
+    constexpr i8 bImm() const { return static_cast<i8>(b()); }
+    constexpr i8 cImm() const { return static_cast<i8>(c()); }
+    constexpr u16 bcOffset() const { return static_cast<u16>(raw >> 16); }
+    constexpr i16 bcImm() const { return static_cast<i16>(bcOffset()); }
+    constexpr i32 abcImm() const { return static_cast<i32>(raw) >> 8; }
+
+    static constexpr Instruction makeABC(OPCode op, u8 a, u8 b, u8 c) {
+        return {u32(op) | (u32(a) << 8) | (u32(b) << 16) | (u32(c) << 24)};
+    }
+    static constexpr Instruction makeABo(OPCode op, u8 a, u16 offset) {
+        return {u32(op) | (u32(a) << 8) | (u32(offset) << 16)};
+    }
+    static constexpr Instruction makeABi(OPCode op, u8 a, i16 imm) { return makeABo(op, a, static_cast<u16>(imm)); }
+    static constexpr Instruction makeAi(OPCode op, i32 imm) { return {u32(op) | (static_cast<u32>(imm) << 8)}; }
+};
+static_assert(sizeof(Instruction) == sizeof(u32));
+
 }
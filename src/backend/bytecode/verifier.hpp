@@ -0,0 +1,571 @@
+/**
+ * @file verifier.hpp
+ * @author agent
+ * @brief load time bytecode verifier
+ * @date 2026-10-18
+ *
+ * @details
+ *
+ * verify a Section once before it can be executed, so interpreter runs verified code without checks.
+ * proved by abstract interpretation over register file (which register is defined at each instruction):
+ *   1. every register used is lower than regUsageCnt and defined on all path reaching the instruction
+ *   2. every register keeps its kind (data or pointer) declared in FunctionInfo::pointerReg
+ *   3. CONST / STATIC / AUTO offsets, CALLv call sites and impl slots are in range
+ *   4. branch targets are in code, and code never falls through its end
+ *   5. exception table is sorted and nested, registers defined at handler are those defined at every instruction
+ *      may throw in its range (registers of callee frame excluded)
+ *   6. RET returns returnCnt values with the declared kind
+ *   7. every AUTO slot written by ALLOCsr / ALLOCsc keeps one kind, pointer if written from pointer register
+ *   8. initializer of STATIC slot is verified, takes no param and returns one value of the kind slot is loaded as
+ *   9. INSTANf / INSTANt are not used, templates are instantiated before loading
+ *
+ * kinds of args / returned values across a call are checked at call boundary by interpreter, since callee is
+ * not known until runtime.
+ * as by-product, registers hold pointer at each safepoint (call, heap allocation, back edge and LOADst / LOADstp
+ * of slot with initializer) and AUTO slots hold pointer are recorded as RegisterPointerMap for GC.
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Verify vector opcodes.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Verify exception table and flow state into handlers.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Pointer maps at safepoints only, with AUTO slots hold pointer.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Verify TAGi / UNTAG / TAGOF.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Back edges are safepoints.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Check CONST slots of impls.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Check STATIC initializers, reject INSTAN*.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <algorithm>
+#include <bitset>
+#include <expected>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "defs.hpp"
+#include "backend/bytecode/opcode.hpp"
+#include "runtime/vm.hpp"
+
+namespace rulejit {
+
+struct VerifyError {
+    // index of instruction
+    usize ip;
+    const char* reason;
+};
+
+struct Verifier {
+    using Section = CodeManager::Section;
+
+    /**
+     * @brief verify section, set Section::verified and Section::pointerMap if success
+     *
+     * @param s
+     * @return std::expected<void, VerifyError>
+     */
+    static std::expected<void, VerifyError> verify(Section& s) {
+        Verifier v{s};
+        return v.run();
+    }
+
+  private:
+    using RegSet = std::bitset<256>;
+    enum class Kind {
+        kData,
+        kPointer,
+        kAny,
+    };
+
+    explicit Verifier(Section& s) : s(s), in(s.code.size()), queued(s.code.size(), false) {}
+
+    Section& s;
+    // registers defined before each instruction, nullopt if not reached yet
+    std::vector<std::optional<RegSet>> in;
+    std::vector<bool> queued;
+    std::vector<usize> worklist;
+
+    std::expected<void, VerifyError> run() {
+        auto& info = s.info;
+        if (s.code.empty()) {
+            return std::unexpected(VerifyError{0, "empty code"});
+        }
+        if (usize(info.paramCnt) + info.returnCnt > info.regUsageCnt) {
+            return std::unexpected(VerifyError{0, "params and returned values exceed regUsageCnt"});
+        }
+
+        if (const char* reason = checkExceptionTable(); reason) {
+            return std::unexpected(VerifyError{0, reason});
+        }
+        for (auto& i : s.implSlots) {
+            if (i.slot >= s.constant.size()) {
+                return std::unexpected(VerifyError{0, "impl slot out of range"});
+            }
+        }
+        for (auto& i : s.staticInits) {
+            if (i.slot >= s.staticVar.size() || staticInitOf(i.slot) != &i) {
+                return std::unexpected(VerifyError{0, "STATIC initializer out of range or duplicated"});
+            }
+            if (i.init == nullptr || !i.init->verified || i.init->native != nullptr || i.init->info.paramCnt != 0 ||
+                i.init->info.returnCnt != 1) {
+                return std::unexpected(VerifyError{0, "illegal STATIC initializer"});
+            }
+        }
+
+        RegSet entry;
+        for (usize i = 0; i < info.paramCnt; ++i) {
+            entry.set(i);
+        }
+        flow(0, entry);
+        while (!worklist.empty()) {
+            usize ip = worklist.back();
+            worklist.pop_back();
+            queued[ip] = false;
+            if (const char* reason = transfer(ip, *in[ip]); reason) {
+                return std::unexpected(VerifyError{ip, reason});
+            }
+        }
+
+        RegisterPointerMap pm;
+        if (auto r = autoSlots(pm.autoSlots); !r) {
+            return std::unexpected(r.error());
+        }
+        std::unordered_map<RegSet, u16> unique;
+        for (usize ip = 0; ip < s.code.size(); ++ip) {
+            u32 end = in[ip] ? safepointEnd(ip) : 0;
+            if (end == 0) {
+                continue;
+            }
+            RegSet m = *in[ip] & info.pointerReg & (RegSet{}.set() >> (256 - end));
+            auto [it, inserted] = unique.try_emplace(m, static_cast<u16>(pm.maps.size()));
+            if (inserted) {
+                if (pm.maps.size() > u16(-1)) {
+                    return std::unexpected(VerifyError{ip, "too many different pointer maps"});
+                }
+                pm.maps.push_back(m);
+            }
+            pm.safepoints.push_back(u32(ip));
+            pm.index.push_back(it->second);
+        }
+        s.pointerMap = std::move(pm);
+        s.verified = true;
+        return {};
+    }
+
+    /**
+     * @brief registers of frame [0, end) kept while stopped at reachable ip, 0 if ip is not safepoint
+     * registers behind args of a call belong to callee frame
+     *
+     */
+    u32 safepointEnd(usize ip) const {
+        Instruction ins = s.code[ip];
+        switch (ins.op()) {
+        case OPCode::CALLc: case OPCode::CALLf:
+            return std::min<u32>(256, ins.a() + 1 + ins.b());
+        case OPCode::CALLv:
+            return std::min<u32>(256, ins.a() + 2 + s.traitCallSites[ins.bcOffset()].argCnt);
+        case OPCode::ALLOChr: case OPCode::ALLOChc:
+            return 256;
+        // initializer runs nested
+        case OPCode::LOADst: case OPCode::LOADstp:
+            return staticInitOf(ins.b()) != nullptr ? 256 : 0;
+        // back edge, thread may park there for GC of another thread
+        case OPCode::BEZ: case OPCode::BNZ:
+            return ins.bcImm() < 0 ? 256 : 0;
+        case OPCode::BR:
+            return ins.abcImm() < 0 ? 256 : 0;
+        default:
+            return 0;
+        }
+    }
+
+    const Section::StaticInit* staticInitOf(u32 slot) const {
+        auto it = std::find_if(s.staticInits.begin(), s.staticInits.end(),
+                               [slot](const Section::StaticInit& i) { return i.slot == slot; });
+        return it == s.staticInits.end() ? nullptr : &*it;
+    }
+
+    /**
+     * @brief AUTO offsets written from pointer register by reachable instructions, sorted.
+     * one offset should not be written with both kinds
+     *
+     */
+    std::expected<void, VerifyError> autoSlots(std::vector<u32>& slots) const {
+        // kind of each AUTO slot written, by offset
+        std::unordered_map<u32, Kind> kinds;
+        for (usize ip = 0; ip < s.code.size(); ++ip) {
+            Instruction ins = s.code[ip];
+            Kind k;
+            if (!in[ip]) {
+                continue;
+            } else if (ins.op() == OPCode::ALLOCsr) {
+                k = s.info.pointerReg[ins.b()] ? Kind::kPointer : Kind::kData;
+            } else if (ins.op() == OPCode::ALLOCsc) {
+                // CONST of pointer kind is in static memory, never moves
+                k = Kind::kData;
+            } else {
+                continue;
+            }
+            if (auto [it, inserted] = kinds.try_emplace(ins.c(), k); !inserted && it->second != k) {
+                return std::unexpected(VerifyError{ip, "AUTO slot holds both data and pointer"});
+            }
+        }
+        for (auto [slot, k] : kinds) {
+            if (k == Kind::kPointer) {
+                slots.push_back(slot);
+            }
+        }
+        std::sort(slots.begin(), slots.end());
+        return {};
+    }
+
+    const char* checkExceptionTable() {
+        // ends of ranges enclosing current one
+        std::vector<u32> open;
+        const ExceptionRange* last = nullptr;
+        for (auto& r : s.exceptionTable) {
+            if (r.begin >= r.end || r.end > s.code.size() || r.handler >= s.code.size()) {
+                return "exception range out of code";
+            }
+            if (last != nullptr && (r.begin < last->begin || (r.begin == last->begin && r.end > last->end))) {
+                return "exception table not sorted";
+            }
+            while (!open.empty() && open.back() <= r.begin) {
+                open.pop_back();
+            }
+            if (!open.empty() && r.end > open.back()) {
+                return "exception ranges overlap";
+            }
+            open.push_back(r.end);
+            last = &r;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief state of instruction at ip may throw flows into handlers of all ranges covering it, since type of
+     * exception is not known
+     *
+     */
+    void flowToHandlers(usize ip, const RegSet& st) {
+        for (auto& r : s.exceptionTable) {
+            if (r.begin > ip) {
+                break;
+            }
+            if (ip < r.end) {
+                flow(r.handler, st);
+            }
+        }
+    }
+
+    /**
+     * @brief merge state into target instruction, defined only if defined on every path
+     *
+     * @return false if target out of code
+     */
+    bool flow(isize target, const RegSet& st) {
+        if (target < 0 || usize(target) >= s.code.size()) {
+            return false;
+        }
+        auto& now = in[target];
+        if (!now) {
+            now = st;
+        } else {
+            RegSet merged = *now & st;
+            if (merged == *now) {
+                return true;
+            }
+            now = merged;
+        }
+        if (!queued[target]) {
+            queued[target] = true;
+            worklist.push_back(target);
+        }
+        return true;
+    }
+
+    /**
+     * @brief check one instruction and flow state to its successors
+     *
+     * @return const char* reason if failed, nullptr if success
+     */
+    const char* transfer(usize ip, RegSet st) {
+        auto& info = s.info;
+        Instruction ins = s.code[ip];
+        u32 a = ins.a(), b = ins.b(), c = ins.c();
+
+        auto kindOf = [&](u32 r) { return info.pointerReg[r] ? Kind::kPointer : Kind::kData; };
+        auto use = [&](u32 r, Kind k) {
+            return r < info.regUsageCnt && st[r] && (k == Kind::kAny || kindOf(r) == k);
+        };
+        auto def = [&](u32 r, Kind k) {
+            if (r >= info.regUsageCnt || (k != Kind::kAny && kindOf(r) != k)) {
+                return false;
+            }
+            st.set(r);
+            return true;
+        };
+        auto useRange = [&](u32 begin, u32 cnt, Kind k) {
+            for (u32 i = 0; i < cnt; ++i) {
+                if (!use(begin + i, k)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        auto defRange = [&](u32 begin, u32 cnt, Kind k) {
+            for (u32 i = 0; i < cnt; ++i) {
+                if (!def(begin + i, k)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        // callee frame begin at R[a+1], args are R[a+1, a+1+paramCnt) and returned values just behind them
+        auto call = [&](u32 paramCnt, u32 retCnt) {
+            u32 retBegin = a + 1 + paramCnt;
+            if (!useRange(a + 1, paramCnt, Kind::kAny) || retBegin + retCnt > info.regUsageCnt) {
+                return false;
+            }
+            // exception thrown by callee
+            RegSet caught = st;
+            for (u32 i = a + 1; i < 256; ++i) {
+                caught.reset(i);
+            }
+            flowToHandlers(ip, caught);
+            // registers behind args are overwritten by callee
+            for (u32 i = retBegin; i < 256; ++i) {
+                st.reset(i);
+            }
+            for (u32 i = 0; i < retCnt; ++i) {
+                st.set(retBegin + i);
+            }
+            return true;
+        };
+        auto next = [&]() { return flow(isize(ip) + 1, st) ? nullptr : "fall through end of code"; };
+
+        switch (ins.op()) {
+        case OPCode::NOP:
+            return next();
+        case OPCode::ADDu: case OPCode::ADDf: case OPCode::SUBu: case OPCode::SUBf: case OPCode::MULi:
+        case OPCode::MULf: case OPCode::DIVi: case OPCode::DIVf: case OPCode::MULu: case OPCode::DIVu:
+        case OPCode::MODu: case OPCode::SHLu: case OPCode::SHRu: case OPCode::AND: case OPCode::OR:
+        case OPCode::XOR: case OPCode::GEu: case OPCode::GEi: case OPCode::LEu: case OPCode::LEi:
+        case OPCode::Gu: case OPCode::Gi: case OPCode::Lu: case OPCode::Li: case OPCode::GEf:
+        case OPCode::LEf: case OPCode::Gf: case OPCode::Lf:
+            if (!use(b, Kind::kData) || !use(c, Kind::kData) || !def(a, Kind::kData)) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::EQ:
+            // pointer identity is allowed
+            if (!use(b, Kind::kAny) || !use(c, kindOf(b)) || !def(a, Kind::kData)) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::LOADrr: case OPCode::LOADrrp:
+            if (!use(b, Kind::kPointer) || !use(c, Kind::kData) ||
+                !def(a, ins.op() == OPCode::LOADrrp ? Kind::kPointer : Kind::kData)) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::STORErr: case OPCode::STORErrp:
+            if (!use(a, Kind::kPointer) || !use(c, Kind::kData) ||
+                !use(b, ins.op() == OPCode::STORErrp ? Kind::kPointer : Kind::kData)) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::CMOV:
+            if (!use(c, Kind::kData) || !use(b, Kind::kAny) || !use(a, kindOf(b))) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::VADDf: case OPCode::VSUBf: case OPCode::VMULf: case OPCode::VDIVf: case OPCode::VGEf:
+        case OPCode::VLEf: case OPCode::VGf: case OPCode::VLf:
+            if (!useRange(b, kVectorLanes, Kind::kData) || !useRange(c, kVectorLanes, Kind::kData) ||
+                !defRange(a, kVectorLanes, Kind::kData)) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::VFMAf: case OPCode::VSEL:
+            if (!useRange(a, kVectorLanes, Kind::kData) || !useRange(b, kVectorLanes, Kind::kData) ||
+                !useRange(c, kVectorLanes, Kind::kData)) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::VLOADao:
+            if (!use(b, Kind::kPointer) || !defRange(a, kVectorLanes, Kind::kData)) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::VSTOREao:
+            if (!use(a, Kind::kPointer) || !useRange(b, kVectorLanes, Kind::kData)) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::VSPLAT:
+            if (!use(b, Kind::kData) || !defRange(a, kVectorLanes, Kind::kData)) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::VHADDf:
+            if (!useRange(b, kVectorLanes, Kind::kData) || !def(a, Kind::kData)) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::LOADi: case OPCode::LOADao:
+        case OPCode::LOADip: case OPCode::LOADaop: {
+            bool p = ins.op() == OPCode::LOADip || ins.op() == OPCode::LOADaop;
+            if (!use(b, Kind::kPointer) || !def(a, p ? Kind::kPointer : Kind::kData)) {
+                return "illegal register";
+            }
+            return next();
+        }
+        case OPCode::STOREi: case OPCode::STOREao:
+        case OPCode::STOREip: case OPCode::STOREaop: {
+            bool p = ins.op() == OPCode::STOREip || ins.op() == OPCode::STOREaop;
+            if (!use(a, Kind::kPointer) || !use(b, p ? Kind::kPointer : Kind::kData)) {
+                return "illegal register";
+            }
+            return next();
+        }
+        case OPCode::ALLOCsr:
+            if (c >= info.autoStorageRequirement) {
+                return "AUTO offset out of range";
+            }
+            if (!use(b, Kind::kAny) || !def(a, Kind::kPointer)) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::THROW:
+            if (!use(a, Kind::kData) || !useRange(b, c + 1, Kind::kAny)) {
+                return "illegal register";
+            }
+            flowToHandlers(ip, st);
+            return nullptr;
+        case OPCode::LOADst: case OPCode::LOADstp:
+            if (b >= s.staticVar.size()) {
+                return "STATIC offset out of range";
+            }
+            if (auto* i = staticInitOf(b); i != nullptr) {
+                if (i->init->info.pointerReg[0] != (ins.op() == OPCode::LOADstp)) {
+                    return "STATIC initializer returns other kind";
+                }
+                // exception thrown by initializer
+                flowToHandlers(ip, st);
+            }
+            if (!def(a, ins.op() == OPCode::LOADstp ? Kind::kPointer : Kind::kData)) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::ALLOCsc:
+            if (b >= s.constant.size()) {
+                return "CONST offset out of range";
+            }
+            if (c >= info.autoStorageRequirement) {
+                return "AUTO offset out of range";
+            }
+            if (!def(a, Kind::kPointer)) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::CALLc:
+            // capture object is the first arg
+            if (!use(a, Kind::kData) || !use(a + 1, Kind::kPointer) || b == 0 || !call(b, c)) {
+                return "illegal call";
+            }
+            return next();
+        case OPCode::CALLf:
+            if (!use(a, Kind::kData) || !call(b, c)) {
+                return "illegal call";
+            }
+            return next();
+        case OPCode::NOT: case OPCode::DTRANSuf: case OPCode::DTRANSfu: case OPCode::DTRANSif:
+        case OPCode::DTRANSfi:
+            if (!use(b, Kind::kData) || !def(a, Kind::kData)) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::TAGi:
+            if (!use(b, Kind::kData) || !def(a, Kind::kPointer)) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::UNTAG: case OPCode::TAGOF:
+            if (!use(b, Kind::kPointer) || !def(a, Kind::kData)) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::MOV:
+            if (!use(b, Kind::kAny) || !def(a, kindOf(b))) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::ALLOChr:
+            if (!use(b, Kind::kAny) || !def(a, Kind::kPointer)) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::ALLOChc:
+            if (ins.bcOffset() >= s.constant.size()) {
+                return "CONST offset out of range";
+            }
+            if (!def(a, Kind::kPointer)) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::CALLv: {
+            if (ins.bcOffset() >= s.traitCallSites.size()) {
+                return "call site out of range";
+            }
+            auto& site = s.traitCallSites[ins.bcOffset()];
+            // data pointer of trait object is the first arg
+            if (!use(a, Kind::kData) || !use(a + 1, Kind::kPointer) || !call(site.argCnt + 1u, site.retCnt)) {
+                return "illegal call";
+            }
+            return next();
+        }
+        case OPCode::RET: {
+            if (ins.bcOffset() != info.returnCnt) {
+                return "returned value count mismatch";
+            }
+            for (u32 i = 0; i < info.returnCnt; ++i) {
+                if (!use(a + i, info.pointerReg[info.paramCnt + i] ? Kind::kPointer : Kind::kData)) {
+                    return "illegal returned value";
+                }
+            }
+            return nullptr;
+        }
+        case OPCode::INSTANf: case OPCode::INSTANt:
+            return "template instantiation at runtime is not supported";
+        case OPCode::LOADc: case OPCode::LOADcp:
+            if (ins.bcOffset() >= s.constant.size()) {
+                return "CONST offset out of range";
+            }
+            if (!def(a, ins.op() == OPCode::LOADcp ? Kind::kPointer : Kind::kData)) {
+                return "illegal register";
+            }
+            return next();
+        case OPCode::BEZ: case OPCode::BNZ:
+            if (!use(a, Kind::kData)) {
+                return "illegal register";
+            }
+            if (!flow(isize(ip) + 1 + ins.bcImm(), st)) {
+                return "branch target out of code";
+            }
+            return next();
+        case OPCode::BR:
+            if (!flow(isize(ip) + 1 + ins.abcImm(), st)) {
+                return "branch target out of code";
+            }
+            return nullptr;
+        default:
+            return "illegal opcode";
+        }
+    }
+};
+
+}
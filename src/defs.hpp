@@ -10,6 +10,9 @@
  * <table>
  * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
  * <tr><td>nanaglutamate</td><td>2024-11-15</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Fix ObjHeader::addFlag.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Remove ObjHeader::Color, mark state moved to side bitmap.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Comparable tokens.</td></tr>
  * </table>
  */
 #pragma once
@@ -54,7 +57,7 @@ struct alignas(u64) ObjHeader {
     // size of total object / sizeof(u64) (DONOT contains ObjHeader); u8(-1) means out of range, should lookup through
     // typemanager
     u8 sizeCompressed;
-    // age in minor, color in elder
+    // age in minor, unused in elder: mark state of major GC is kept in MarkBitmap
     u8 ageOrColor;
     // flags
     u8 flag;
@@ -71,16 +74,6 @@ struct alignas(u64) ObjHeader {
         return h;
     }
 
-    enum class Color {
-        kWhite = 0,
-        kGray = 1,
-        kBlack = 2,
-    };
-    void setColor(Color c) {
-        assert(!hasFlag(Flags::kIsMinorObject));
-        ageOrColor = static_cast<u8>(c);
-    }
-
     bool isBigObject() { return sizeCompressed == decltype(sizeCompressed)(-1); }
 
     // TODO: record memory type in flags
@@ -93,7 +86,7 @@ struct alignas(u64) ObjHeader {
         kIsMinorObject = 16, // minor if set, major / static / huge if unset
     };
     bool hasFlag(Flags f) { return (flag & static_cast<u8>(f)) != 0; }
-    void addFlag(Flags f) { flag &= static_cast<u8>(f); }
+    void addFlag(Flags f) { flag |= static_cast<u8>(f); }
     void removeFlag(Flags f) { flag &= ~static_cast<u8>(f); }
 };
 static_assert(sizeof(ObjHeader) == sizeof(u64));
@@ -112,7 +105,7 @@ static_assert(sizeof(reg) == sizeof(u64));
 struct Token {
     u32 data;
     Token(u32 data) : data(data) {};
-    operator u32() { return data; }
+    operator u32() const { return data; }
 };
 
 // unique through packages
@@ -130,7 +123,8 @@ struct GlobalVarToken : public Token {};
 
 struct StringToken {
     const std::string_view* data;
-    constexpr auto operator<=>(StringToken other) noexcept { return data <=> other.data; }
+    constexpr auto operator<=>(StringToken other) const noexcept { return data <=> other.data; }
+    constexpr bool operator==(StringToken other) const noexcept { return data == other.data; }
 };
 
 struct PackagedToken {
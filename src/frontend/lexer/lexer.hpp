@@ -10,12 +10,15 @@
  * <table>
  * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
  * <tr><td>nanaglutamate</td><td>2024-11-15</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Include cstdlib for abort.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Fix token cache lookup and token length.</td></tr>
  * </table>
  */
 #pragma once
 
 #include <cctype>
 #include <cstdint>
+#include <cstdlib>
 #include <string_view>
 #include <unordered_map>
 #include <utility>
@@ -87,12 +90,12 @@ class LexerContext {
   private:
     LexerIteratorWithType next(size_t startIndex, Guidance guide) {
         size_t cacheKey = getCacheKey(startIndex, guide);
-        if (auto it = cache.find(cacheKey); it == cache.end()) {
+        if (auto it = cache.find(cacheKey); it != cache.end()) {
             return it->second;
         }
         size_t realStartIndex = skipSpaceAndComment(startIndex);
         auto [endIndex, type] = expandToken(realStartIndex, guide);
-        return cache[cacheKey] = {src.substr(realStartIndex, endIndex - startIndex), type};
+        return cache[cacheKey] = {src.substr(realStartIndex, endIndex - realStartIndex), type};
     }
 
     size_t skipSpaceAndComment(size_t index) {
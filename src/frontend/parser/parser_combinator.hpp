@@ -10,6 +10,7 @@
  * <table>
  * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
  * <tr><td>nanaglutamate</td><td>2024-11-15</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Non-static lambda, accepted by GCC 12.</td></tr>
  * </table>
  */
 #pragma once
@@ -24,6 +25,6 @@ namespace rulejit {
 template <typename T>
 concept ParserNode = requires { T::operator(); };
 
-auto def = []() static {};
+inline auto def = []() {};
 
 } // namespace rulejit
\ No newline at end of file
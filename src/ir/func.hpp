@@ -0,0 +1,39 @@
+/**
+ * @file func.hpp
+ * @author agent
+ * @brief function templates owned by token
+ * @date 2026-10-19
+ *
+ * @details
+ *
+ * FunctionTemplateToken is index of template in FunctionManager, instantiation is done by CodeManager.
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Initial version.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <deque>
+
+#include "defs.hpp"
+#include "ir/tplate.hpp"
+
+namespace rulejit {
+
+struct FunctionManager {
+    FunctionTemplateToken add(FunctionTemplate&& f) {
+        functions.push_back(std::move(f));
+        return {static_cast<u32>(functions.size() - 1)};
+    }
+
+    FunctionTemplate& get(FunctionTemplateToken f) { return functions[f]; }
+
+  private:
+    // deque to keep address stable
+    std::deque<FunctionTemplate> functions;
+};
+
+}
@@ -10,6 +10,10 @@
  * <table>
  * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
  * <tr><td>nanaglutamate</td><td>2024-11-15</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Add Trait method slots and Impl.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Object shape of type for Memory, make tuple types.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Add traits and impls.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Shape of static array, dynamic array has none.</td></tr>
  * </table>
  */
 #pragma once
@@ -19,6 +23,7 @@
 #include <unordered_map>
 #include <utility>
 #include <variant>
+#include <vector>
 
 #include "defs.hpp"
 #include "tools/string_pool.hpp"
@@ -75,18 +80,46 @@ struct Type {
     Type(Type&&) = default;
 
     InnerType data;
+
+    // shape of object of this type on heap, filled by TypeManager when type is made. each member takes one reg
+    ObjHeader header{};
+    // byte of object, header.sizeCompressed is out of range if it is big
+    usize size = 0;
+    // pointer members out of ObjHeader::pointerMask (index >= 8)
+    std::vector<u32> pointerMembers;
+    // false if size of object is not known by type (dynamic array), it can not be allocated by type
+    bool shaped = false;
+
+    ObjHeader headerPrototype() const { return header; }
+    usize objSize() const { return size; }
 };
 
 struct Trait {
+    // method slot is the index in this list, stable since trait is loaded
+    std::vector<StringToken> methodNames;
+    std::vector<TypeToken> methodTypes;
+};
 
+struct Impl {
+    TypeToken type;
+    TraitToken trait;
+    // method name -> implementation, must cover all methods of trait
+    std::unordered_map<StringToken, FunctionTemplateToken> methods;
 };
 
 
 struct TypeManager {
-    TypeManager(StringPool* sp): sp(sp) {
+    // base types made by constructor
+    static constexpr u32 kUnit = 0;
+    static constexpr u32 kDynamic = 1;
+    static constexpr u32 kI64 = 2;
+    static constexpr u32 kU64 = 3;
+    static constexpr u32 kF64 = 4;
+    static constexpr u32 kAny = 5;
+
+    TypeManager(tools::StringPool* sp): sp(sp) {
         layouts.reserve(256);
         types.reserve(256);
-        templates.reserve(256);
 
         // make base types
         layouts.push_back({{}});
@@ -96,6 +129,10 @@ struct TypeManager {
         types.push_back(BaseType{false, sp->take("u64")});
         types.push_back(BaseType{false, sp->take("f64")});
         types.push_back(BaseType{true, sp->take("any")});
+        // base types are boxed as one reg
+        for (u32 t = kDynamic; t <= kAny; ++t) {
+            makeShape(t, {TypeToken{t}});
+        }
     }
     TypeManager(const TypeManager&) = delete;
     auto& operator=(const TypeManager&) = delete;
@@ -104,16 +141,50 @@ struct TypeManager {
         return types[t];
     }
 
+    Trait& getTrait(TraitToken t) {
+        return traits[t];
+    }
+
+    Impl& getImpl(ImplToken i) {
+        return impls[i];
+    }
+
+    TraitToken addTrait(Trait&& t) {
+        traits.push_back(std::move(t));
+        return TraitToken{static_cast<u32>(traits.size() - 1)};
+    }
+    // methods should cover all methods of its trait
+    ImplToken addImpl(Impl&& i) {
+        impls.push_back(std::move(i));
+        return ImplToken{static_cast<u32>(impls.size() - 1)};
+    }
+
+    // member of this type is stored as-is, others are held by pointer
+    static bool isScalar(TypeToken t) { return t == kI64 || t == kU64 || t == kF64; }
+
+    // dynamic array, no shape since its length is only known when allocated
     TypeToken arrayTypeOf(TypeToken base) {
-        return findCached(base, arrayType, [this](TypeToken base){
-            types.emplace_back(ArrayType{base});
-            return types.size() - 1;
+        return findCached(u32(base), arrayType, [this](u32 base) {
+            types.emplace_back(ArrayType{{}, TypeToken{base}});
+            return TypeToken{static_cast<u32>(types.size() - 1)};
+        });
+    }
+    // static array, laid out like struct of length members
+    TypeToken arrayTypeOf(TypeToken base, usize length) {
+        return findCached(std::pair{u32(base), length}, staticArrayType, [this](std::pair<u32, usize> key) {
+            types.emplace_back(ArrayType{{key.second}, TypeToken{key.first}});
+            u32 t = static_cast<u32>(types.size() - 1);
+            makeShape(t, std::vector<TypeToken>(key.second, TypeToken{key.first}));
+            return TypeToken{t};
         });
     }
-    TypeToken tupleTypeOf(const std::vector<TypeToken>& base) {
-        return findCached(base, tupleType, [this, base](std::vector<TypeToken> member){
-            
-            return types.size() - 1;
+    TypeToken tupleTypeOf(const std::vector<TypeToken>& member) {
+        return findCached(member, tupleType, [this](const std::vector<TypeToken>& member) {
+            layouts.push_back({member});
+            types.emplace_back(TupleType{LayoutToken{static_cast<u32>(layouts.size() - 1)}});
+            u32 t = static_cast<u32>(types.size() - 1);
+            makeShape(t, member);
+            return TypeToken{t};
         });
     }
     // PooledList<TypeToken> getTypeList() {
@@ -123,17 +194,39 @@ struct TypeManager {
     //     return PooledList<std::tuple<StringToken, TypeToken>>{pool1};
     // }
 private:
-    StringPool* sp;
+    tools::StringPool* sp;
 
     std::vector<Layout> layouts = {};
     std::vector<Type> types = {};
+    std::vector<Trait> traits = {};
+    std::vector<Impl> impls = {};
 
     // PooledList<TypeToken>::Pool pool0;
     // PooledList<std::tuple<StringToken, TypeToken>>::Pool pool1;
 
-    std::unordered_map<TypeToken, TypeToken> arrayType = {};
+    std::unordered_map<u32, TypeToken> arrayType = {};
+    std::map<std::pair<u32, usize>, TypeToken> staticArrayType = {};
     std::map<std::vector<TypeToken>, TypeToken, std::less<>> tupleType = {};
 
+    void makeShape(u32 t, const std::vector<TypeToken>& member) {
+        auto& type = types[t];
+        usize n = member.size();
+        type.size = n * sizeof(u64);
+        type.header = {t, n < u8(-1) ? u8(n) : u8(-1), 0, 0, 0};
+        type.shaped = true;
+        for (u32 i = 0; i < n; ++i) {
+            if (isScalar(member[i])) {
+                continue;
+            }
+            type.header.addFlag(ObjHeader::Flags::kHasPointerMember);
+            if (i < 8) {
+                type.header.pointerMask |= u8(1 << i);
+            } else {
+                type.pointerMembers.push_back(i);
+            }
+        }
+    }
+
     template <typename Key, typename Container, typename CreateCallback>
         requires std::is_constructible_v<TypeToken, std::invoke_result_t<CreateCallback, Key>>
     TypeToken findCached(Key&& p, Container& cache, CreateCallback&& c) {
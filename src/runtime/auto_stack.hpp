@@ -0,0 +1,176 @@
+/**
+ * @file auto_stack.hpp
+ * @author agent
+ * @brief chunked AUTO stack of ThreadVM
+ * @date 2026-10-18
+ *
+ * @details
+ *
+ * see 'auto' stack in memory model of opcode.hpp. each frame bumps HEAD by autoStorageRequirement when entered,
+ * and resets HEAD when left, so ALLOCsr / ALLOCsc is only an offset from AUTO[0] of the frame.
+ * when chunk is full a new chunk is linked, one freed chunk is cached to avoid thrash at chunk boundary.
+ *
+ * object on AUTO stack never moves, chunks used by parked evaluation are detached into Coroutine and attached
+ * to another stack when resumed.
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Initial version.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <algorithm>
+#include <memory>
+
+#include "defs.hpp"
+
+namespace rulejit {
+
+struct AutoStack {
+    // count of reg in one default chunk
+    static constexpr usize kChunkSize = 8 * PageSize / sizeof(reg);
+
+    struct Chunk {
+        std::unique_ptr<reg[]> data;
+        usize size;
+        // chunk below this one, and its HEAD when this one is linked
+        std::unique_ptr<Chunk> prev;
+        reg* prevHead;
+
+        reg* end() const { return data.get() + size; }
+        bool contains(const reg* p) const { return data.get() <= p && p < end(); }
+    };
+
+    // position to reset HEAD to
+    struct Mark {
+        Chunk* chunk;
+        reg* head;
+    };
+
+    // chunks detached from stack, top one first
+    struct Segment {
+        std::unique_ptr<Chunk> top;
+        reg* head;
+    };
+
+    AutoStack() = default;
+    AutoStack(const AutoStack&) = delete;
+    auto& operator=(const AutoStack&) = delete;
+    AutoStack(AutoStack&&) = default;
+    ~AutoStack() {
+        release(std::move(top));
+    }
+
+    Mark mark() const { return {top.get(), head}; }
+
+    /**
+     * @brief reserve n reg for one frame
+     *
+     * @return reg* AUTO[0] of the frame
+     */
+    reg* push(usize n) {
+        if (n > usize(end - head)) [[unlikely]] {
+            link(n);
+        }
+        reg* p = head;
+        head += n;
+        return p;
+    }
+
+    /**
+     * @brief reset HEAD to m, chunks above m are freed
+     *
+     */
+    void pop(Mark m) {
+        while (top.get() != m.chunk) [[unlikely]] {
+            unlink();
+        }
+        head = m.head;
+    }
+
+    /**
+     * @brief make sure frames pushed after it do not share chunk with frames before, so they can be detached
+     *
+     */
+    void beginSegment() {
+        if (top == nullptr || head != top->data.get()) {
+            link(0);
+        }
+    }
+
+    /**
+     * @brief detach chunk contains 'from' and all chunks above it. 'from' should be AUTO[0] of the first frame
+     * after beginSegment()
+     *
+     */
+    Segment detach(const reg* from) {
+        Segment s{std::move(top), head};
+        Chunk* bottom = s.top.get();
+        while (!bottom->contains(from)) {
+            bottom = bottom->prev.get();
+        }
+        top = std::move(bottom->prev);
+        head = bottom->prevHead;
+        end = top ? top->end() : nullptr;
+        return s;
+    }
+
+    /**
+     * @brief link detached chunks on top of this stack
+     *
+     */
+    void attach(Segment s) {
+        Chunk* bottom = s.top.get();
+        while (bottom->prev != nullptr) {
+            bottom = bottom->prev.get();
+        }
+        bottom->prev = std::move(top);
+        bottom->prevHead = head;
+        top = std::move(s.top);
+        head = s.head;
+        end = top->end();
+    }
+
+  private:
+    std::unique_ptr<Chunk> top;
+    reg* head = nullptr;
+    reg* end = nullptr;
+    // one freed chunk of kChunkSize
+    std::unique_ptr<Chunk> spare;
+
+    void link(usize n) {
+        std::unique_ptr<Chunk> c;
+        if (n <= kChunkSize && spare != nullptr) {
+            c = std::move(spare);
+        } else {
+            usize size = std::max(n, kChunkSize);
+            c = std::make_unique<Chunk>(std::make_unique<reg[]>(size), size, nullptr, nullptr);
+        }
+        c->prev = std::move(top);
+        c->prevHead = head;
+        top = std::move(c);
+        head = top->data.get();
+        end = top->end();
+    }
+
+    void unlink() {
+        auto c = std::move(top);
+        top = std::move(c->prev);
+        head = c->prevHead;
+        end = top ? top->end() : nullptr;
+        if (c->size == kChunkSize && spare == nullptr) {
+            spare = std::move(c);
+        }
+    }
+
+    // free chain without recursion
+    static void release(std::unique_ptr<Chunk> c) {
+        while (c != nullptr) {
+            c = std::move(c->prev);
+        }
+    }
+};
+
+}
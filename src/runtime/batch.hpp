@@ -0,0 +1,501 @@
+/**
+ * @file batch.hpp
+ * @author agent
+ * @brief evaluate one function over many rows of columnar input
+ * @date 2026-10-18
+ *
+ * @details
+ *
+ * rows are executed in chunks of kBatchLanes lanes. registers are stored as struct-of-arrays (R[n] of all lanes
+ * are adjacent), each instruction is dispatched once and applied to all active lanes.
+ *
+ * divergent branch is handled by per-lane IP and active mask: lanes at the lowest IP run together (min-PC), so
+ * lanes reconverge as soon as they reach the same instruction again.
+ *
+ * only leaf functions built from lane-wise opcodes run in batch, others (call, alloc, store, exception...) fall
+ * back to Interpreter::execute() row by row. vector opcodes run lane-wise as well, each lane has its own
+ * kVectorLanes registers.
+ * columns hold data only, function taking or returning pointer kind is rejected. lanes are not scanned by GC, so
+ * function holding pointer in any register runs by scalar interpreter.
+ * chunks stop at safepoint on back edges and between chunks, as calls and back edges of scalar interpreter.
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Fall back to scalar for vector opcodes.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Remove TRAP.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Run metered thread by scalar interpreter.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Lane-wise TAGi / UNTAG / TAGOF.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Section with STATIC initializer runs by scalar interpreter.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Run vector opcodes lane-wise, reject pointer params / returns.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Poll safepoint on back edges and between chunks.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "defs.hpp"
+#include "backend/bytecode/opcode.hpp"
+#include "runtime/interpreter.hpp"
+#include "runtime/vm.hpp"
+
+namespace rulejit {
+
+constexpr usize kBatchLanes = 64;
+
+template <typename T>
+concept BatchElement = std::is_same_v<T, i64> || std::is_same_v<T, u64> || std::is_same_v<T, f64>;
+
+/**
+ * @brief one column of param, rows are contiguous
+ *
+ */
+struct BatchInput {
+    const std::byte* data;
+
+    template <BatchElement T>
+    BatchInput(std::span<const T> s) : data(reinterpret_cast<const std::byte*>(s.data())) {}
+    template <BatchElement T>
+    BatchInput(std::span<T> s) : data(reinterpret_cast<const std::byte*>(s.data())) {}
+};
+
+/**
+ * @brief one column of returned value, rows are contiguous
+ *
+ */
+struct BatchOutput {
+    std::byte* data;
+
+    template <BatchElement T>
+    BatchOutput(std::span<T> s) : data(reinterpret_cast<std::byte*>(s.data())) {}
+};
+
+struct BatchInterpreter {
+    using Section = CodeManager::Section;
+
+    explicit BatchInterpreter(Interpreter* scalar) : scalar(scalar) {}
+
+    /**
+     * @brief check if f can run lane-wise
+     *
+     */
+    static bool supports(const Section* f) {
+        // STATIC initializer runs nested on scalar interpreter, pointers in lanes are not GC roots
+        if (f->native != nullptr || f->staticState != nullptr || f->info.pointerReg.any()) {
+            return false;
+        }
+        for (auto ins : f->code) {
+            switch (ins.op()) {
+            case OPCode::CALLc: case OPCode::CALLf: case OPCode::CALLv:
+            case OPCode::THROW:
+            case OPCode::ALLOCsr: case OPCode::ALLOCsc: case OPCode::ALLOChr: case OPCode::ALLOChc:
+            case OPCode::INSTANf: case OPCode::INSTANt:
+            case OPCode::STORErr: case OPCode::STORErrp: case OPCode::STOREi: case OPCode::STOREip:
+            case OPCode::STOREao: case OPCode::STOREaop: case OPCode::VSTOREao:
+                return false;
+            default:
+                break;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief run f for each row
+     *
+     * @param t used when fall back to scalar interpreter
+     * @param rows
+     * @param params size should be paramCnt of f, each column contains 'rows' elements
+     * @param rets size should be returnCnt of f, each column contains 'rows' elements
+     * @return ExecResult kReturned if all rows returned, otherwise the first failure. kBadCall if a param or
+     * returned value of f is pointer kind
+     */
+    ExecResult run(ThreadVM& t, const Section* f, usize rows, std::span<const BatchInput> params,
+                   std::span<const BatchOutput> rets) {
+        if (!f->verified || params.size() != f->info.paramCnt || rets.size() != f->info.returnCnt) {
+            return ExecResult::kBadCall;
+        }
+        for (usize i = 0; i < usize(f->info.paramCnt) + f->info.returnCnt; ++i) {
+            if (f->info.pointerReg[i]) {
+                return ExecResult::kBadCall;
+            }
+        }
+        // lanes are not metered
+        if (!supports(f) || t.fuel.enabled) {
+            return runScalar(t, f, rows, params, rets);
+        }
+        lanes.resize(usize(f->info.regUsageCnt) * kBatchLanes);
+        for (usize begin = 0; begin < rows; begin += kBatchLanes) {
+            usize cnt = std::min(kBatchLanes, rows - begin);
+            poll();
+            if (auto r = runChunk(f, begin, cnt, params, rets); r != ExecResult::kReturned) {
+                return r;
+            }
+        }
+        return ExecResult::kReturned;
+    }
+
+  private:
+    Interpreter* scalar;
+    // R[n] of lane l is lanes[n * kBatchLanes + l]
+    std::vector<reg> lanes;
+    u32 ip[kBatchLanes];
+
+    // stop for GC of another thread, lanes hold data only and nothing is scanned
+    void poll() {
+        if (scalar->mem->safepointRequested()) [[unlikely]] {
+            scalar->mem->parkAtSafepoint();
+        }
+    }
+
+    ExecResult runScalar(ThreadVM& t, const Section* f, usize rows, std::span<const BatchInput> params,
+                         std::span<const BatchOutput> rets) {
+        std::vector<reg> args(params.size()), ret(rets.size());
+        for (usize row = 0; row < rows; ++row) {
+            for (usize i = 0; i < params.size(); ++i) {
+                std::memcpy(&args[i], params[i].data + row * sizeof(reg), sizeof(reg));
+            }
+            if (auto r = scalar->execute(t, f, args, ret); r != ExecResult::kReturned) {
+                return r;
+            }
+            for (usize i = 0; i < rets.size(); ++i) {
+                std::memcpy(rets[i].data + row * sizeof(reg), &ret[i], sizeof(reg));
+            }
+        }
+        return ExecResult::kReturned;
+    }
+
+    ExecResult runChunk(const Section* f, usize begin, usize cnt, std::span<const BatchInput> params,
+                        std::span<const BatchOutput> rets) {
+        reg* L = lanes.data();
+        for (usize i = 0; i < params.size(); ++i) {
+            std::memcpy(L + i * kBatchLanes, params[i].data + begin * sizeof(reg), cnt * sizeof(reg));
+        }
+
+        constexpr u64 kFull = ~u64(0);
+        // lanes not returned yet
+        u64 alive = cnt == kBatchLanes ? kFull : (u64(1) << cnt) - 1;
+        // lanes at pc, others alive lanes wait at ip[lane]
+        u64 active = alive;
+        u32 pc = 0;
+        const Instruction* code = f->code.data();
+
+        auto forActive = [&](auto&& func) {
+            if (active == kFull) {
+                for (usize l = 0; l < kBatchLanes; ++l) {
+                    func(l);
+                }
+            } else {
+                for (u64 m = active; m != 0; m &= m - 1) {
+                    func(usize(std::countr_zero(m)));
+                }
+            }
+        };
+        // active lanes moved to pc, pick lowest IP of alive lanes to run next
+        auto reselect = [&]() {
+            for (u64 m = active; m != 0; m &= m - 1) {
+                ip[std::countr_zero(m)] = pc;
+            }
+            u32 low = std::numeric_limits<u32>::max();
+            for (u64 m = alive; m != 0; m &= m - 1) {
+                low = std::min(low, ip[std::countr_zero(m)]);
+            }
+            active = 0;
+            for (u64 m = alive; m != 0; m &= m - 1) {
+                if (ip[std::countr_zero(m)] == low) {
+                    active |= u64(1) << std::countr_zero(m);
+                }
+            }
+            pc = low;
+        };
+        auto branch = [&](u64 taken, u32 target) {
+            if ((alive & ~active) == 0 && (taken == 0 || taken == active)) {
+                // not divergent
+                pc = taken == 0 ? pc + 1 : target;
+                return;
+            }
+            for (u64 m = active; m != 0; m &= m - 1) {
+                usize l = std::countr_zero(m);
+                ip[l] = (taken >> l) & 1 ? target : pc + 1;
+            }
+            active = 0;
+            reselect();
+        };
+
+#define RULEJIT_LANE_BINOP(OP, T, EXPR)                                                                               \
+    case OPCode::OP: {                                                                                                \
+        reg *A = L + ins.a() * kBatchLanes, *B = L + ins.b() * kBatchLanes, *C = L + ins.c() * kBatchLanes;         \
+        forActive([&](usize l) {                                                                                      \
+            T lhs = B[l].as<T>(), rhs = C[l].as<T>();                                                                 \
+            A[l].as<T>() = static_cast<T>(EXPR);                                                                      \
+        });                                                                                                           \
+        break;                                                                                                        \
+    }
+#define RULEJIT_LANE_CMPOP(OP, T, EXPR)                                                                               \
+    case OPCode::OP: {                                                                                                \
+        reg *A = L + ins.a() * kBatchLanes, *B = L + ins.b() * kBatchLanes, *C = L + ins.c() * kBatchLanes;         \
+        forActive([&](usize l) {                                                                                      \
+            T lhs = B[l].as<T>(), rhs = C[l].as<T>();                                                                 \
+            A[l].as<u64>() = (EXPR) ? 1 : 0;                                                                          \
+        });                                                                                                           \
+        break;                                                                                                        \
+    }
+#define RULEJIT_LANE_UNOP(OP, T, U, EXPR)                                                                             \
+    case OPCode::OP: {                                                                                                \
+        reg *A = L + ins.a() * kBatchLanes, *B = L + ins.b() * kBatchLanes;                                          \
+        forActive([&](usize l) {                                                                                      \
+            T v = B[l].as<T>();                                                                                       \
+            A[l].as<U>() = static_cast<U>(EXPR);                                                                      \
+        });                                                                                                           \
+        break;                                                                                                        \
+    }
+#define RULEJIT_LANE_VECOP(OP, EXPR)                                                                                  \
+    case OPCode::OP: {                                                                                                \
+        u32 a = ins.a(), b = ins.b(), c = ins.c();                                                                    \
+        forActive([&](usize l) {                                                                                      \
+            f64 lhs[kVectorLanes], rhs[kVectorLanes];                                                                 \
+            for (u32 i = 0; i < kVectorLanes; ++i) {                                                                  \
+                lhs[i] = L[(b + i) * kBatchLanes + l].as<f64>();                                                      \
+                rhs[i] = L[(c + i) * kBatchLanes + l].as<f64>();                                                      \
+            }                                                                                                         \
+            for (u32 i = 0; i < kVectorLanes; ++i) {                                                                  \
+                L[(a + i) * kBatchLanes + l].as<f64>() = EXPR;                                                        \
+            }                                                                                                         \
+        });                                                                                                           \
+        break;                                                                                                        \
+    }
+
+        while (alive != 0) {
+            Instruction ins = code[pc];
+            switch (ins.op()) {
+            case OPCode::NOP:
+                break;
+            RULEJIT_LANE_BINOP(ADDu, u64, lhs + rhs)
+            RULEJIT_LANE_BINOP(ADDf, f64, lhs + rhs)
+            RULEJIT_LANE_BINOP(SUBu, u64, lhs - rhs)
+            RULEJIT_LANE_BINOP(SUBf, f64, lhs - rhs)
+            RULEJIT_LANE_BINOP(MULi, i64, u64(lhs) * u64(rhs))
+            RULEJIT_LANE_BINOP(MULf, f64, lhs * rhs)
+            RULEJIT_LANE_BINOP(DIVf, f64, lhs / rhs)
+            RULEJIT_LANE_BINOP(MULu, u64, lhs * rhs)
+            RULEJIT_LANE_BINOP(SHLu, u64, lhs << (rhs & 63))
+            RULEJIT_LANE_BINOP(SHRu, u64, lhs >> (rhs & 63))
+            RULEJIT_LANE_BINOP(AND, u64, lhs & rhs)
+            RULEJIT_LANE_BINOP(OR, u64, lhs | rhs)
+            RULEJIT_LANE_BINOP(XOR, u64, lhs ^ rhs)
+            RULEJIT_LANE_CMPOP(GEu, u64, lhs >= rhs)
+            RULEJIT_LANE_CMPOP(GEi, i64, lhs >= rhs)
+            RULEJIT_LANE_CMPOP(LEu, u64, lhs <= rhs)
+            RULEJIT_LANE_CMPOP(LEi, i64, lhs <= rhs)
+            RULEJIT_LANE_CMPOP(Gu, u64, lhs > rhs)
+            RULEJIT_LANE_CMPOP(Gi, i64, lhs > rhs)
+            RULEJIT_LANE_CMPOP(Lu, u64, lhs < rhs)
+            RULEJIT_LANE_CMPOP(Li, i64, lhs < rhs)
+            RULEJIT_LANE_CMPOP(EQ, u64, lhs == rhs)
+            RULEJIT_LANE_CMPOP(GEf, f64, lhs >= rhs)
+            RULEJIT_LANE_CMPOP(LEf, f64, lhs <= rhs)
+            RULEJIT_LANE_CMPOP(Gf, f64, lhs > rhs)
+            RULEJIT_LANE_CMPOP(Lf, f64, lhs < rhs)
+            RULEJIT_LANE_UNOP(NOT, u64, u64, v ? 0 : 1)
+            RULEJIT_LANE_UNOP(DTRANSuf, u64, f64, v)
+            RULEJIT_LANE_UNOP(DTRANSfu, f64, u64, v)
+            RULEJIT_LANE_UNOP(DTRANSif, i64, f64, v)
+            RULEJIT_LANE_UNOP(DTRANSfi, f64, i64, v)
+            RULEJIT_LANE_UNOP(TAGi, u64, reg*, helper::getHackedPtr(v, helper::PtrTag::kInt))
+            RULEJIT_LANE_UNOP(UNTAG, reg*, u64, helper::getHackedPayload(v))
+            RULEJIT_LANE_UNOP(TAGOF, reg*, u64, helper::getTag(v))
+            RULEJIT_LANE_VECOP(VADDf, lhs[i] + rhs[i])
+            RULEJIT_LANE_VECOP(VSUBf, lhs[i] - rhs[i])
+            RULEJIT_LANE_VECOP(VMULf, lhs[i] * rhs[i])
+            RULEJIT_LANE_VECOP(VDIVf, lhs[i] / rhs[i])
+            // mask lane is u64 1 / 0, as Interpreter
+            RULEJIT_LANE_VECOP(VGEf, std::bit_cast<f64>(u64(lhs[i] >= rhs[i])))
+            RULEJIT_LANE_VECOP(VLEf, std::bit_cast<f64>(u64(lhs[i] <= rhs[i])))
+            RULEJIT_LANE_VECOP(VGf, std::bit_cast<f64>(u64(lhs[i] > rhs[i])))
+            RULEJIT_LANE_VECOP(VLf, std::bit_cast<f64>(u64(lhs[i] < rhs[i])))
+            case OPCode::VFMAf: {
+                u32 a = ins.a(), b = ins.b(), c = ins.c();
+                forActive([&](usize l) {
+                    f64 acc[kVectorLanes], lhs[kVectorLanes], rhs[kVectorLanes];
+                    for (u32 i = 0; i < kVectorLanes; ++i) {
+                        acc[i] = L[(a + i) * kBatchLanes + l].as<f64>();
+                        lhs[i] = L[(b + i) * kBatchLanes + l].as<f64>();
+                        rhs[i] = L[(c + i) * kBatchLanes + l].as<f64>();
+                    }
+                    for (u32 i = 0; i < kVectorLanes; ++i) {
+                        acc[i] += lhs[i] * rhs[i];
+                        L[(a + i) * kBatchLanes + l].as<f64>() = acc[i];
+                    }
+                });
+                break;
+            }
+            case OPCode::VSEL: {
+                u32 a = ins.a(), b = ins.b(), c = ins.c();
+                forActive([&](usize l) {
+                    reg v[kVectorLanes];
+                    for (u32 i = 0; i < kVectorLanes; ++i) {
+                        v[i] = L[(c + i) * kBatchLanes + l].as<u64>() ? L[(b + i) * kBatchLanes + l]
+                                                                        : L[(a + i) * kBatchLanes + l];
+                    }
+                    for (u32 i = 0; i < kVectorLanes; ++i) {
+                        L[(a + i) * kBatchLanes + l] = v[i];
+                    }
+                });
+                break;
+            }
+            case OPCode::VLOADao: {
+                u32 a = ins.a();
+                reg* B = L + ins.b() * kBatchLanes;
+                usize offset = ins.c();
+                forActive([&](usize l) {
+                    reg v[kVectorLanes];
+                    std::memcpy(v, B[l].as<reg*>() + offset, sizeof(v));
+                    for (u32 i = 0; i < kVectorLanes; ++i) {
+                        L[(a + i) * kBatchLanes + l] = v[i];
+                    }
+                });
+                break;
+            }
+            case OPCode::VSPLAT: {
+                u32 a = ins.a();
+                reg* B = L + ins.b() * kBatchLanes;
+                forActive([&](usize l) {
+                    reg v = B[l];
+                    for (u32 i = 0; i < kVectorLanes; ++i) {
+                        L[(a + i) * kBatchLanes + l] = v;
+                    }
+                });
+                break;
+            }
+            case OPCode::VHADDf: {
+                reg* A = L + ins.a() * kBatchLanes;
+                u32 b = ins.b();
+                forActive([&](usize l) {
+                    f64 v[kVectorLanes];
+                    for (u32 i = 0; i < kVectorLanes; ++i) {
+                        v[i] = L[(b + i) * kBatchLanes + l].as<f64>();
+                    }
+                    A[l].as<f64>() = (v[0] + v[1]) + (v[2] + v[3]);
+                });
+                break;
+            }
+            case OPCode::DIVi: case OPCode::DIVu: case OPCode::MODu: {
+                reg *A = L + ins.a() * kBatchLanes, *B = L + ins.b() * kBatchLanes, *C = L + ins.c() * kBatchLanes;
+                bool zero = false;
+                forActive([&](usize l) { zero |= C[l].as<u64>() == 0; });
+                if (zero) [[unlikely]] {
+                    return ExecResult::kDivideByZero;
+                }
+                OPCode op = ins.op();
+                forActive([&](usize l) {
+                    u64 rhs = C[l].as<u64>();
+                    if (op == OPCode::DIVi) {
+                        i64 lhs = B[l].as<i64>();
+                        A[l].as<i64>() = std::bit_cast<i64>(rhs) == -1 ? i64(0 - u64(lhs)) : lhs / i64(rhs);
+                    } else if (op == OPCode::DIVu) {
+                        A[l].as<u64>() = B[l].as<u64>() / rhs;
+                    } else {
+                        A[l].as<u64>() = B[l].as<u64>() % rhs;
+                    }
+                });
+                break;
+            }
+            case OPCode::LOADrr: case OPCode::LOADrrp: {
+                reg *A = L + ins.a() * kBatchLanes, *B = L + ins.b() * kBatchLanes, *C = L + ins.c() * kBatchLanes;
+                forActive([&](usize l) { A[l] = B[l].as<reg*>()[C[l].as<u64>()]; });
+                break;
+            }
+            case OPCode::LOADi: case OPCode::LOADip: {
+                reg *A = L + ins.a() * kBatchLanes, *B = L + ins.b() * kBatchLanes;
+                isize offset = ins.cImm();
+                forActive([&](usize l) { A[l] = B[l].as<reg*>()[offset]; });
+                break;
+            }
+            case OPCode::LOADao: case OPCode::LOADaop: {
+                reg *A = L + ins.a() * kBatchLanes, *B = L + ins.b() * kBatchLanes;
+                usize offset = ins.c();
+                forActive([&](usize l) { A[l] = B[l].as<reg*>()[offset]; });
+                break;
+            }
+            case OPCode::CMOV: {
+                reg *A = L + ins.a() * kBatchLanes, *B = L + ins.b() * kBatchLanes, *C = L + ins.c() * kBatchLanes;
+                forActive([&](usize l) { A[l] = C[l].as<u64>() ? B[l] : A[l]; });
+                break;
+            }
+            case OPCode::MOV: {
+                reg *A = L + ins.a() * kBatchLanes, *B = L + ins.b() * kBatchLanes;
+                forActive([&](usize l) { A[l] = B[l]; });
+                break;
+            }
+            case OPCode::LOADst: case OPCode::LOADstp: {
+                reg* A = L + ins.a() * kBatchLanes;
+                reg v = f->staticVar[ins.b()];
+                forActive([&](usize l) { A[l] = v; });
+                break;
+            }
+            case OPCode::LOADc: case OPCode::LOADcp: {
+                reg* A = L + ins.a() * kBatchLanes;
+                reg v = f->constant[ins.bcOffset()];
+                forActive([&](usize l) { A[l] = v; });
+                break;
+            }
+            case OPCode::BEZ: case OPCode::BNZ: {
+                reg* A = L + ins.a() * kBatchLanes;
+                u64 nonZero = 0;
+                forActive([&](usize l) { nonZero |= u64(A[l].as<u64>() != 0) << l; });
+                if (ins.bcImm() < 0) {
+                    poll();
+                }
+                branch(ins.op() == OPCode::BNZ ? nonZero : active & ~nonZero, pc + 1 + ins.bcImm());
+                continue;
+            }
+            case OPCode::BR:
+                if (ins.abcImm() < 0) {
+                    poll();
+                }
+                branch(active, pc + 1 + ins.abcImm());
+                continue;
+            case OPCode::RET: {
+                for (u32 i = 0; i < ins.bcOffset(); ++i) {
+                    reg* src = L + (ins.a() + i) * kBatchLanes;
+                    std::byte* dst = rets[i].data + begin * sizeof(reg);
+                    forActive([&](usize l) { std::memcpy(dst + l * sizeof(reg), &src[l], sizeof(reg)); });
+                }
+                alive &= ~active;
+                active = 0;
+                if (alive != 0) {
+                    reselect();
+                }
+                continue;
+            }
+            default:
+                return ExecResult::kUnsupported;
+            }
+
+            // lane-wise instruction, all active lanes go to next one together
+            ++pc;
+            if (u64 waiting = alive & ~active; waiting != 0) [[unlikely]] {
+                for (u64 m = waiting; m != 0; m &= m - 1) {
+                    if (ip[std::countr_zero(m)] == pc) {
+                        active |= u64(1) << std::countr_zero(m);
+                    }
+                }
+            }
+        }
+#undef RULEJIT_LANE_BINOP
+#undef RULEJIT_LANE_CMPOP
+#undef RULEJIT_LANE_UNOP
+#undef RULEJIT_LANE_VECOP
+        return ExecResult::kReturned;
+    }
+};
+
+}
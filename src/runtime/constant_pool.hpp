@@ -0,0 +1,241 @@
+/**
+ * @file constant_pool.hpp
+ * @author agent
+ * @brief interned read-only storage of CONST tables, shared by sections
+ * @date 2026-10-18
+ *
+ * @details
+ *
+ * CONST of a section is built as private vector, and interned into ConstantPool of CodeManager when section is
+ * added. tables of the same content (e.g. instantiations of one template, or functions using the same literals)
+ * are stored once, tables are packed in chunks so constants of hot functions stay in a few pages.
+ *
+ * pooled table is read only. ConstantTable::set (e.g. patching a function value after section added) copies it
+ * into private storage of the section first, other sections sharing it are not
+ * affected. call CodeManager::seal after patching to share it again.
+ *
+ * constants are compared bitwise. before a table is interned, constant objects it refers to (pointer slots, loaded
+ * by LOADcp) are interned one by one: objects of the same content are stored once in the pool, after their pointer
+ * members are interned the same way, so equal object graphs referred by different tables are shared as a whole.
+ * constant objects are read only, the pool keeps no private copy for writers. big objects (size out of
+ * ObjHeader::sizeCompressed) are not interned, CONST keeps referring to the original one.
+ * values are shared per table, not per scalar constant: LOADc reads CONST as one contiguous array, sharing single
+ * numbers between different tables would cost an indirection on each load.
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Intern constant objects referred by pointer slots.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Append to ConstantTable.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "defs.hpp"
+#include "gc/mem.hpp"
+
+namespace rulejit {
+
+struct ConstantPool {
+    // regs of each chunk, tables larger than kHugeSize get their own storage
+    static constexpr usize kChunkSize = 4096;
+    static constexpr usize kHugeSize = kChunkSize / 4;
+
+    ConstantPool() = default;
+    ConstantPool(const ConstantPool&) = delete;
+    auto& operator=(const ConstantPool&) = delete;
+
+    /**
+     * @brief stored copy of values, the same address for the same content
+     *
+     * @return const reg* stable until pool destroyed, nullptr if values is empty
+     */
+    const reg* intern(std::span<const reg> values) {
+        if (values.empty()) {
+            return nullptr;
+        }
+        ++internCnt;
+        if (auto it = tables.find(bytesOf(values.data(), values.size())); it != tables.end()) {
+            return reinterpret_cast<const reg*>(it->data());
+        }
+        reg* p = allocate(values.size());
+        std::memcpy(p, values.data(), values.size_bytes());
+        tables.emplace(bytesOf(p, values.size()));
+        storedBytes += values.size_bytes();
+        return p;
+    }
+
+    /**
+     * @brief stored copy of constant object, the same address for objects of the same content. pointer members are
+     * interned first
+     *
+     * @return reg* interned object, or obj itself if it is already interned or not copied (big object, pointer members
+     * out of ObjHeader::pointerMask, finalizer or native scanner, or in a cycle)
+     */
+    reg* internObject(reg* obj) {
+        if (obj == nullptr || helper::isImmediate(obj) || objects.contains(obj) || visiting.contains(obj)) {
+            return obj;
+        }
+        ObjHeader h = helper::getHeader(obj).getPrototype();
+        bool hasPointer = h.hasFlag(ObjHeader::Flags::kHasPointerMember);
+        if (h.isBigObject() || (hasPointer && h.sizeCompressed > 8) || h.hasFlag(ObjHeader::Flags::kHasFinalizer) ||
+            h.hasFlag(ObjHeader::Flags::kHasNativeScanner)) {
+            return obj;
+        }
+        // header and members
+        std::vector<reg> copy(obj - 1, obj + h.sizeCompressed);
+        copy[0].as<ObjHeader>() = h;
+        visiting.insert(obj);
+        for (u8 i = 0; hasPointer && i < h.sizeCompressed; ++i) {
+            if (h.pointerMask & (1 << i)) {
+                copy[1 + i].as<reg*>() = internObject(obj[i].as<reg*>());
+            }
+        }
+        visiting.erase(obj);
+        // never written, const only for sharing with tables
+        reg* p = const_cast<reg*>(intern(copy)) + 1;
+        objects.insert(p);
+        return p;
+    }
+
+    // count of distinct tables, objects included
+    usize size() const { return tables.size(); }
+    // count of distinct constant objects
+    usize objectSize() const { return objects.size(); }
+    // bytes of distinct tables, and count of intern calls
+    usize bytes() const { return storedBytes; }
+    usize interned() const { return internCnt; }
+
+  private:
+    static std::string_view bytesOf(const reg* p, usize n) {
+        return {reinterpret_cast<const char*>(p), n * sizeof(reg)};
+    }
+
+    reg* allocate(usize n) {
+        if (n > kHugeSize) {
+            return chunks.emplace_back(std::make_unique<reg[]>(n)).get();
+        }
+        if (usize(end - head) < n) {
+            head = chunks.emplace_back(std::make_unique<reg[]>(kChunkSize)).get();
+            end = head + kChunkSize;
+        }
+        return std::exchange(head, head + n);
+    }
+
+    std::vector<std::unique_ptr<reg[]>> chunks;
+    reg* head = nullptr;
+    reg* end = nullptr;
+    // views into chunks
+    std::unordered_set<std::string_view> tables;
+    // interned objects, address of original object is not kept since it may be freed and reused
+    std::unordered_set<reg*> objects;
+    // objects whose members are interned, back edge of cycle keeps original object
+    std::unordered_set<reg*> visiting;
+    usize storedBytes = 0;
+    usize internCnt = 0;
+};
+
+/**
+ * @brief CONST of section, private vector when built, view into ConstantPool after interned
+ *
+ */
+struct ConstantTable {
+    ConstantTable() = default;
+    ConstantTable(std::initializer_list<reg> l) : own(l) { sync(); }
+    ConstantTable(std::vector<reg>&& v) : own(std::move(v)) { sync(); }
+    ConstantTable(const ConstantTable& o) : view(o.view), count(o.count), pooled(o.pooled), own(o.own) { sync(); }
+    ConstantTable(ConstantTable&& o) noexcept
+        : view(o.view), count(o.count), pooled(o.pooled), own(std::move(o.own)) {
+        sync();
+        o.clear();
+    }
+    ConstantTable& operator=(ConstantTable o) noexcept {
+        view = o.view;
+        count = o.count;
+        pooled = o.pooled;
+        own = std::move(o.own);
+        sync();
+        return *this;
+    }
+
+    usize size() const { return count; }
+    bool empty() const { return count == 0; }
+    const reg* data() const { return view; }
+    const reg* begin() const { return view; }
+    const reg* end() const { return view + count; }
+    operator std::span<const reg>() const { return {view, count}; }
+
+    const reg& operator[](usize i) const { return view[i]; }
+    // copies pooled table into private storage first
+    void set(usize i, reg v) {
+        detach();
+        own[i] = v;
+    }
+    // index of v appended, copies pooled table into private storage first
+    usize append(reg v) {
+        detach();
+        own.push_back(v);
+        sync();
+        return count - 1;
+    }
+
+    bool isPooled() const { return pooled; }
+
+    /**
+     * @brief share storage with tables of the same content, private storage is freed
+     *
+     * @param pointerSlots objects referred by slot i are interned first if pointerSlots[i]
+     */
+    void intern(ConstantPool& pool, const std::vector<bool>& pointerSlots = {}) {
+        if (pooled) {
+            return;
+        }
+        for (usize i = 0; i < pointerSlots.size() && i < own.size(); ++i) {
+            if (pointerSlots[i]) {
+                own[i].as<reg*>() = pool.internObject(own[i].as<reg*>());
+            }
+        }
+        view = pool.intern(own);
+        pooled = true;
+        own = {};
+    }
+
+  private:
+    void detach() {
+        if (pooled) {
+            own.assign(view, view + count);
+            pooled = false;
+            sync();
+        }
+    }
+    void sync() {
+        if (!pooled) {
+            view = own.data();
+            count = own.size();
+        }
+    }
+    void clear() {
+        view = nullptr;
+        count = 0;
+        pooled = false;
+        own.clear();
+    }
+
+    // data of pool if pooled, or own
+    const reg* view = nullptr;
+    usize count = 0;
+    bool pooled = false;
+    std::vector<reg> own;
+};
+
+}
@@ -0,0 +1,122 @@
+/**
+ * @file coroutine.hpp
+ * @author agent
+ * @brief suspended evaluation and future of async extern function
+ * @date 2026-10-18
+ *
+ * @details
+ *
+ * an extern function backed by I/O can return ExternStatus::kPending with an ExternFuture. then the evaluation
+ * (all frames since Interpreter::execute) is parked into a Coroutine: its segment of 'reg' stack is copied out,
+ * frames are rebased, so the ThreadVM can run other evaluation.
+ * after future completed, Interpreter::resume() puts the segment back on top of any ThreadVM and continues.
+ *
+ * registers are relocatable since they are addressed by base index. objects on AUTO stack never move, so chunks of
+ * AUTO stack used by parked frames are detached instead of copied (see AutoStack::beginSegment()).
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Detach AUTO stack chunks of parked frames.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Remove traps, exception handlers are static now.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Scan parked frames as GC roots.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Keep ready state of future apart from its continuation.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Scan pointers returned by future as GC roots.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "defs.hpp"
+#include "runtime/vm.hpp"
+
+namespace rulejit {
+
+/**
+ * @brief returned values of a pending extern call, completed by any thread
+ *
+ */
+struct ExternFuture {
+    // should be filled before complete(), by thread attached to Memory if any of them is pointer
+    std::vector<reg> rets;
+
+    /**
+     * @brief mark returned values ready, run continuation if already set
+     *
+     */
+    void complete() {
+        if (state.fetch_or(kReady, std::memory_order_acq_rel) & kHasContinuation) {
+            std::move(continuation)();
+        }
+    }
+
+    /**
+     * @brief set what to do after completed, run immediately if already completed. can only called once
+     *
+     */
+    void onReady(std::move_only_function<void()> f) {
+        continuation = std::move(f);
+        if (state.fetch_or(kHasContinuation, std::memory_order_acq_rel) & kReady) {
+            std::move(continuation)();
+        }
+    }
+
+    bool ready() const { return state.load(std::memory_order_acquire) & kReady; }
+
+  private:
+    // bits, the one setting second of them runs continuation
+    enum State : u8 {
+        kPending = 0,
+        kReady = 1,
+        kHasContinuation = 2,
+    };
+    std::atomic<u8> state = kPending;
+    std::move_only_function<void()> continuation;
+};
+
+/**
+ * @brief parked evaluation, see Interpreter::resume()
+ *
+ */
+struct Coroutine {
+    // 'reg' stack segment, R[0] of first frame is regs[0]
+    std::vector<reg> regs;
+    // base relative to regs
+    std::vector<ThreadVM::FunctionExecutionContext> frames;
+    // AUTO stack of frames, autoMark of the first frame is rewritten when resumed
+    AutoStack::Segment autoSegment;
+
+    // pending extern call, returned values goes to regs[retBase, retBase + retCnt)
+    std::shared_ptr<ExternFuture> future;
+    usize retBase;
+    u8 retCnt;
+    // retPointer[n] if future->rets[n] is pointer, by return kinds of extern function
+    std::bitset<256> retPointer;
+};
+
+/**
+ * @brief call f with address of each register and AUTO slot of parked frames holding pointer, and each pointer
+ * filled into future. registers of pending returned values are not scanned, they are written when resumed
+ * 
+ */
+template <typename F>
+void forEachRoot(Coroutine& co, F&& f) {
+    for (auto& frame : co.frames) {
+        forEachFrameRoot(frame, co.regs.data() + frame.base, f);
+    }
+    auto& rets = co.future->rets;
+    for (usize i = 0, n = std::min<usize>(rets.size(), co.retCnt); i < n; ++i) {
+        if (co.retPointer[i]) {
+            f(&rets[i].as<reg*>());
+        }
+    }
+}
+
+}
@@ -0,0 +1,273 @@
+/**
+ * @file ffi.hpp
+ * @author agent
+ * @brief bind C++ function as extern function without hand written NativeFunction
+ * @date 2026-10-18
+ *
+ * @details
+ *
+ * Trampoline<Fn> is generated per C++ signature at compile time, it reads args directly from registers of caller
+ * (ExternCall::args is a view of R[A+1..]) and calls Fn directly, so the call can be inlined into the trampoline.
+ *
+ * fast path: if all params and returned value are i64 / u64 / f64 / pointer, trampoline bit-casts them from and
+ * to reg, no conversion at all. otherwise other arithmetic types (bool, i32, f32...) are converted from the 64-bit
+ * value of the same category.
+ * reg* is the only pointer of pointer kind (points into VM heap or AUTO stack), other pointers are opaque data.
+ *
+ * declaration is bound only if its FunctionType matches C++ signature: the same param count, and each param and
+ * returned value has the same scalar type (i64 for signed integer, u64 for unsigned integer, bool and opaque
+ * pointer, f64 for floating point), or is held by pointer (reg*) on both sides. unit return matches void.
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Name native Section for profiler and tracer.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Pick trampoline by fast path, match full FunctionType.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <array>
+#include <bit>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "defs.hpp"
+#include "ir/type.hpp"
+#include "runtime/vm.hpp"
+
+namespace rulejit {
+
+// stored in reg as-is
+template <typename T>
+concept RegisterMapped =
+    (std::is_integral_v<T> || std::is_floating_point_v<T> || std::is_pointer_v<T>) && sizeof(T) == sizeof(reg);
+
+template <typename T>
+concept Marshalled = RegisterMapped<T> || std::is_arithmetic_v<T>;
+
+template <Marshalled T>
+T fromReg(const reg& r) {
+    if constexpr (RegisterMapped<T>) {
+        return std::bit_cast<T>(r);
+    } else if constexpr (std::is_floating_point_v<T>) {
+        return static_cast<T>(std::bit_cast<f64>(r));
+    } else if constexpr (std::is_signed_v<T>) {
+        return static_cast<T>(std::bit_cast<i64>(r));
+    } else {
+        return static_cast<T>(std::bit_cast<u64>(r));
+    }
+}
+
+template <Marshalled T>
+reg toReg(T v) {
+    if constexpr (RegisterMapped<T>) {
+        return std::bit_cast<reg>(v);
+    } else if constexpr (std::is_floating_point_v<T>) {
+        return std::bit_cast<reg>(static_cast<f64>(v));
+    } else if constexpr (std::is_signed_v<T>) {
+        return std::bit_cast<reg>(static_cast<i64>(v));
+    } else {
+        return std::bit_cast<reg>(static_cast<u64>(v));
+    }
+}
+
+// held by pointer in VM (reg*), others are data
+template <typename T>
+constexpr bool isPointerKind() {
+    return std::is_same_v<std::remove_cv_t<T>, reg*> || std::is_same_v<std::remove_cv_t<T>, const reg*>;
+}
+
+// matches any type held by pointer, see nativeTypeOf()
+constexpr u32 kNativePointerKind = ~u32(0);
+
+/**
+ * @brief type of C++ param / returned value in VM
+ *
+ * @return u32 scalar base type of TypeManager, kUnit for void, or kNativePointerKind
+ */
+template <typename T>
+constexpr u32 nativeTypeOf() {
+    if constexpr (std::is_void_v<T>) {
+        return TypeManager::kUnit;
+    } else if constexpr (isPointerKind<T>()) {
+        return kNativePointerKind;
+    } else if constexpr (std::is_floating_point_v<T>) {
+        return TypeManager::kF64;
+    } else if constexpr (std::is_signed_v<T>) {
+        return TypeManager::kI64;
+    } else {
+        // unsigned, bool and opaque pointer
+        return TypeManager::kU64;
+    }
+}
+
+template <typename F>
+struct NativeSignature;
+template <typename R, typename... Args>
+struct NativeSignature<R (*)(Args...)> {
+    using Ret = R;
+    using Params = std::tuple<Args...>;
+    static constexpr bool kFastPath = (RegisterMapped<Args> && ...) && (std::is_void_v<R> || RegisterMapped<R>);
+};
+template <typename R, typename... Args>
+struct NativeSignature<R (*)(Args...) noexcept> : NativeSignature<R (*)(Args...)> {};
+
+/**
+ * @brief NativeFunction calls Fn directly
+ *
+ */
+template <auto Fn>
+struct Trampoline {
+    using Sig = NativeSignature<decltype(Fn)>;
+    using Ret = typename Sig::Ret;
+    using Params = typename Sig::Params;
+    static constexpr usize kParamCnt = std::tuple_size_v<Params>;
+    static constexpr usize kReturnCnt = std::is_void_v<Ret> ? 0 : 1;
+
+    static_assert(kParamCnt + kReturnCnt <= 256, "too many params");
+    static_assert(std::is_void_v<Ret> || Marshalled<Ret>, "returned value can not be stored in reg");
+    static_assert([]<usize... I>(std::index_sequence<I...>) {
+        return (Marshalled<std::tuple_element_t<I, Params>> && ...);
+    }(std::make_index_sequence<kParamCnt>{}), "param can not be stored in reg");
+
+    // trampoline bit-casts only if every value is RegisterMapped
+    static constexpr NativeFunction native() {
+        if constexpr (Sig::kFastPath) {
+            return &callDirect;
+        } else {
+            return &callConverted;
+        }
+    }
+
+    // nativeTypeOf() of each param
+    static constexpr std::array<u32, kParamCnt> kParamTypes = []<usize... I>(std::index_sequence<I...>) {
+        return std::array<u32, kParamCnt>{nativeTypeOf<std::tuple_element_t<I, Params>>()...};
+    }(std::make_index_sequence<kParamCnt>{});
+    static constexpr u32 kReturnType = nativeTypeOf<Ret>();
+
+    static CodeManager::Section::FunctionInfo info() {
+        CodeManager::Section::FunctionInfo ret{0, 0, u8(kParamCnt), u8(kReturnCnt), {}};
+        setPointerKind(ret, std::make_index_sequence<kParamCnt>{});
+        if constexpr (kReturnCnt != 0) {
+            ret.pointerReg.set(kParamCnt, isPointerKind<Ret>());
+        }
+        return ret;
+    }
+
+  private:
+    static ExternStatus callDirect(ExternCall& c) {
+        [&]<usize... I>(std::index_sequence<I...>) {
+            if constexpr (std::is_void_v<Ret>) {
+                Fn(std::bit_cast<std::tuple_element_t<I, Params>>(c.args[I])...);
+            } else {
+                c.rets[0] = std::bit_cast<reg>(Fn(std::bit_cast<std::tuple_element_t<I, Params>>(c.args[I])...));
+            }
+        }(std::make_index_sequence<kParamCnt>{});
+        return ExternStatus::kDone;
+    }
+
+    static ExternStatus callConverted(ExternCall& c) {
+        invoke(c, std::make_index_sequence<kParamCnt>{});
+        return ExternStatus::kDone;
+    }
+
+    template <usize... I>
+    static void setPointerKind(CodeManager::Section::FunctionInfo& info, std::index_sequence<I...>) {
+        (info.pointerReg.set(I, isPointerKind<std::tuple_element_t<I, Params>>()), ...);
+    }
+
+    template <usize... I>
+    static void invoke(ExternCall& c, std::index_sequence<I...>) {
+        if constexpr (std::is_void_v<Ret>) {
+            Fn(fromReg<std::tuple_element_t<I, Params>>(c.args[I])...);
+        } else {
+            c.rets[0] = toReg<Ret>(Fn(fromReg<std::tuple_element_t<I, Params>>(c.args[I])...));
+        }
+    }
+};
+
+/**
+ * @brief extern functions by name, bound to ExternFuncDeclare when package loaded
+ *
+ */
+struct ExternRegistry {
+    using Section = CodeManager::Section;
+
+    explicit ExternRegistry(CodeManager* cm) : cm(cm) {}
+
+    /**
+     * @brief register Fn as extern function with name, replaces previous one of the same name
+     *
+     * @return const Section* function value of Fn
+     */
+    template <auto Fn>
+    const Section* def(std::string name) {
+        using T = Trampoline<Fn>;
+        Section* s = cm->addNative(T::info(), T::native());
+        s->name = name;
+        functions.insert_or_assign(std::move(name),
+                                   Entry{s, {T::kParamTypes.begin(), T::kParamTypes.end()}, T::kReturnType});
+        return s;
+    }
+
+    const Section* find(const std::string& name) const {
+        auto it = functions.find(name);
+        return it == functions.end() ? nullptr : it->second.fn;
+    }
+
+    /**
+     * @brief find function for declaration
+     *
+     * @return const Section* nullptr if not registered or type mismatch, see file comment
+     */
+    const Section* bind(const std::string& name, const FunctionType& type) const {
+        auto it = functions.find(name);
+        if (it == functions.end()) {
+            return nullptr;
+        }
+        const Entry& e = it->second;
+        if (e.params.size() != type.params.size() || e.ret != expectedReturn(type.returnType)) {
+            return nullptr;
+        }
+        for (usize i = 0; i < e.params.size(); ++i) {
+            auto& p = type.params[i];
+            if (p.isVararg || e.params[i] != expectedParam(p)) {
+                return nullptr;
+            }
+        }
+        return e.fn;
+    }
+
+  private:
+    struct Entry {
+        const Section* fn;
+        // nativeTypeOf() of C++ signature
+        std::vector<u32> params;
+        u32 ret;
+    };
+
+    CodeManager* cm;
+    std::unordered_map<std::string, Entry> functions;
+
+    // referenced param and non-scalar type are held by pointer
+    static u32 expectedParam(const FunctionType::FunctionParamType& p) {
+        if (p.isReferenced || p.isMutReferenced || !TypeManager::isScalar(p.baseType)) {
+            return kNativePointerKind;
+        }
+        return p.baseType;
+    }
+    static u32 expectedReturn(TypeToken t) {
+        if (t == TypeManager::kUnit || TypeManager::isScalar(t)) {
+            return t;
+        }
+        return kNativePointerKind;
+    }
+};
+
+}
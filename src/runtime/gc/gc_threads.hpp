@@ -0,0 +1,92 @@
+/**
+ * @file gc_threads.hpp
+ * @author agent
+ * @brief persistent helper threads of parallel GC phases
+ * @date 2026-10-18
+ *
+ * @details
+ *
+ * helpers sleep on an epoch counter between GC, so starting a parallel phase is one notify instead of spawning
+ * threads inside the pause. caller of run() works as worker 0.
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Initial version.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "defs.hpp"
+
+namespace rulejit {
+
+struct GcThreads {
+    // n workers, caller included
+    explicit GcThreads(usize n) : n(n) {
+        for (usize i = 1; i < n; ++i) {
+            helpers.emplace_back([this, i] { loop(i); });
+        }
+    }
+    GcThreads(const GcThreads&) = delete;
+    auto& operator=(const GcThreads&) = delete;
+    ~GcThreads() {
+        stopping = true;
+        epoch.fetch_add(1, std::memory_order_release);
+        epoch.notify_all();
+        for (auto& t : helpers) {
+            t.join();
+        }
+    }
+
+    usize size() const { return n; }
+
+    /**
+     * @brief call f(id) for id in [0, n) on all workers, returns after all finished
+     *
+     */
+    template <typename F>
+    void run(F&& f) {
+        ctx = &f;
+        job = [](void* ctx, usize id) { (*static_cast<std::remove_reference_t<F>*>(ctx))(id); };
+        pending.store(n - 1, std::memory_order_relaxed);
+        epoch.fetch_add(1, std::memory_order_release);
+        epoch.notify_all();
+        f(usize(0));
+        for (usize p; (p = pending.load(std::memory_order_acquire)) != 0;) {
+            pending.wait(p, std::memory_order_acquire);
+        }
+    }
+
+  private:
+    void loop(usize id) {
+        u64 seen = 0;
+        while (true) {
+            epoch.wait(seen, std::memory_order_acquire);
+            seen = epoch.load(std::memory_order_acquire);
+            if (stopping) {
+                return;
+            }
+            job(ctx, id);
+            if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                pending.notify_one();
+            }
+        }
+    }
+
+    usize n;
+    std::vector<std::thread> helpers;
+    // bumped to start a phase
+    std::atomic<u64> epoch = 0;
+    // helpers not finished yet
+    std::atomic<usize> pending = 0;
+    std::atomic<bool> stopping = false;
+    void (*job)(void*, usize) = nullptr;
+    void* ctx = nullptr;
+};
+
+}
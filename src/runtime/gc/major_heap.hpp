@@ -0,0 +1,164 @@
+/**
+ * @file major_heap.hpp
+ * @author agent
+ * @brief pages of major heap segregated by size class
+ * @date 2026-10-18
+ *
+ * @details
+ *
+ * objects promoted or allocated in major heap are rounded up to a size class, each class is served by pages of
+ * Page<N> holding objects of one size. metadata of page is kept in its first objects, mark state is in MarkBitmap.
+ * sweeping walks free runs of the bitmap instead of every object, so dense pages cost a few words each.
+ *
+ * each thread caches one page per size class in its Tlab and pops its free list without lock. pages are swept
+ * lazily: when a thread takes a page for its cache, or by background steps of major GC. empty pages go back to
+ * PagePool of Memory and may be reused by any class.
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Initial version, Page moved from mem.hpp.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Mark bits moved to MarkBitmap, sweep by free runs.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "defs.hpp"
+#include "runtime/gc/mark_bitmap.hpp"
+
+namespace rulejit {
+
+// object size of each class, header included. larger objects are huge
+inline constexpr std::array<usize, 7> kSizeClasses = {16, 32, 64, 128, 256, 512, 1024};
+
+// class of object taking n byte with header, n should not exceed the largest class
+constexpr u8 sizeClassOf(usize n) {
+    return n <= kSizeClasses[0] ? 0 : u8(std::bit_width(n - 1) - std::bit_width(kSizeClasses[0] - 1));
+}
+
+/**
+ * @brief metadata of page of major heap, placed in reserved first objects of Page
+ *
+ */
+struct PageHeader {
+    // slots not allocated after last sweep, linked through their first word
+    void* freeList = nullptr;
+    u8 sizeClass;
+    // log2 of object size
+    u8 shift;
+    // free list is rebuilt after last marking
+    bool swept = true;
+    u16 live = 0;
+
+    // index of object slot holding p
+    usize indexOf(const void* p) const { return (usize(p) - usize(this)) >> shift; }
+    // begin of object slot holding p, where its header is
+    const void* slotOf(const void* p) const { return reinterpret_cast<const u8*>(this) + (indexOf(p) << shift); }
+};
+
+// call f with std::integral_constant of object size of class c
+template <typename F>
+void visitSizeClass(u8 c, F&& f) {
+    [&]<usize... I>(std::index_sequence<I...>) {
+        ((c == I ? (f(std::integral_constant<usize, kSizeClasses[I]>{}), 0) : 0), ...);
+    }(std::make_index_sequence<kSizeClasses.size()>{});
+}
+
+inline PageHeader* pageHeaderOf(const void* p) {
+    return std::launder(reinterpret_cast<PageHeader*>(usize(p) & ~(PageSize - 1)));
+}
+
+template <size_t ObjSize = sizeof(u64)>
+struct alignas(PageSize) Page {
+    static_assert(ObjSize % sizeof(u64) == 0);
+    static_assert(ObjSize != 0);
+    static_assert(PageSize / ObjSize > 2);
+
+    struct alignas(ObjSize) Obj {
+        u8 bytes[ObjSize];
+        template <typename T>
+        T& as() { return *std::launder(reinterpret_cast<T*>(bytes)); }
+    } data[PageSize / ObjSize];
+
+    static constexpr usize kObjects = PageSize / ObjSize;
+    // objects taken by PageHeader
+    static constexpr usize kReserved = (sizeof(PageHeader) + ObjSize - 1) / ObjSize;
+    static_assert(kReserved < kObjects);
+
+    PageHeader& header() { return *std::launder(reinterpret_cast<PageHeader*>(data)); }
+
+    /**
+     * @brief init data as a free list; first 'offset' object is reserved.
+     *
+     * @param offset
+     * @return void* pointer to first chunk
+     */
+    void* initFreeList(usize offset = kReserved) {
+        void* tmp = nullptr;
+        for (usize i = kObjects; i-- > offset;) {
+            data[i].template as<void*>() = tmp;
+            tmp = reinterpret_cast<void*>(&data[i]);
+        }
+        return tmp;
+    }
+
+    /**
+     * @brief page of class c at p, all objects are free
+     *
+     */
+    static Page* init(void* p, u8 c) {
+        auto* page = static_cast<Page*>(p);
+        auto* h = new (p) PageHeader{};
+        h->sizeClass = c;
+        h->shift = u8(std::countr_zero(ObjSize));
+        h->freeList = page->initFreeList();
+        return page;
+    }
+
+    /**
+     * @brief rebuild free list from slots beginning in free runs of bitmap, and clear it for next major GC
+     *
+     * @return usize count of live objects
+     */
+    usize sweep(MarkBitmap& marks) {
+        constexpr usize kGranules = ObjSize / MarkBitmap::kGranule;
+        auto& h = header();
+        usize first = marks.granuleOf(data), end = first + PageSize / MarkBitmap::kGranule;
+        void** tail = &h.freeList;
+        usize free = 0;
+        for (usize g = first + kReserved * kGranules; (g = marks.findFree(g, end)) != end;) {
+            usize run = marks.findLive(g, end);
+            // tail of live object may start a run, slot is free only if its first granule is in run
+            for (usize i = (g - first + kGranules - 1) / kGranules; first + i * kGranules < run; ++i) {
+                *tail = &data[i];
+                tail = &data[i].template as<void*>();
+                ++free;
+            }
+            g = run;
+        }
+        *tail = nullptr;
+        h.live = u16(kObjects - kReserved - free);
+        h.swept = true;
+        marks.clear(data, PageSize);
+        return h.live;
+    }
+};
+
+/**
+ * @brief page of one size class cached by a thread, free list is popped without lock
+ *
+ */
+struct FreeListCache {
+    void* head = nullptr;
+    PageHeader* page = nullptr;
+};
+
+}
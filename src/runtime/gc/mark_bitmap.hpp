@@ -0,0 +1,147 @@
+/**
+ * @file mark_bitmap.hpp
+ * @author agent
+ * @brief side mark bitmap of major GC, two bits per 8 byte granule of PageSpace
+ * @date 2026-10-18
+ *
+ * @details
+ *
+ * major GC keeps mark state out of objects, so marking never writes to heap pages: pages of snapshot images and
+ * pages shared by forked workers stay clean, and marker touches only one word per 32 granules.
+ *
+ * each granule has two bits, of the granule holding ObjHeader:
+ *   - mark bit: object is reached, set when shaded (gray)
+ *   - live bit: set on every granule of object when scanned or allocated during marking (black)
+ * white is 00, gray is mark only, black is mark and live. after marking no object is gray, so live bits of a page
+ * give its live bytes by popcount, and free runs by searching zero bits.
+ *
+ * bitmap covers the whole reservation of PageSpace and is mapped lazily like its side table, 1/32 of heap touched.
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Initial version.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <new>
+
+#include <sys/mman.h>
+
+#include "defs.hpp"
+#include "runtime/gc/page_space.hpp"
+
+namespace rulejit {
+
+struct MarkBitmap {
+    static constexpr usize kGranule = sizeof(u64);
+    // granules per word
+    static constexpr usize kPerWord = 32;
+    static constexpr u64 kMarkBits = 0x5555555555555555;
+    static constexpr u64 kLiveBits = kMarkBits << 1;
+
+    explicit MarkBitmap(const PageSpace& space)
+        : base(usize(space.begin())), words(space.capacity() / kGranule / kPerWord) {
+        void* p = mmap(nullptr, words * sizeof(u64), PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED) {
+            throw std::bad_alloc{};
+        }
+        bits = static_cast<u64*>(p);
+    }
+    MarkBitmap(const MarkBitmap&) = delete;
+    auto& operator=(const MarkBitmap&) = delete;
+    ~MarkBitmap() { munmap(bits, words * sizeof(u64)); }
+
+    usize granuleOf(const void* p) const { return (usize(p) - base) / kGranule; }
+
+    /**
+     * @brief set mark bit of object with header at p, allocating threads and marker may race on one word
+     *
+     * @return bool was marked
+     */
+    bool mark(const void* p) {
+        usize g = granuleOf(p);
+        u64 bit = u64(1) << (g % kPerWord * 2);
+        return word(g).fetch_or(bit, std::memory_order_relaxed) & bit;
+    }
+    bool isMarked(const void* p) const {
+        usize g = granuleOf(p);
+        return (word(g).load(std::memory_order_relaxed) >> (g % kPerWord * 2)) & 1;
+    }
+
+    /**
+     * @brief set live bits of n byte object with header at p
+     *
+     */
+    void setLive(const void* p, usize n) {
+        usize g = granuleOf(p);
+        usize end = g + (n + kGranule - 1) / kGranule;
+        while (g < end) {
+            usize next = std::min(end, (g / kPerWord + 1) * kPerWord);
+            u64 mask = rangeMask(g % kPerWord, next - g) & kLiveBits;
+            word(g).fetch_or(mask, std::memory_order_relaxed);
+            g = next;
+        }
+    }
+
+    /**
+     * @brief live byte in [p, p + n), both should be aligned to kGranule * kPerWord
+     *
+     */
+    usize liveBytes(const void* p, usize n) const {
+        const u64* w = bits + granuleOf(p) / kPerWord;
+        usize live = 0;
+        for (usize i = 0; i < n / kGranule / kPerWord; ++i) {
+            live += std::popcount(w[i] & kLiveBits);
+        }
+        return live * kGranule;
+    }
+
+    // first granule in [g, end) not live, end if none
+    usize findFree(usize g, usize end) const { return find<false>(g, end); }
+    // first granule in [g, end) live, end if none
+    usize findLive(usize g, usize end) const { return find<true>(g, end); }
+
+    /**
+     * @brief clear both bits of [p, p + n) after sweeping, both should be aligned to kGranule * kPerWord
+     *
+     */
+    void clear(const void* p, usize n) {
+        std::memset(bits + granuleOf(p) / kPerWord, 0, n / kGranule / kPerWord * sizeof(u64));
+    }
+
+  private:
+    std::atomic_ref<u64> word(usize g) const { return std::atomic_ref<u64>{bits[g / kPerWord]}; }
+
+    // both bits of granule [i, i + n) of a word
+    static u64 rangeMask(usize i, usize n) {
+        u64 m = n == kPerWord ? ~u64(0) : (u64(1) << (n * 2)) - 1;
+        return m << (i * 2);
+    }
+
+    // called when no thread marks
+    template <bool Live>
+    usize find(usize g, usize end) const {
+        while (g < end) {
+            u64 w = Live ? bits[g / kPerWord] : ~bits[g / kPerWord];
+            w &= kLiveBits & (~u64(0) << (g % kPerWord * 2));
+            if (w != 0) {
+                return std::min(end, g / kPerWord * kPerWord + usize(std::countr_zero(w)) / 2);
+            }
+            g = (g / kPerWord + 1) * kPerWord;
+        }
+        return end;
+    }
+
+    usize base;
+    usize words;
+    u64* bits;
+};
+
+}
@@ -10,86 +10,123 @@
  * <table>
  * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
  * <tr><td>nanaglutamate</td><td>2024-11-15</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Tracepoints of allocation and GC step.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Object inspection and static region for snapshot.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Bind TypeManager on construction, inline helpers.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Bump pointer nursery with thread local allocation buffers.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Replace card table set by sequential store buffers.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Find page kind through side table of PageSpace, alloc huge objects in it.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Parallel minor GC with work stealing.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Concurrent mark sweep major GC with SATB barrier.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Size class segregated major heap, Page moved to major_heap.hpp.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Mark state in side bitmap instead of header color.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Optional evacuating compaction of sparse major pages.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Roots of one GC reported by root scanner, collect on full Tlab.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Tagged immediates in pointer slots, skipped by GC and barriers.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Scan members beyond pointerMask by object shape of TypeManager.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Stop attached mutators at safepoints before minor GC.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Scan static regions as roots of major GC, implement allocStatic().</td></tr>
  * </table>
  */
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <concepts>
 #include <cstddef>
+#include <cstring>
 #include <deque>
 #include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <new>
-#include <unordered_set>
+#include <thread>
+#include <utility>
+#include <vector>
 #include <bit>
 
+#include <sys/mman.h>
+
 #include "defs.hpp"
 #include "ir/type.hpp"
+#include "runtime/gc/gc_threads.hpp"
+#include "runtime/gc/major_heap.hpp"
+#include "runtime/gc/mark_bitmap.hpp"
+#include "runtime/gc/nursery.hpp"
+#include "runtime/gc/page_space.hpp"
+#include "runtime/gc/safepoint.hpp"
+#include "runtime/gc/store_buffer.hpp"
+#include "runtime/trace.hpp"
+#include "tools/work_stealing_deque.hpp"
 
 namespace rulejit {
 
-template <size_t ObjSize = sizeof(u64)>
-struct alignas(PageSize) Page {
-    static_assert(ObjSize % sizeof(u64) == 0);
-    static_assert(ObjSize != 0);
-    static_assert(PageSize / ObjSize > 2);
-    
-    struct alignas(ObjSize) Obj {
-        u8 bytes[ObjSize];
-        template <typename T>
-        T& as() { return *std::launder(reinterpret_cast<T*>(bytes)); }
-    } data[PageSize / ObjSize];
-
-    /**
-     * @brief init data as a free list; first 'offset' object is reserved.
-     * 
-     * @param offset 
-     * @return void* pointer to first chunk
-     */
-    void* initFreeList(usize offset = 1) {
-        // TODO:
-        void* tmp = nullptr;
-        for (usize i = offset; i < PageSize / ObjSize; ++i) {
-            data[i].template as<void*>() = tmp;
-            tmp = reinterpret_cast<void*>(&data[i]);
-        }
-        return tmp;
-    }
-};
-
-struct MinorPageInfo {
-    bool isMinorGcMoveTarget;
-};
-
-// template <size_t ObjSize = sizeof(u64)>
-// struct FreeList {
-//     // static_assert((ObjSize & (ObjSize - 1)) == 0, "ObjSize should fit 2^n");
-//     struct Chunk {
-//         Page<ObjSize>::Obj* free;
-//         std::unique_ptr<Page<ObjSize>> storage;
-//         std::bitset<PageSize / ObjSize> allocated;
-//         Chunk() {}
-//     };
-// };
-
 namespace helper {
 
-ObjHeader& getHeader(reg* objPtr) {
+inline ObjHeader& getHeader(reg* objPtr) {
     return objPtr[-1].as<ObjHeader>();
 }
 
-usize getPageId(usize ptr) {
-    constexpr usize mask = !(PageSize - 1);
+inline usize getPageId(usize ptr) {
+    constexpr usize mask = ~(PageSize - 1);
     return mask & ptr;
 }
 
-reg* getRawPtr(usize ptr) {
+inline reg* getRawPtr(usize ptr) {
     constexpr usize mask = ~(sizeof(usize) - 1);
     return reinterpret_cast<reg*>(ptr & mask);
 }
 
-usize getHackedPtr(reg* ptr, ) {
+/**
+ * @brief tag in low 3 bit of value in pointer slot, object is aligned to reg so pointer (and nullptr) has 000.
+ * small int has 1 in lowest bit and keeps 63 bit, others keep payload in high 61 bit
+ *
+ */
+enum class PtrTag : u8 {
+    kPointer = 0b000,
+    kInt = 0b001,
+    kBool = 0b010,
+    kChar = 0b100,
+    kNone = 0b110,
+};
+
+constexpr usize kTagMask = sizeof(usize) - 1;
+
+// small int range of immediate
+constexpr i64 kMinHackedInt = std::numeric_limits<i64>::min() >> 1;
+constexpr i64 kMaxHackedInt = std::numeric_limits<i64>::max() >> 1;
+
+// value in pointer slot is an immediate, not an object
+inline bool isImmediate(const reg* ptr) {
+    return (usize(ptr) & kTagMask) != 0;
+}
+
+inline PtrTag getTag(const reg* ptr) {
+    usize v = usize(ptr);
+    return (v & 1) ? PtrTag::kInt : static_cast<PtrTag>(v & kTagMask);
+}
 
+/**
+ * @brief immediate of payload, never allocates
+ *
+ * @param payload int keeps low 63 bit, others keep low 61 bit
+ * @param tag should not be kPointer
+ */
+inline reg* getHackedPtr(u64 payload, PtrTag tag) {
+    if (tag == PtrTag::kInt) {
+        return reinterpret_cast<reg*>((payload << 1) | 1);
+    }
+    return reinterpret_cast<reg*>((payload << 3) | u64(tag));
+}
+
+// payload of immediate, int is sign extended
+inline u64 getHackedPayload(const reg* ptr) {
+    if (getTag(ptr) == PtrTag::kInt) {
+        return u64(std::bit_cast<i64>(usize(ptr)) >> 1);
+    }
+    return usize(ptr) >> 3;
 }
 
 }
@@ -101,38 +138,135 @@ usize getHackedPtr(reg* ptr, ) {
  *   3 states: Normal, MinorGC, MajorGC
  * 
  * moves between states:
- *   1. Normal -> MinorGC: if minor storage is nearly full
- *      will call changeState(); rootScanner();
+ *   1. Normal -> MinorGC: if minor storage is full, or singleThreadGcStep() called
+ *      will flip nursery; rootScanner();
+ *   2. MinorGC -> Normal: all objects reachable from roots and card table are evacuated
+ *   3. Normal -> MajorGC: beginMajorGc() called, initial mark pause
+ *   4. MajorGC -> MinorGC -> MajorGC: minor GC may run during major GC
+ *   5. MajorGC -> Normal: after final mark pause (finishMajorMark()), all unmarked major objects are swept
  * 
+ * major GC marks tri-color in MarkBitmap, never writing to objects, mostly concurrent with mutators:
+ *   - initial mark pause runs a minor GC, which shades major objects referenced by roots and survivors
+ *   - marker thread blackens objects through concurrentGcStep(), without looking into nursery. mutators log value
+ *     overwritten (SATB) and objects allocated in major heap are black
+ *   - every minor GC during marking shades major objects referenced by survivors and young objects logged
+ *   - final mark pause drains SATB logs, runs one more minor GC, and finishes marking
+ *   - sweeping is lazy, by concurrentGcStep() and by allocation in major heap
  * 
- * TODO: pointer hack, use low 3 bit to store information
+ * objects in static regions (heap image of snapshot, allocStatic()) are never moved or collected. their pointer
+ * members are roots of major GC, scanned in initial and final mark pause, and remembered if pointing into pages
+ * being evacuated. slots pointing into nursery are recorded by write barrier as other slots out of nursery.
+ * 
+ * compaction (optional, see setCompaction()) evacuates sparse pages of size classes:
+ *   - initial mark pause picks pages by live count of last sweep, they are no longer allocated in
+ *   - slots out of nursery pointing into them are remembered by marker, minor GC and write barrier
+ *   - final mark pause drops pages turning out dense by live bytes in MarkBitmap
+ *   - each compactStep() pause copies a bounded part of live objects, leaving forwarding pointer (kIsMoved),
+ *     updates remembered slots, then runs a minor GC which updates roots and young objects
+ * 
+ * minor GC runs incrementally through singleThreadGcStep(), or stop the world on gcWorkers threads through
+ * collectMinor(). object is claimed by CAS on its header before copied, so workers racing on it agree on one copy.
+ * mutator thread finding nursery full in allocHeapOrCollect() stops other attached mutators at their safepoints
+ * before collecting, see safepoint.hpp.
+ * 
+ * minor objects are allocated in Tlab of each thread, see nursery.hpp.
+ * major objects are allocated in pages of their size class cached by Tlab, see major_heap.hpp, or in their own span
+ * of pages if huge.
+ * slots out of nursery pointing into it are recorded in StoreBuffer of each thread, see store_buffer.hpp.
+ * 
+ * pointer slots (registers, members, roots) may hold tagged immediates instead of objects (small int, bool, char,
+ * None of dynamic / any, see helper::PtrTag), so they never allocate a box. value is classified by its tag before
+ * its address: immediates are never moved, shaded, logged or remembered.
  * 
  */
 struct Memory {
+    Memory() = default;
+    explicit Memory(TypeManager* tm) : tm(tm) {}
+
     /**
-     * @brief alloc object on heap
+     * @brief alloc object on heap, single thread only.
+     * run minor GC if nursery is full
      * 
      * @param t
      * @return reg* 
      */
     reg* allocHeap(TypeToken t) {
-        ObjHeader h = tm->getType(t).headerPrototype();
+        reg* p = allocHeap(local.tlab, t);
+        if (p == nullptr && stage != static_cast<u8>(Stage::kMinorGC)) {
+            collectMinor();
+            p = allocHeap(local.tlab, t);
+        }
+        return p;
+    }
+
+    /**
+     * @brief alloc object on heap from Tlab of current thread, run minor GC if nursery is full.
+     * other attached threads are stopped at their safepoints first, roots of all threads are reported by root
+     * scanner. current thread should be at safepoint too
+     * 
+     * @return reg* nullptr if heap is exhausted
+     */
+    reg* allocHeapOrCollect(Tlab& tl, ObjHeader h) {
+        reg* p = allocHeap(tl, h);
+        if (p == nullptr && stage != static_cast<u8>(Stage::kMinorGC)) {
+            // another thread may be collecting, then nursery is flipped when it returns
+            if (safepoints.stop()) {
+                collectMinor();
+                safepoints.resume();
+            }
+            p = allocHeap(tl, h);
+        }
+        return p;
+    }
+
+    /**
+     * @brief alloc object on heap from Tlab of current thread, thread safe.
+     * data of object is zeroed
+     * 
+     * @return reg* nullptr if nursery is full, GC should run when all threads stopped
+     */
+    reg* allocHeap(Tlab& tl, TypeToken t) {
+        assert(tm->getType(t).shaped && "type without shape (dynamic array) should be allocated by header");
+        return allocHeap(tl, tm->getType(t).headerPrototype());
+    }
+    reg* allocHeap(Tlab& tl, ObjHeader h) {
+        RULEJIT_TRACE(kAlloc, "alloc", h.typeId);
         if (h.hasFlag(ObjHeader::Flags::kHasFinalizer) || 
             h.isBigObject() ||
             getSize(h) >= PageSize) {
                 
-            return allocMajor(h);
+            return allocMajor(tl, h);
         }
-        return allocMinor(h);
+        return allocMinor(tl, h);
     }
 
+    /**
+     * @brief alloc object never moved or collected (e.g. constant shared by sections), single thread only.
+     * data of object is zeroed, finalizer is never run
+     * 
+     * @return reg* nullptr if out of memory
+     */
     reg* allocStatic(ObjHeader h) {
-        return nullptr;
+        h.removeFlag(ObjHeader::Flags::kIsMinorObject);
+        usize n = staticObjectBytes(h);
+        if (staticChunks.empty() || staticChunks.back().size - staticTop < n) {
+            auto& c = staticChunks.emplace_back((std::max(n, kStaticChunkSize) + PageSize - 1) / PageSize * PageSize);
+            if (c.begin == MAP_FAILED) {
+                staticChunks.pop_back();
+                return nullptr;
+            }
+            addStaticRegion(c.begin, c.size);
+            staticTop = 0;
+        }
+        reg* p = reinterpret_cast<reg*>(staticChunks.back().begin + staticTop);
+        staticTop += n;
+        p[0].as<ObjHeader>() = h;
+        return p + 1;
     }
 
     /**
      * @brief register a function to scan GC Root. automatically called
-     * on begin of GC
+     * on begin of GC, it reports roots through scanRoot()
      * 
      * @param f 
      */
@@ -149,52 +283,178 @@ struct Memory {
         root.emplace_back(p);
     }
 
+    /**
+     * @brief root of the GC being started, only called by root scanner
+     * 
+     */
+    void scanRoot(reg** p) {
+        markQueue.push_back(p);
+    }
+
     /**
      * @brief simplified GC can only called in single thread runtime.
-     * may need called multi times
+     * may need called multi times, starts a minor GC if not running
      * must called after registerGcRoot() finished
      * 
      * @return bool is finished
      */
     bool singleThreadGcStep() {
+        std::lock_guard lock{gcLock};
+        if (stage == static_cast<u8>(Stage::kNormal)) {
+            beginMinorGc();
+            return false;
+        }
         if (stage == static_cast<u8>(Stage::kMinorGC)) {
             minorGcStep();
-            return minorGcFinished();
+            bool finished = minorGcFinished();
+            RULEJIT_TRACE(kGcPhase, "minor gc", finished);
+            return finished;
         } else if (stage == static_cast<u8>(Stage::kMajorGC)) {
-
-            return false;
+            // world is stopped between steps, final mark pause is taken when marking converges
+            bool finished = false;
+            if (majorPhase == MajorPhase::kMarking) {
+                if (markStep(kMarkStepBudget)) {
+                    finishMark();
+                }
+            } else if (!evacuation.empty()) {
+                evacuateStep(kCompactStepBytes);
+            } else {
+                finished = sweepStep(kSweepStepBudget);
+            }
+            RULEJIT_TRACE(kGcPhase, "major gc", finished);
+            return finished;
         }
         return true;
     }
 
     /**
      * @brief concurrent GC can called through main thread running.
-     * may need called multi times
+     * may need called multi times, does a bounded piece of marking or sweeping, excluded with minor GC
      * 
-     * @return bool is finished
+     * @return bool is finished: marking converged and finishMajorMark() should be called, or sweeping finished
+     */
+    bool concurrentGcStep() {
+        std::lock_guard lock{gcLock};
+        if (majorPhase == MajorPhase::kIdle) {
+            return true;
+        }
+        if (stage == static_cast<u8>(Stage::kMinorGC)) {
+            // incremental minor GC in progress, objects may be half moved
+            return false;
+        }
+        bool finished = majorPhase == MajorPhase::kMarking ? markStep(kMarkStepBudget) : sweepStep(kSweepStepBudget);
+        RULEJIT_TRACE(kGcPhase, "concurrent major gc", finished);
+        return finished;
+    }
+
+    /**
+     * @brief initial mark pause of major GC, all threads should be stopped
+     * continue with concurrentGcStep() on any thread, then finishMajorMark()
+     * 
+     */
+    void beginMajorGc() {
+        std::lock_guard lock{gcLock};
+        assert(idle() && majorPhase == MajorPhase::kIdle);
+        // remembered set of last evacuation is not maintained through marking
+        while (!evacuation.empty()) {
+            evacuateStep(kCompactStepBytes);
+        }
+        if (compaction) {
+            selectEvacuation();
+        }
+        majorPhase = MajorPhase::kMarking;
+        marking.store(true, std::memory_order_relaxed);
+        // shades major objects referenced by roots and young objects, see finishMinorGc()
+        runMinorGc();
+        markStatic();
+    }
+
+    /**
+     * @brief final mark pause of major GC, all threads should be stopped. sweeping starts after it
+     * 
+     */
+    void finishMajorMark() {
+        std::lock_guard lock{gcLock};
+        assert(majorPhase == MajorPhase::kMarking);
+        finishMark();
+    }
+
+    /**
+     * @brief run a whole major GC, all threads should be stopped
+     * 
+     */
+    void collectMajor() {
+        beginMajorGc();
+        while (!singleThreadGcStep()) {
+        }
+    }
+
+    /**
+     * @brief evacuate sparse pages of major heap picked by major GC, off by default
+     * 
+     */
+    void setCompaction(bool on) {
+        compaction = on;
+    }
+
+    /**
+     * @brief compaction pause, all threads should be stopped. copies about kCompactStepBytes of live objects
+     * out of pages picked by last major GC, then runs a minor GC to update roots and young objects
+     * 
+     * @return bool no page left to evacuate
      */
-    bool concurrentGcStep() { return false; };
+    bool compactStep() {
+        std::lock_guard lock{gcLock};
+        assert(stage != static_cast<u8>(Stage::kMinorGC));
+        // remembered set is complete after final mark
+        if (majorPhase != MajorPhase::kMarking && !evacuation.empty()) {
+            evacuateStep(kCompactStepBytes);
+        }
+        return evacuation.empty();
+    }
+    bool compactionPending() const {
+        return evacuating.load(std::memory_order_relaxed);
+    }
+
+    // major heap grew enough since last major GC, embedder should start one
+    bool majorGcWanted() const {
+        return majorPhase == MajorPhase::kIdle && majorBytes.load(std::memory_order_relaxed) >= majorTrigger;
+    }
+    // bytes of pages held by major heap
+    usize majorHeapBytes() const { return majorBytes.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief write pointer from src to dst with write barrier, single thread only
+     * 
+     */
+    void writeWithBarrier(reg** dst, reg* src) {
+        writeWithBarrier(local.buffer, dst, src);
+    }
 
     /**
-     * @brief write pointer from src to dst with write barrier
+     * @brief write pointer from src to dst with write barrier of current thread
      * write barrier:
-     * 1. mark card table
-     * 2. TODO: change color
+     * 1. if major GC is marking, log value overwritten (snapshot at the beginning)
+     * 2. record slot into store buffer, if it points into nursery or pages being evacuated
+     * immediates are neither logged nor recorded
      * 
+     * @param sb StoreBuffer of current thread
      * @param dst pointer to destination field, may get through &(xxx.as<reg*>())
      * @param src value need write
      */
-    void writeWithBarrier(reg** dst, reg* src) {
-        if (src == nullptr || src == *dst) {
-            *dst = src;
-            return;
+    void writeWithBarrier(StoreBuffer& sb, reg** dst, reg* src) {
+        // marker may read the slot concurrently
+        std::atomic_ref<reg*> slot{*dst};
+        reg* old = slot.load(std::memory_order_relaxed);
+        if (marking.load(std::memory_order_relaxed) && !helper::isImmediate(old) &&
+            pages.contains(old)) [[unlikely]] {
+            preWrite(sb, old);
         }
-        if (!isMemTypeMinor(usize(dst))) {
-            if (isMemTypeMinor(usize(src))) {
-                postWrite(dst, src);
-            }
+        if ((isMemTypeMinor(usize(src)) || (evacuating.load(std::memory_order_relaxed) && inEvacuation(src))) &&
+            !isMemTypeMinor(usize(dst)) && src != old) [[unlikely]] {
+            postWrite(sb, dst);
         }
-        *dst = src;
+        slot.store(src, std::memory_order_relaxed);
     }
 
     /**
@@ -206,7 +466,7 @@ struct Memory {
      * @return reg* 
      */
     reg* readWithBarrier(reg** src) {
-        if (stage != static_cast<u8>(Stage::kMinorGC)) {
+        if (stage != static_cast<u8>(Stage::kMinorGC) || *src == nullptr || helper::isImmediate(*src)) {
             return *src;
         }
         ObjHeader h = helper::getHeader(*src);
@@ -215,84 +475,885 @@ struct Memory {
         }
         return *src;
     }
-private:
 
     /**
-     * @brief hold pointers to storage may pointed Minor object
+     * @brief size of object in byte, not contains header
+     * 
+     */
+    usize objectSize(reg* objPtr) {
+        return getSize(helper::getHeader(objPtr));
+    }
+
+    /**
+     * @brief call func with address of each pointer member of object
      * 
      */
-    std::unordered_set<reg**> cardTable;
+    template <typename F>
+        requires std::invocable<F, reg**>
+    void forEachPointerMember(reg* objPtr, F&& func) {
+        callWithPointerMember(objPtr, std::forward<F>(func));
+    }
+
+    /**
+     * @brief manage [begin, begin + size) as static memory (e.g. heap image of snapshot), objects in it never
+     * move or be collected. begin and size should be aligned to PageSize, single thread only
+     * objects are laid back to back from begin, each header followed by its data aligned to reg, the rest is zeroed
+     * 
+     */
+    void addStaticRegion(void* begin, usize size) {
+        assert(usize(begin) % PageSize == 0 && size % PageSize == 0);
+        auto r = std::pair{usize(begin), usize(begin) + size};
+        staticRegions.insert(std::upper_bound(staticRegions.begin(), staticRegions.end(), r), r);
+    }
+    void removeStaticRegion(void* begin, usize size) {
+        std::erase(staticRegions, std::pair{usize(begin), usize(begin) + size});
+    }
+
+    bool idle() const {
+        return stage == static_cast<u8>(Stage::kNormal);
+    }
+
+    /**
+     * @brief run a whole minor GC, all threads should be stopped
+     * parallel on gcWorkers threads if more than one, caller is one of them
+     * 
+     */
+    void collectMinor() {
+        std::lock_guard lock{gcLock};
+        runMinorGc();
+    }
+
+    /**
+     * @brief threads used by collectMinor(), caller included. helper threads are created on next GC
+     * 
+     */
+    void setGcWorkers(usize n) {
+        assert(stage != static_cast<u8>(Stage::kMinorGC));
+        gcWorkers = std::max<usize>(n, 1);
+    }
+
+    // bytes allocated in nursery since last minor GC, survivors included
+    usize nurseryUsed() const { return nursery.used(); }
+
+    /**
+     * @brief current thread runs managed code from now on, and polls safepointRequested() at its safepoints.
+     * see safepoint.hpp
+     * 
+     */
+    void attachMutator() { safepoints.attach(); }
+    void detachMutator() { safepoints.detach(); }
+    bool safepointRequested() const { return safepoints.requested(); }
+    // current thread stops until GC requested by another one finished
+    void parkAtSafepoint() { safepoints.park(); }
+
+    /**
+     * @brief stop attached threads at their safepoints, for GC started by embedder (e.g. collectMajor())
+     * 
+     * @return bool false if GC of another thread ran instead, world is not stopped then
+     */
+    bool stopMutators() { return safepoints.stop(); }
+    void resumeMutators() { safepoints.resume(); }
+
+    // cached pages are given back
+    void detach(Tlab& tl) {
+        std::lock_guard lock{mutatorLock};
+        std::erase(tlabs, &tl);
+        std::lock_guard heapLock{majorLock};
+        for (auto& fc : tl.major) {
+            if (fc.page != nullptr) {
+                fc.page->freeList = fc.head;
+                (fc.head != nullptr ? classes[fc.page->sizeClass].available : classes[fc.page->sizeClass].full)
+                    .push_back(fc.page);
+            }
+            fc = {};
+        }
+    }
+    // recorded slots and logged values are kept
+    void detach(StoreBuffer& sb) {
+        std::lock_guard lock{mutatorLock};
+        std::erase(storeBuffers, &sb);
+        if (sb.block != nullptr) {
+            usize size = sb.top - sb.block.get();
+            filled.push_back({std::move(sb.block), size});
+        }
+        satbFilled.insert(satbFilled.end(), sb.satb.get(), sb.satbTop);
+    }
+
+private:
+
+    // full blocks of StoreBuffer, and count of slots used
+    struct FilledBlock {
+        StoreBuffer::Block block;
+        usize size;
+    };
+    std::vector<FilledBlock> filled;
+    std::vector<StoreBuffer::Block> freeBlocks;
+    // slots recorded before this minor GC, and ones still pointing into nursery after evacuated
+    std::vector<reg**> remembered, kept;
     std::deque<reg**> markQueue;
+    // slots processed by one minorGcStep()
+    static constexpr usize kMinorGcStepBudget = 256;
+
     bool minorGcFinished() {
-        // size of card table is stable, call cardTable.empty() before markStack.empty() to make branch prediction happy. TODO: test
-        return cardTable.empty() && markQueue.empty();
+        return remembered.empty() && markQueue.empty();
+    }
+    void beginMinorGc() {
+        stage = static_cast<u8>(Stage::kMinorGC);
+        // survivors are copied into the empty semispace, mutators continue behind them
+        nursery.flip();
+        for (auto* tl : tlabs) {
+            tl->reset();
+        }
+        gcTlab.reset();
+        if (rootScanner) {
+            rootScanner();
+        }
+        markQueue.insert(markQueue.end(), root.begin(), root.end());
+        if (marking.load(std::memory_order_relaxed)) {
+            // young objects overwritten during marking are roots, their members are shaded when evacuated
+            drainSatb(true);
+            for (auto& p : satbYoung) {
+                markQueue.push_back(&p);
+            }
+        }
+        // drain store buffers, blocks are linear
+        auto take = [this](reg*** begin, reg*** end) { remembered.insert(remembered.end(), begin, end); };
+        for (auto& f : filled) {
+            take(f.block.get(), f.block.get() + f.size);
+            freeBlocks.push_back(std::move(f.block));
+        }
+        filled.clear();
+        for (auto* sb : storeBuffers) {
+            take(sb->block.get(), sb->top);
+            sb->reset();
+        }
     }
     void minorGcStep() {
-        reg** now;
-        if (!markQueue.empty()) {
-            now = markQueue.front();
+        usize budget = kMinorGcStepBudget;
+        auto push = [this](reg** tar) {
+            markQueue.push_back(tar);
+            if (!isMemTypeMinor(usize(tar))) {
+                // member of promoted object
+                kept.push_back(tar);
+            }
+        };
+        bool shading = marking.load(std::memory_order_relaxed);
+        for (; budget != 0 && !remembered.empty(); --budget) {
+            reg** now = remembered.back();
+            remembered.pop_back();
+            reg* p = evacuate(gcTlab, now, push);
+            if (isMemTypeMinor(usize(p))) {
+                kept.push_back(now);
+                continue;
+            }
+            if (shading) {
+                shade(p);
+            }
+            if (needsFixing(now, p)) {
+                evacRemembered.push_back(now);
+            }
+        }
+        for (; budget != 0 && !markQueue.empty(); --budget) {
+            reg** now = markQueue.front();
             markQueue.pop_front();
+            reg* p = evacuate(gcTlab, now, push);
+            if (shading) {
+                shade(p);
+            }
+            if (needsFixing(now, p)) {
+                evacRemembered.push_back(now);
+            }
         }
-        assert(!cardTable.empty());
-        now = *cardTable.begin();
-        cardTable.erase(cardTable.begin());
-
-        // 3 cases for abort mark
-        if (!isMemTypeMinor(usize(*now))) {
-            // 1. not pointed a minor object (changed after mark)
-            return;
+        if (minorGcFinished()) {
+            finishMinorGc();
+        }
+    }
+    void finishMinorGc() {
+        // slots still pointing to survivors in nursery are recorded again, once each
+        std::sort(kept.begin(), kept.end());
+        kept.erase(std::unique(kept.begin(), kept.end()), kept.end());
+        for (auto* slot : kept) {
+            if (isMemTypeMinor(usize(*slot))) {
+                postWrite(local.buffer, slot);
+            }
         }
-        if (helper::getHeader(*now).hasFlag(ObjHeader::Flags::kIsMoved)) {
-            // 2. target object already moved and this pointer is not modified
-            *now = (**now).as<reg*>();
+        kept.clear();
+        satbYoung.clear();
+        stage = static_cast<u8>(majorPhase == MajorPhase::kIdle ? Stage::kNormal : Stage::kMajorGC);
+    }
+    // whole minor GC, gcLock should be held
+    void runMinorGc() {
+        assert(stage != static_cast<u8>(Stage::kMinorGC));
+        if (gcWorkers > 1) {
+            parallelMinorGc();
             return;
         }
-        if (getMinorPageInfo(helper::getPageId(usize(*now))).isMinorGcMoveTarget) {
+        beginMinorGc();
+        while (stage == static_cast<u8>(Stage::kMinorGC)) {
+            minorGcStep();
+        }
+    }
+
+    /**
+     * @brief copy object *slot points to out of from space if not yet, and update slot. thread safe
+     * 
+     * @param tl Tlab survivor is copied into
+     * @param scan called with each pointer member of the copy, if this call made it
+     * @return reg* value of slot after evacuated
+     */
+    template <typename F>
+    reg* evacuate(Tlab& tl, reg** slot, F&& scan) {
+        // same slot may be recorded twice and evacuated by two workers, both write the same value
+        std::atomic_ref<reg*> ref{*slot};
+        reg* obj = ref.load(std::memory_order_relaxed);
+        if (helper::isImmediate(obj)) {
+            return obj;
+        }
+        // 3 cases for abort mark
+        if (!nursery.inFromSpace(obj)) {
+            // 1. not pointed a minor object (changed after mark), or
             // 3. target object already moved and this pointer already modified
+            if (forwarding && inEvacuation(obj) && helper::getHeader(obj).hasFlag(ObjHeader::Flags::kIsMoved)) {
+                // major object evacuated by compaction
+                obj = obj[0].as<reg*>();
+                ref.store(obj, std::memory_order_relaxed);
+            }
+            return obj;
+        }
+        // 2. target object already moved and this pointer is not modified, handled in moveMinor
+        auto [p, copied] = moveMinor(tl, obj);
+        ref.store(p, std::memory_order_relaxed);
+        if (copied) {
+            callWithPointerMember(p, scan);
+        }
+        return p;
+    }
+
+    // slots claimed by a worker of parallel minor GC at once
+    static constexpr usize kClaimSize = 64;
+    // state of one worker of parallel minor GC
+    struct Scavenger {
+        // slots found in survivors copied by this worker
+        tools::WorkStealingDeque<reg**> queue;
+        Tlab tlab;
+        std::vector<reg**> kept;
+        // major objects referenced, shaded after all workers finished
+        std::vector<reg*> gray;
+        // slots pointing into pages being evacuated
+        std::vector<reg**> fixups;
+    };
+
+    void parallelMinorGc() {
+        beginMinorGc();
+        if (gcThreads == nullptr || gcThreads->size() != gcWorkers) {
+            gcThreads = std::make_unique<GcThreads>(gcWorkers);
+            scavengers.clear();
+            for (usize i = 0; i < gcWorkers; ++i) {
+                scavengers.push_back(std::make_unique<Scavenger>());
+            }
+        }
+        rootSlots.assign(markQueue.begin(), markQueue.end());
+        markQueue.clear();
+        claimCursor.store(0, std::memory_order_relaxed);
+        idleScavengers.store(0, std::memory_order_relaxed);
+        gcThreads->run([this](usize id) { scavenge(id); });
+        rootSlots.clear();
+        remembered.clear();
+        for (auto& s : scavengers) {
+            kept.insert(kept.end(), s->kept.begin(), s->kept.end());
+            s->kept.clear();
+            for (reg* p : s->gray) {
+                shade(p);
+            }
+            s->gray.clear();
+            evacRemembered.insert(evacRemembered.end(), s->fixups.begin(), s->fixups.end());
+            s->fixups.clear();
+        }
+        finishMinorGc();
+        RULEJIT_TRACE(kGcPhase, "parallel minor gc", gcWorkers);
+    }
+
+    /**
+     * @brief body of worker id: drain own deque, then claim next chunk of roots and remembered slots, then steal
+     * 
+     */
+    void scavenge(usize id) {
+        auto& self = *scavengers[id];
+        auto push = [this, &self](reg** tar) {
+            self.queue.push(tar);
+            if (!isMemTypeMinor(usize(tar))) {
+                // member of promoted object
+                self.kept.push_back(tar);
+            }
+        };
+        bool shading = marking.load(std::memory_order_relaxed);
+        auto visit = [&](reg** now) {
+            reg* p = evacuate(self.tlab, now, push);
+            if (shading && isMemTypeMajor(usize(p))) {
+                self.gray.push_back(p);
+            }
+            if (needsFixing(now, p)) {
+                self.fixups.push_back(now);
+            }
+            return p;
+        };
+        usize total = rootSlots.size() + remembered.size();
+        while (true) {
+            while (auto now = self.queue.pop()) {
+                visit(*now);
+            }
+            if (usize begin = claimCursor.fetch_add(kClaimSize, std::memory_order_relaxed); begin < total) {
+                for (usize i = begin; i < std::min(begin + kClaimSize, total); ++i) {
+                    if (i < rootSlots.size()) {
+                        visit(rootSlots[i]);
+                        continue;
+                    }
+                    reg** now = remembered[i - rootSlots.size()];
+                    if (isMemTypeMinor(usize(visit(now)))) {
+                        self.kept.push_back(now);
+                    }
+                }
+                continue;
+            }
+            if (!steal(id)) {
+                return;
+            }
+        }
+    }
+
+    /**
+     * @brief move one slot from deque of other worker into own one
+     * 
+     * @return bool false if all workers ran out of work, then GC is finished
+     */
+    bool steal(usize id) {
+        usize n = scavengers.size();
+        idleScavengers.fetch_add(1, std::memory_order_acq_rel);
+        while (true) {
+            for (usize i = 1; i < n; ++i) {
+                if (auto now = scavengers[(id + i) % n]->queue.steal()) {
+                    idleScavengers.fetch_sub(1, std::memory_order_acq_rel);
+                    scavengers[id]->queue.push(*now);
+                    return true;
+                }
+            }
+            // worker holding a stolen slot is counted idle until it leaves here, it finishes that slot alone
+            if (idleScavengers.load(std::memory_order_acquire) == n) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    /**
+     * @brief record slot into store buffer, one bump and limit check unless block is full
+     * 
+     */
+    void postWrite(StoreBuffer& sb, reg** dst) {
+        if (sb.top == sb.limit) [[unlikely]] {
+            flush(sb);
+        }
+        *sb.top++ = dst;
+    }
+
+    /**
+     * @brief hand full block of sb to Memory, and give it an empty one
+     * 
+     */
+    void flush(StoreBuffer& sb) {
+        std::lock_guard lock{mutatorLock};
+        if (sb.owner == nullptr) {
+            sb.owner = this;
+            storeBuffers.push_back(&sb);
+        }
+        if (sb.block != nullptr) {
+            filled.push_back({std::move(sb.block), StoreBuffer::kSize});
+        }
+        if (!freeBlocks.empty()) {
+            sb.block = std::move(freeBlocks.back());
+            freeBlocks.pop_back();
+        } else {
+            sb.block = std::make_unique<reg**[]>(StoreBuffer::kSize);
+        }
+        sb.top = sb.block.get();
+        sb.limit = sb.top + StoreBuffer::kSize;
+    }
+
+    /**
+     * @brief log value overwritten during marking into SATB log of sb
+     * 
+     */
+    void preWrite(StoreBuffer& sb, reg* old) {
+        if (sb.satbTop == sb.satbLimit) [[unlikely]] {
+            flushSatb(sb);
+        }
+        *sb.satbTop++ = old;
+    }
+    void flushSatb(StoreBuffer& sb) {
+        std::lock_guard lock{mutatorLock};
+        if (sb.owner == nullptr) {
+            sb.owner = this;
+            storeBuffers.push_back(&sb);
+        }
+        if (sb.satb == nullptr) {
+            sb.satb = std::make_unique<reg*[]>(StoreBuffer::kSize);
+        } else {
+            satbFilled.insert(satbFilled.end(), sb.satb.get(), sb.satbTop);
+        }
+        sb.satbTop = sb.satb.get();
+        sb.satbLimit = sb.satbTop + StoreBuffer::kSize;
+    }
+
+    /**
+     * @brief take logged values: major objects are shaded, young ones wait for next minor GC in satbYoung
+     * 
+     * @param all also take partial logs of threads, which should be stopped
+     */
+    void drainSatb(bool all) {
+        std::vector<reg*> log;
+        {
+            std::lock_guard lock{mutatorLock};
+            log.swap(satbFilled);
+            if (all) {
+                for (auto* sb : storeBuffers) {
+                    log.insert(log.end(), sb->satb.get(), sb->satbTop);
+                    sb->satbTop = sb->satb.get();
+                }
+            }
+        }
+        for (reg* p : log) {
+            if (isMemTypeMinor(usize(p))) {
+                satbYoung.push_back(p);
+            } else {
+                shade(p);
+            }
+        }
+    }
+
+    /**
+     * @brief white major object becomes gray, others are ignored
+     * called by marker and minor GC, which are serialized by gcLock
+     * 
+     */
+    void shade(reg* p) {
+        if (!isMemTypeMajor(usize(p))) {
             return;
         }
+        // gray and black are both marked, gray ones are in queue
+        if (!marks.mark(p - 1)) {
+            grayQueue.push_back(p);
+        }
+    }
 
-        *now = moveMinor(*now);
-        callWithPointerMember(*now, [this](reg** tar){
-            markQueue.push_back(tar);
+    /**
+     * @brief blacken up to budget gray objects. young members are skipped, they are scanned by minor GC
+     * 
+     * @return bool gray queue is empty
+     */
+    bool markStep(usize budget) {
+        drainSatb(false);
+        for (; budget != 0 && !grayQueue.empty(); --budget) {
+            reg* now = grayQueue.back();
+            grayQueue.pop_back();
+            marks.setLive(now - 1, objectBytes(helper::getHeader(now)));
+            callWithPointerMember(now, [this](reg** tar) {
+                // mutator may write the slot concurrently
+                reg* p = std::atomic_ref<reg*>{*tar}.load(std::memory_order_relaxed);
+                shade(p);
+                if (needsFixing(tar, p)) {
+                    evacRemembered.push_back(tar);
+                }
+            });
+        }
+        return grayQueue.empty();
+    }
+
+    /**
+     * @brief final mark pause, world is stopped
+     * 
+     */
+    void finishMark() {
+        drainSatb(true);
+        // young objects may hide references from marker, shade through all survivors once more
+        runMinorGc();
+        markStatic();
+        while (!markStep(~usize(0))) {
+        }
+        marking.store(false, std::memory_order_relaxed);
+        majorPhase = MajorPhase::kSweeping;
+        std::lock_guard lock{mutatorLock};
+        purgeRemembered();
+        std::lock_guard heapLock{majorLock};
+        // pages picked by initial mark may have been filled since their last sweep
+        std::erase_if(evacuation, [this](PageHeader* page) {
+            if (marks.liveBytes(page, PageSize) < kEvacuateLiveBytes) {
+                return false;
+            }
+            pages.info(page).evacuating = false;
+            classes[page->sizeClass].available.push_back(page);
+            return true;
         });
+        evacuating.store(!evacuation.empty(), std::memory_order_relaxed);
+        // objects allocated from now on are white and not swept in this cycle
+        sweepList.swap(hugeObjects);
+        sweepCursor = 0;
+        liveBytes = 0;
+        // all pages are swept before allocated again, free objects in cached pages are found by sweeping
+        for (auto* tl : tlabs) {
+            for (auto& fc : tl->major) {
+                if (fc.page != nullptr) {
+                    classes[fc.page->sizeClass].unswept.push_back(fc.page);
+                }
+                fc = {};
+            }
+        }
+        for (auto& c : classes) {
+            c.unswept.insert(c.unswept.end(), c.available.begin(), c.available.end());
+            c.unswept.insert(c.unswept.end(), c.full.begin(), c.full.end());
+            c.available.clear();
+            c.full.clear();
+            for (auto* page : c.unswept) {
+                page->swept = false;
+            }
+        }
     }
 
     /**
-     * @brief post write event to mark
-     * TODO: run on another thread
+     * @brief drop recorded slots in major objects not marked, their memory is reused after sweeping
+     * world is stopped, mutatorLock should be held
      * 
      */
-    void postWrite(reg** dst, reg* src) {
-        cardTable.emplace(dst);
+    void purgeRemembered() {
+        auto dead = [this](reg** slot) {
+            switch (getMemType(usize(slot))) {
+            case MemType::kMajor:
+                return !marks.isMarked(pageHeaderOf(slot)->slotOf(slot));
+            case MemType::kHuge:
+                return !marks.isMarked(hugeObjectOf(usize(slot)) - 1);
+            default:
+                return false;
+            }
+        };
+        removeRecorded(dead);
+        std::erase_if(evacRemembered, dead);
+        std::sort(evacRemembered.begin(), evacRemembered.end());
+        evacRemembered.erase(std::unique(evacRemembered.begin(), evacRemembered.end()), evacRemembered.end());
+    }
+    // drop slots in store buffers, mutatorLock should be held
+    template <typename F>
+    void removeRecorded(F&& pred) {
+        for (auto& f : filled) {
+            f.size = std::remove_if(f.block.get(), f.block.get() + f.size, pred) - f.block.get();
+        }
+        for (auto* sb : storeBuffers) {
+            sb->top = std::remove_if(sb->block.get(), sb->top, pred);
+        }
+    }
+
+    /**
+     * @brief sweep up to budget objects, finishes major GC if all swept
+     * 
+     * @return bool major GC finished
+     */
+    bool sweepStep(usize budget) {
+        std::lock_guard lock{majorLock};
+        bool pagesSwept = true;
+        for (auto& c : classes) {
+            for (; budget != 0 && !c.unswept.empty(); --budget) {
+                PageHeader* page = c.unswept.back();
+                c.unswept.pop_back();
+                sweepPage(page);
+            }
+            pagesSwept &= c.unswept.empty();
+        }
+        if (!sweepHuge(budget) || !pagesSwept) {
+            return false;
+        }
+        sweepList.clear();
+        sweepCursor = 0;
+        majorTrigger = std::max(kMinMajorTrigger, liveBytes * 2);
+        majorPhase = MajorPhase::kIdle;
+        if (stage == static_cast<u8>(Stage::kMajorGC)) {
+            stage = static_cast<u8>(Stage::kNormal);
+        }
+        return true;
+    }
+    /**
+     * @brief unmarked huge objects are freed and marks of others are cleared, majorLock should be held
+     * 
+     * @return bool all swept
+     */
+    bool sweepHuge(usize budget) {
+        for (; budget != 0 && sweepCursor != sweepList.size(); --budget) {
+            reg* now = sweepList[sweepCursor++];
+            if (!marks.isMarked(now - 1)) {
+                freeHuge(now);
+                continue;
+            }
+            usize n = hugePages(helper::getHeader(now)) * PageSize;
+            marks.clear(now - 1, n);
+            hugeObjects.push_back(now);
+            liveBytes += n;
+        }
+        return sweepCursor == sweepList.size();
+    }
+    /**
+     * @brief rebuild free list of page, and put it in list of its state. majorLock should be held
+     * 
+     */
+    void sweepPage(PageHeader* page) {
+        liveBytes += marks.liveBytes(page, PageSize);
+        usize live = 0;
+        visitSizeClass(page->sizeClass,
+                       [&](auto n) { live = reinterpret_cast<Page<decltype(n)::value>*>(page)->sweep(marks); });
+        if (live == 0) {
+            givePage(reinterpret_cast<u8*>(page));
+        } else {
+            (page->freeList != nullptr ? classes[page->sizeClass].available : classes[page->sizeClass].full)
+                .push_back(page);
+        }
+    }
+
+    /**
+     * @brief pick sparse available pages by live count of last sweep, they are not allocated in until evacuated
+     * world is stopped
+     * 
+     */
+    void selectEvacuation() {
+        std::lock_guard lock{majorLock};
+        std::vector<PageHeader*> sparse;
+        for (auto& c : classes) {
+            for (auto* page : c.available) {
+                if (page->live * kSizeClasses[page->sizeClass] < kEvacuateLiveBytes) {
+                    sparse.push_back(page);
+                }
+            }
+        }
+        std::sort(sparse.begin(), sparse.end(), [](PageHeader* a, PageHeader* b) {
+            return a->live * kSizeClasses[a->sizeClass] < b->live * kSizeClasses[b->sizeClass];
+        });
+        sparse.resize(std::min(sparse.size(), kMaxEvacuatePages));
+        for (auto* page : sparse) {
+            pages.info(page).evacuating = true;
+        }
+        for (auto& c : classes) {
+            std::erase_if(c.available, [this](PageHeader* page) { return pages.info(page).evacuating; });
+        }
+        // sparsest ones are evacuated first
+        evacuation.assign(sparse.rbegin(), sparse.rend());
+        evacuating.store(!evacuation.empty(), std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief evacuate pages until budget byte of live objects are copied, world is stopped
+     * pages are freed after all slots pointing into them are updated
+     * 
+     */
+    void evacuateStep(usize budget) {
+        std::vector<PageHeader*> chunk;
+        for (usize copied = 0; copied < budget && !evacuation.empty();) {
+            chunk.push_back(evacuation.back());
+            evacuation.pop_back();
+            copied += marks.liveBytes(chunk.back(), PageSize);
+        }
+        // pages all objects moved out of
+        usize done = 0;
+        bool failed = false;
+        for (auto* page : chunk) {
+            visitSizeClass(page->sizeClass, [&](auto n) {
+                auto* pg = reinterpret_cast<Page<decltype(n)::value>*>(page);
+                for (usize i = pg->kReserved; i < pg->kObjects && !failed; ++i) {
+                    if (marks.isMarked(&pg->data[i])) {
+                        failed = !moveMajor(reinterpret_cast<reg*>(&pg->data[i]) + 1);
+                    }
+                }
+            });
+            if (failed) {
+                break;
+            }
+            ++done;
+        }
+        // old copies are dropped, slots to moved objects are updated, others wait for their pages
+        std::erase_if(evacRemembered, [this](reg** slot) {
+            if (inMovedObject(slot)) {
+                return true;
+            }
+            reg* p = *slot;
+            if (!inEvacuation(p)) {
+                return true;
+            }
+            if (helper::getHeader(p).hasFlag(ObjHeader::Flags::kIsMoved)) {
+                *slot = p[0].as<reg*>();
+                return true;
+            }
+            return false;
+        });
+        {
+            std::lock_guard lock{mutatorLock};
+            removeRecorded([this](reg** slot) { return inMovedObject(slot); });
+        }
+        // roots and young objects are updated by evacuate()
+        forwarding = true;
+        runMinorGc();
+        forwarding = false;
+        std::lock_guard lock{majorLock};
+        if (failed) {
+            // PageSpace is exhausted, pages left are allocated in again, moved objects in them are garbage
+            chunk.insert(chunk.end(), evacuation.begin(), evacuation.end());
+            evacuation.clear();
+        }
+        for (usize i = 0; i < chunk.size(); ++i) {
+            pages.info(chunk[i]).evacuating = false;
+            if (i < done) {
+                marks.clear(chunk[i], PageSize);
+                givePage(reinterpret_cast<u8*>(chunk[i]));
+            } else {
+                sweepPage(chunk[i]);
+            }
+        }
+        evacuating.store(!evacuation.empty(), std::memory_order_relaxed);
+        RULEJIT_TRACE(kGcPhase, "compact", done);
+    }
+
+    /**
+     * @brief copy object out of page being evacuated, and leave forwarding pointer in old one
+     * members of copy pointing into nursery or pages being evacuated are remembered
+     * 
+     * @return bool false if PageSpace is exhausted
+     */
+    bool moveMajor(reg* objPtr) {
+        auto& h = helper::getHeader(objPtr);
+        reg* p = allocMajor(gcTlab, h);
+        if (p == nullptr) {
+            return false;
+        }
+        std::memcpy(p, objPtr, getSize(h));
+        callWithPointerMember(p, [this](reg** tar) {
+            if (isMemTypeMinor(usize(*tar))) {
+                postWrite(local.buffer, tar);
+            } else if (inEvacuation(*tar)) {
+                evacRemembered.push_back(tar);
+            }
+        });
+        h.addFlag(ObjHeader::Flags::kIsMoved);
+        objPtr[0].as<reg*>() = p;
+        return true;
+    }
+
+    bool inEvacuation(const void* p) {
+        return !helper::isImmediate(static_cast<const reg*>(p)) && pages.contains(p) && pages.info(p).evacuating;
+    }
+    // slot out of nursery and roots pointing into page being evacuated, should be remembered
+    bool needsFixing(reg** slot, reg* p) {
+        if (!evacuating.load(std::memory_order_relaxed) || !inEvacuation(p)) {
+            return false;
+        }
+        MemType t = getMemType(usize(slot));
+        return t == MemType::kMajor || t == MemType::kHuge || t == MemType::kStatic;
+    }
+    // slot is in old copy of object moved by compaction
+    bool inMovedObject(reg** slot) {
+        if (!inEvacuation(slot)) {
+            return false;
+        }
+        reg* objPtr = reinterpret_cast<reg*>(usize(pageHeaderOf(slot)->slotOf(slot))) + 1;
+        return helper::getHeader(objPtr).hasFlag(ObjHeader::Flags::kIsMoved);
     }
-    // void postWriteCancelled(reg** dst) {
-    //     cardTable.erase(reinterpret_cast<reg*>(dst));
-    // }
 
     enum class Stage {
         kNormal = 1,
         kMinorGC = 2,
         kMajorGC = 4,
     };
-    u8 stage = static_cast<u8>(Stage::kNormal);
-
-    enum class MemType {
-        kUnmanaged,
-        kMinor,
-        kMajor,
-        kHuge,
-        kStatic,
+    // written by GC only, mutators may read it
+    std::atomic<u8> stage = static_cast<u8>(Stage::kNormal);
+
+    enum class MajorPhase : u8 {
+        kIdle,
+        kMarking,
+        kSweeping,
     };
-    struct PageInfo {
-        MemType type;
+    // written under gcLock, read by majorGcWanted()
+    std::atomic<MajorPhase> majorPhase = MajorPhase::kIdle;
+    // SATB barrier is on
+    std::atomic<bool> marking = false;
+    // serializes major GC steps with minor GC
+    std::mutex gcLock;
+    // stops mutator threads before minor GC requested by one of them
+    Safepoints safepoints;
+    // objects shaded but not scanned
+    std::vector<reg*> grayQueue;
+    // flushed SATB logs, guarded by mutatorLock; young values logged, roots of next minor GC
+    std::vector<reg*> satbFilled, satbYoung;
+    // objects processed by one major GC step
+    static constexpr usize kMarkStepBudget = 256;
+    static constexpr usize kSweepStepBudget = 64;
+    // swept by allocation in major heap
+    static constexpr usize kLazySweepBudget = 4;
+
+    // major heap, guarded by majorLock. sweepList holds huge objects allocated before final mark
+    std::mutex majorLock;
+    std::vector<reg*> hugeObjects, sweepList;
+    // each page of a class not in PagePool is in one of the lists, or cached by one Tlab
+    struct SizeClass {
+        // swept, with free objects
+        std::vector<PageHeader*> available;
+        // swept, no free object
+        std::vector<PageHeader*> full;
+        // not swept after final mark
+        std::vector<PageHeader*> unswept;
+    };
+    std::array<SizeClass, kSizeClasses.size()> classes;
+    usize sweepCursor = 0;
+    usize liveBytes = 0;
+    std::atomic<usize> majorBytes = 0;
+    static constexpr usize kMinMajorTrigger = 64 << 20;
+    usize majorTrigger = kMinMajorTrigger;
+
+    // compaction, state below is guarded by gcLock
+    bool compaction = false;
+    // pages picked by selectEvacuation() and not evacuated yet
+    std::vector<PageHeader*> evacuation;
+    // slots out of nursery and roots pointing into pages of evacuation
+    std::vector<reg**> evacRemembered;
+    // evacuation is not empty, read by write barrier
+    std::atomic<bool> evacuating = false;
+    // minor GC updates slots pointing to major objects moved
+    bool forwarding = false;
+    // pages with less live bytes are evacuated
+    static constexpr usize kEvacuateLiveBytes = PageSize / 2;
+    static constexpr usize kMaxEvacuatePages = 1024;
+    // live bytes copied by one compaction pause
+    static constexpr usize kCompactStepBytes = 256 << 10;
+
+    // all managed memory except static regions, nursery included
+    PageSpace pages;
+    // mark state of major and huge objects
+    MarkBitmap marks{pages};
+    // [begin, end) out of pages, sorted, few
+    std::vector<std::pair<usize, usize>> staticRegions;
+    // static regions owned by allocStatic(), bump allocated at staticTop of last one
+    struct StaticChunk {
+        explicit StaticChunk(usize size)
+            : begin(static_cast<u8*>(
+                  mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0))),
+              size(size) {}
+        StaticChunk(const StaticChunk&) = delete;
+        auto& operator=(const StaticChunk&) = delete;
+        ~StaticChunk() {
+            if (begin != MAP_FAILED) {
+                munmap(begin, size);
+            }
+        }
+
+        u8* begin;
+        usize size;
     };
-    // TODO: usize(ptr) / PageSize?
-    std::unordered_map<usize, PageInfo> pageMemType;
-    // obj ptr -> info
-    std::map<reg*, PageInfo, std::greater<reg*>> hugeMemType;
+    std::deque<StaticChunk> staticChunks;
+    usize staticTop = 0;
+    static constexpr usize kStaticChunkSize = 16 * PageSize;
 
-    TypeManager* tm;
+    TypeManager* tm = nullptr;
     std::deque<reg**> root;
     std::move_only_function<void()> rootScanner;
 
@@ -300,7 +1361,7 @@ private:
         if (!h.isBigObject()) {
             return h.sizeCompressed * sizeof(u64);
         }
-        return tm->getType(h.typeId).objSize();
+        return tm->getType(TypeToken{h.typeId}).objSize();
     }
     /**
      * @brief get MemType of ptr pointed
@@ -309,88 +1370,328 @@ private:
      * @return MemType of memory which ptr pointed
      */
     MemType getMemType(usize ptr) {
-        if (auto it = pageMemType.find(helper::getPageId(ptr)); it != pageMemType.end()) {
-            return it->second.type;
+        if (pages.contains(reinterpret_cast<void*>(ptr))) [[likely]] {
+            return pages.info(reinterpret_cast<void*>(ptr)).type;
         }
-        if (auto it = hugeMemType.lower_bound(std::bit_cast<reg*>(ptr)); it != hugeMemType.end()) [[likely]] {
-            // TODO: test, lower_bound?
-            auto size = getSize((it->first)[-1].as<ObjHeader>());
-            if (size + usize(it->first) > ptr) {
-                return MemType::kHuge;
-            }
+        auto it = std::upper_bound(staticRegions.begin(), staticRegions.end(), std::pair{ptr, ~usize(0)});
+        if (it != staticRegions.begin() && ptr < (--it)->second) {
+            return MemType::kStatic;
         }
-        assert(false);
         return MemType::kUnmanaged;
     }
+    /**
+     * @brief huge object holding ptr
+     * 
+     * @param ptr into object, MemType of it should be kHuge
+     */
+    reg* hugeObjectOf(usize ptr) {
+        assert(getMemType(ptr) == MemType::kHuge);
+        // header is at begin of span
+        return reinterpret_cast<reg*>(pages.spanOf(reinterpret_cast<void*>(ptr))) + 1;
+    }
+    // false for immediates, as isMemTypeMajor()
     bool isMemTypeMinor(usize ptr) {
-        // return helper::getHeader(reinterpret_cast<reg*>(ptr)).hasFlag(ObjHeader::Flags::kMinorObject);
-        if (auto it = pageMemType.find(helper::getPageId(ptr)); it != pageMemType.end()) {
-            return it->second.type == MemType::kMinor;
-        }
-        return false;
+        return (ptr & helper::kTagMask) == 0 && nursery.contains(reinterpret_cast<void*>(ptr));
     }
-    MinorPageInfo& getMinorPageInfo(usize pageId) {
-        return *std::launder(reinterpret_cast<MinorPageInfo*>(pageId));
+    // collected by major GC
+    bool isMemTypeMajor(usize ptr) {
+        auto* p = reinterpret_cast<void*>(ptr);
+        if ((ptr & helper::kTagMask) != 0 || !pages.contains(p)) {
+            return false;
+        }
+        MemType t = pages.info(p).type;
+        return t == MemType::kMajor || t == MemType::kHuge;
     }
 
+    // age of object being copied by another thread, forwarding pointer is not written yet
+    static constexpr u8 kForwarding = 0xff;
+
     /**
-     * @brief move minor object to new storage.
-     * SHOULDNOT called on moved object
+     * @brief move minor object to new storage, or find where it is moved to. thread safe:
+     * header is claimed by CAS before copy, loser waits for forwarding pointer
      * 
+     * @param tl Tlab survivor is copied into
      * @param objPtr 
-     * @return pointer to new object
+     * @return pointer to new object, and whether this call copied it
      */
-    reg* moveMinor(reg* objPtr) {
-        auto h = helper::getHeader(objPtr);
-        assert(!h.hasFlag(ObjHeader::Flags::kIsMoved));
+    std::pair<reg*, bool> moveMinor(Tlab& tl, reg* objPtr) {
+        std::atomic_ref<u64> word{objPtr[-1].as<u64>()};
+        u64 old = word.load(std::memory_order_acquire);
+        ObjHeader h;
+        while (true) {
+            h = std::bit_cast<ObjHeader>(old);
+            if (h.hasFlag(ObjHeader::Flags::kIsMoved)) {
+                while (h.ageOrColor == kForwarding) {
+                    std::this_thread::yield();
+                    h = std::bit_cast<ObjHeader>(word.load(std::memory_order_acquire));
+                }
+                return {objPtr[0].as<reg*>(), false};
+            }
+            ObjHeader claimed = h;
+            claimed.addFlag(ObjHeader::Flags::kIsMoved);
+            claimed.ageOrColor = kForwarding;
+            if (word.compare_exchange_weak(old, std::bit_cast<u64>(claimed), std::memory_order_acquire)) {
+                break;
+            }
+        }
         assert(h.hasFlag(ObjHeader::Flags::kIsMinorObject));
 
-        reg *p;
+        reg *p = nullptr;
         // TODO: extract config
-        if (h.ageOrColor >= 5) {
-            p = allocMajor(h);
-            helper::getHeader(p).setColor(ObjHeader::Color::kWhite);
+        if (h.ageOrColor >= 5 && (p = allocMajor(tl, h.getPrototype())) != nullptr) {
+            // marked by allocMajor during marking
         } else {
-            p = allocMinor(h);
-            helper::getHeader(p).ageOrColor++;
+            // semispace holds all survivors, never fails
+            p = allocMinor(tl, h);
+            assert(p != nullptr);
+            helper::getHeader(p).ageOrColor = std::min<u8>(h.ageOrColor + 1, 5);
         }
 
-        auto size = getSize(h);
-        for (usize i = 0; i < size; ++i) {
-            p[i] = objPtr[i];
-        }
+        std::memcpy(p, objPtr, getSize(h));
 
-        objPtr[-1].as<ObjHeader>().addFlag(ObjHeader::Flags::kIsMoved);
         objPtr[0].as<reg*>() = p;
+        h.addFlag(ObjHeader::Flags::kIsMoved);
+        word.store(std::bit_cast<u64>(h), std::memory_order_release);
 
-        return p;
+        return {p, true};
     }
 
-    std::vector<Page<>*> inuse, unused;
-    Page<>* current;
+    Nursery nursery{pages};
+    // Tlab registered on first refill, StoreBuffer registered on first flush, both are reset when minor GC begins
+    std::mutex mutatorLock;
+    std::vector<Tlab*> tlabs;
+    std::vector<StoreBuffer*> storeBuffers;
+    // used by allocHeap(TypeToken) and writeWithBarrier(reg**, reg*), and by minor GC to copy survivors
+    struct {
+        Tlab tlab;
+        StoreBuffer buffer;
+    } local;
+    Tlab gcTlab;
+    // parallel minor GC, workers are created on first use
+    usize gcWorkers = 1;
+    std::unique_ptr<GcThreads> gcThreads;
+    std::vector<std::unique_ptr<Scavenger>> scavengers;
+    std::vector<reg**> rootSlots;
+    std::atomic<usize> claimCursor = 0;
+    std::atomic<usize> idleScavengers = 0;
 
     /**
-     * @brief alloc storage and copy header to new object
+     * @brief take a new chunk for tl, called when tl is full
+     * 
+     * @return reg* begin of n reg at tl.top, nullptr if nursery is full
+     */
+    reg* refill(Tlab& tl, usize n) {
+        assert(n * sizeof(reg) <= Nursery::kTlabSize);
+        reg* chunk = nursery.grab();
+        if (chunk == nullptr) {
+            return nullptr;
+        }
+        if (tl.owner == nullptr) {
+            std::lock_guard lock{mutatorLock};
+            tl.owner = this;
+            tlabs.push_back(&tl);
+        }
+        tl.top = chunk;
+        tl.limit = chunk + Nursery::kTlabSize / sizeof(reg);
+        return chunk;
+    }
+
+    /**
+     * @brief alloc storage and copy header to new object, fast path is one bump and limit check
      * will not change state in header except for Flags::kIsMinorObject flag
      * 
-     * @param h header
-     * @return reg* 
+     * @param h header, size should less than Nursery::kTlabSize
+     * @return reg* nullptr if nursery is full
      */
-    reg* allocMinor(ObjHeader h) {
+    reg* allocMinor(Tlab& tl, ObjHeader h) {
+        assert(!h.isBigObject());
+        // one more for header, object has at least one member to hold forwarding pointer
+        usize n = 1 + std::max<usize>(h.sizeCompressed, 1);
+        reg* p = tl.top;
+        if (usize(tl.limit - p) < n) [[unlikely]] {
+            if ((p = refill(tl, n)) == nullptr) {
+                return nullptr;
+            }
+        }
+        tl.top = p + n;
         h.addFlag(ObjHeader::Flags::kIsMinorObject);
-        return nullptr;
+        p[0].as<ObjHeader>() = h;
+        std::memset(p + 1, 0, (n - 1) * sizeof(reg));
+        return p + 1;
     }
 
     /**
      * @brief alloc storage and copy header to new object
-     * will not change state in header except for Flags::kIsMinorObject flag
+     * will not change state in header except for Flags::kIsMinorObject flag,
+     * object is black during marking so it survives current major GC
      * 
+     * @param tl Tlab caching pages of size classes
      * @param h header
-     * @return reg* 
+     * @return reg* nullptr if PageSpace is exhausted
      */
-    reg* allocMajor(ObjHeader h) {
+    reg* allocMajor(Tlab& tl, ObjHeader h) {
         h.removeFlag(ObjHeader::Flags::kIsMinorObject);
-        return allocMinor(h);
+        if (h.isBigObject()) {
+            return allocHuge(h);
+        }
+        usize n = objectBytes(h);
+        if (n > kSizeClasses.back()) {
+            return allocHuge(h);
+        }
+        return allocSmall(tl, h, n);
+    }
+
+    /**
+     * @brief alloc object of size class c from page cached by tl, fast path pops free list without lock
+     * object is marked during marking. data of object is zeroed
+     * 
+     */
+    reg* allocSmall(Tlab& tl, ObjHeader h, usize n) {
+        u8 c = sizeClassOf(n);
+        auto& fc = tl.major[c];
+        void* p = fc.head;
+        if (p == nullptr) [[unlikely]] {
+            if ((p = refillSmall(tl, c)) == nullptr) {
+                return nullptr;
+            }
+        }
+        fc.head = *static_cast<void**>(p);
+        auto* obj = static_cast<reg*>(p);
+        obj[0].as<ObjHeader>() = h;
+        std::memset(obj + 1, 0, kSizeClasses[c] - sizeof(ObjHeader));
+        if (marking.load(std::memory_order_relaxed)) {
+            marks.mark(obj);
+            marks.setLive(obj, n);
+        }
+        return obj + 1;
+    }
+
+    /**
+     * @brief give tl another page of class c, which is swept first if not yet
+     * 
+     * @return void* first free object of the page, nullptr if PageSpace is exhausted
+     */
+    void* refillSmall(Tlab& tl, u8 c) {
+        if (tl.owner == nullptr) {
+            std::lock_guard lock{mutatorLock};
+            tl.owner = this;
+            tlabs.push_back(&tl);
+        }
+        std::lock_guard lock{majorLock};
+        auto& sc = classes[c];
+        auto& fc = tl.major[c];
+        if (fc.page != nullptr) {
+            sc.full.push_back(fc.page);
+        }
+        fc = {};
+        PageHeader* page = nullptr;
+        while (page == nullptr) {
+            if (!sc.available.empty()) {
+                page = sc.available.back();
+                sc.available.pop_back();
+            } else if (!sc.unswept.empty()) {
+                // lazy sweeping, page is put in one of the lists
+                PageHeader* now = sc.unswept.back();
+                sc.unswept.pop_back();
+                sweepPage(now);
+            } else {
+                u8* raw = takePage();
+                if (raw == nullptr) {
+                    return nullptr;
+                }
+                visitSizeClass(c, [&](auto n) { page = &Page<decltype(n)::value>::init(raw, c)->header(); });
+            }
+        }
+        assert(page->swept && page->freeList != nullptr);
+        fc.page = page;
+        fc.head = page->freeList;
+        page->freeList = nullptr;
+        return fc.head;
+    }
+
+    // empty page for a size class, majorLock should be held
+    u8* takePage() {
+        u8* p = nullptr;
+        if (!pool.pages.empty()) {
+            p = pool.pages.back();
+            pool.pages.pop_back();
+        } else if ((p = pages.allocPages(1, MemType::kMajor)) == nullptr) {
+            return nullptr;
+        }
+        majorBytes.fetch_add(PageSize, std::memory_order_relaxed);
+        return p;
+    }
+    // page of a size class has no live object, majorLock should be held
+    void givePage(u8* p) {
+        majorBytes.fetch_sub(PageSize, std::memory_order_relaxed);
+        if (pool.pages.size() < PagePool::kSize) {
+            pool.pages.push_back(p);
+        } else {
+            pages.freePages(p, 1);
+        }
+    }
+
+    /**
+     * @brief alloc object on its own span of pages, header is at begin of span
+     * 
+     * @return reg* nullptr if PageSpace is exhausted
+     */
+    reg* allocHuge(ObjHeader h) {
+        std::lock_guard lock{majorLock};
+        // dead objects give back pages before new ones are taken
+        sweepHuge(kLazySweepBudget);
+        usize n = hugePages(h);
+        auto* p = reinterpret_cast<reg*>(pages.allocPages(n, MemType::kHuge));
+        if (p == nullptr) {
+            return nullptr;
+        }
+        p[0].as<ObjHeader>() = h;
+        if (marking.load(std::memory_order_relaxed)) {
+            marks.mark(p);
+            marks.setLive(p, objectBytes(h));
+        }
+        hugeObjects.push_back(p + 1);
+        majorBytes.fetch_add(n * PageSize, std::memory_order_relaxed);
+        return p + 1;
+    }
+    // byte of object with header, at least one member to hold forwarding pointer, same as minor
+    usize objectBytes(ObjHeader h) {
+        return sizeof(ObjHeader) + std::max(getSize(h), sizeof(reg));
+    }
+    // header and data of object in static region
+    usize staticObjectBytes(ObjHeader h) {
+        return sizeof(ObjHeader) + (getSize(h) + sizeof(reg) - 1) / sizeof(reg) * sizeof(reg);
+    }
+    /**
+     * @brief shade major objects referenced by objects in static regions, remember slots pointing into pages
+     * being evacuated. gcLock should be held, all threads stopped
+     * 
+     */
+    void markStatic() {
+        for (auto [begin, end] : staticRegions) {
+            for (usize now = begin; now < end;) {
+                reg* objPtr = reinterpret_cast<reg*>(now) + 1;
+                callWithPointerMember(objPtr, [this](reg** tar) {
+                    shade(*tar);
+                    if (needsFixing(tar, *tar)) {
+                        evacRemembered.push_back(tar);
+                    }
+                });
+                now += staticObjectBytes(helper::getHeader(objPtr));
+            }
+        }
+    }
+    usize hugePages(ObjHeader h) {
+        return (sizeof(ObjHeader) + getSize(h) + PageSize - 1) / PageSize;
+    }
+    /**
+     * @brief give back span of huge object, slots in it are purged from store buffers in final mark
+     * 
+     */
+    void freeHuge(reg* objPtr) {
+        usize n = hugePages(helper::getHeader(objPtr));
+        pages.freePages(reinterpret_cast<u8*>(objPtr - 1), n);
+        majorBytes.fetch_sub(n * PageSize, std::memory_order_relaxed);
     }
 
     /**
@@ -409,23 +1710,37 @@ private:
         if (!h.hasFlag(ObjHeader::Flags::kHasPointerMember)) {
             return;
         }
-        if (h.hasFlag(ObjHeader::Flags::kHasNativeScanner)) {
-            // TODO:
-            tm->getType(h.typeId).pointerMemberScanner(this);
-        }
+        // TODO: native scanner of extern object (e.g. native hash map), kHasNativeScanner
         for (u8 i = 0; i < 8; ++i) {
             if (h.pointerMask & (1 << i)) {
                 func(reinterpret_cast<reg**>(objPtr + i));
             }
         }
-        if (h.sizeCompressed >= 8) {
-            tm->getType(h.typeId).layout();
+        if (h.sizeCompressed > 8) {
+            for (u32 i : tm->getType(TypeToken{h.typeId}).pointerMembers) {
+                func(reinterpret_cast<reg**>(objPtr + i));
+            }
         }
     };
 
+    // empty pages shared by all size classes, guarded by majorLock
     struct PagePool {
-
-    };
+        // pages kept, more are given back to system
+        static constexpr usize kSize = 256;
+        std::vector<u8*> pages;
+    } pool;
 };
 
+inline Tlab::~Tlab() {
+    if (owner != nullptr) {
+        owner->detach(*this);
+    }
+}
+
+inline StoreBuffer::~StoreBuffer() {
+    if (owner != nullptr) {
+        owner->detach(*this);
+    }
+}
+
 }
\ No newline at end of file
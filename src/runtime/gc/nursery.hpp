@@ -0,0 +1,115 @@
+/**
+ * @file nursery.hpp
+ * @author agent
+ * @brief young generation, two semispaces carved into thread local allocation buffers
+ * @date 2026-10-18
+ *
+ * @details
+ *
+ * nursery is a span of PageSpace split into two semispaces. mutators allocate in the active one: each ThreadVM owns
+ * a Tlab, which is a chunk grabbed from the active semispace by one atomic add, and objects are bumped in it
+ * without synchronization.
+ *
+ * minor GC flips the semispaces: the empty one becomes active, survivors are copied into it through the Tlab of
+ * GC, and mutators continue allocating behind them. the other one is garbage until next flip.
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Take memory from PageSpace.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Tlab caches pages of major heap.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <new>
+
+#include "defs.hpp"
+#include "runtime/gc/major_heap.hpp"
+#include "runtime/gc/page_space.hpp"
+
+namespace rulejit {
+
+struct Memory;
+
+/**
+ * @brief thread local allocation buffer, [top, limit) is free
+ * also caches a page of major heap per size class, for objects promoted or allocated in major heap by this thread
+ * registered to Memory on first refill, should not outlive it
+ *
+ */
+struct Tlab {
+    reg* top = nullptr;
+    reg* limit = nullptr;
+    std::array<FreeListCache, kSizeClasses.size()> major{};
+    Memory* owner = nullptr;
+
+    Tlab() = default;
+    Tlab(const Tlab&) = delete;
+    auto& operator=(const Tlab&) = delete;
+    ~Tlab();
+
+    void reset() { top = limit = nullptr; }
+};
+
+struct Nursery {
+    // size of both semispaces
+    static constexpr usize kDefaultSize = 32 << 20;
+    static constexpr usize kTlabSize = 32 << 10;
+
+    explicit Nursery(PageSpace& space, usize size = kDefaultSize)
+        : begin(space.allocPages(size / kTlabSize * kTlabSize / PageSize, MemType::kMinor)),
+          half(size / 2 / kTlabSize * kTlabSize) {
+        if (begin == nullptr) {
+            throw std::bad_alloc{};
+        }
+    }
+    Nursery(const Nursery&) = delete;
+    auto& operator=(const Nursery&) = delete;
+
+    bool contains(const void* p) const { return usize(p) - usize(begin) < half * 2; }
+    // in semispace mutators allocate in, which is the target of copy during minor GC
+    bool inActive(const void* p) const { return usize(p) - usize(space(active)) < half; }
+    // in semispace being evacuated during minor GC
+    bool inFromSpace(const void* p) const { return contains(p) && !inActive(p); }
+
+    /**
+     * @brief grab a chunk of kTlabSize byte from active semispace, lock free
+     *
+     * @return reg* nullptr if active semispace is exhausted
+     */
+    reg* grab() {
+        usize off = cursor.fetch_add(kTlabSize, std::memory_order_relaxed);
+        if (off + kTlabSize > half) {
+            return nullptr;
+        }
+        return reinterpret_cast<reg*>(space(active) + off);
+    }
+
+    // byte grabbed from active semispace
+    usize used() const { return std::min(cursor.load(std::memory_order_relaxed), half); }
+    usize capacity() const { return half; }
+
+    /**
+     * @brief make the other semispace active and empty, should called when no mutator allocates
+     *
+     */
+    void flip() {
+        active ^= 1;
+        cursor.store(0, std::memory_order_relaxed);
+    }
+
+  private:
+    u8* space(u8 i) const { return begin + i * half; }
+
+    u8* begin;
+    usize half;
+    u8 active = 0;
+    std::atomic<usize> cursor = 0;
+};
+
+}
@@ -0,0 +1,205 @@
+/**
+ * @file page_space.hpp
+ * @author agent
+ * @brief one aligned reservation for all managed heap, with flat side table of page kind
+ * @date 2026-10-18
+ *
+ * @details
+ *
+ * heap is reserved once (PROT_NONE) and committed region by region. info of page holding any address is found by
+ * one subtraction, one compare and one shift: PageInfo of each page is in a side table indexed by page number,
+ * which is mapped lazily, so only pages touched by heap cost memory.
+ *
+ * huge object occupies a span of pages, each page of span records index of the first page, so interior pointer
+ * finds its object through the same table.
+ *
+ * freed span is merged with free neighbours through the table as well: in free span, first page records index of
+ * the last page and others record index of the first page, so span ending just before and span beginning just
+ * after the freed one are found by one lookup each.
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Expose bounds of reservation for side bitmaps.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Flag pages being evacuated in PageInfo.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Merge adjacent free spans.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <new>
+
+#include <sys/mman.h>
+
+#include "defs.hpp"
+
+namespace rulejit {
+
+enum class MemType : u8 {
+    kUnmanaged,
+    kMinor,
+    kMajor,
+    kHuge,
+    kStatic,
+};
+
+struct PageInfo {
+    MemType type;
+    // page of major heap being evacuated by compaction, objects in it may be forwarded
+    bool evacuating;
+    u8 reserved[2];
+    // index of first page of the span this page belongs to, of last page for first page of free span
+    u32 start;
+};
+static_assert(sizeof(PageInfo) == sizeof(u64));
+
+struct PageSpace {
+    static constexpr usize kDefaultReserve = usize(64) << 30;
+    // granularity of commit, reservation is aligned to it
+    static constexpr usize kRegionSize = usize(1) << 20;
+
+    explicit PageSpace(usize reserve = kDefaultReserve) : size(reserve / kRegionSize * kRegionSize) {
+        // over reserve to align
+        void* p = mmap(nullptr, size + kRegionSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED) {
+            throw std::bad_alloc{};
+        }
+        mapped = static_cast<u8*>(p);
+        base = reinterpret_cast<u8*>((usize(p) + kRegionSize - 1) & ~(kRegionSize - 1));
+        void* t = mmap(nullptr, tableBytes(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                       -1, 0);
+        if (t == MAP_FAILED) {
+            munmap(mapped, size + kRegionSize);
+            throw std::bad_alloc{};
+        }
+        table = static_cast<PageInfo*>(t);
+    }
+    PageSpace(const PageSpace&) = delete;
+    auto& operator=(const PageSpace&) = delete;
+    ~PageSpace() {
+        munmap(table, tableBytes());
+        munmap(mapped, size + kRegionSize);
+    }
+
+    bool contains(const void* p) const { return usize(p) - usize(base) < size; }
+    u8* begin() const { return base; }
+    // byte reserved
+    usize capacity() const { return size; }
+
+    /**
+     * @brief info of page holding p, p should be contained
+     *
+     */
+    PageInfo& info(const void* p) { return table[(usize(p) - usize(base)) / PageSize]; }
+    const PageInfo& info(const void* p) const { return table[(usize(p) - usize(base)) / PageSize]; }
+
+    // kUnmanaged if not contained
+    MemType typeOf(const void* p) const { return contains(p) ? info(p).type : MemType::kUnmanaged; }
+
+    // first page of the span holding p, p should be contained
+    u8* spanOf(const void* p) const { return base + usize(info(p).start) * PageSize; }
+
+    /**
+     * @brief n contiguous pages of type, zeroed
+     *
+     * @return u8* nullptr if reservation is exhausted
+     */
+    u8* allocPages(usize n, MemType type) {
+        std::lock_guard lock{spanLock};
+        u8* p = nullptr;
+        // first fit in freed spans
+        if (auto it = freeSpans.lower_bound(n); it != freeSpans.end()) {
+            p = it->second;
+            usize left = it->first - n;
+            freeSpans.erase(it);
+            if (left != 0) {
+                markFree(p + n * PageSize, left);
+                freeSpans.emplace(left, p + n * PageSize);
+            }
+        } else {
+            if (n * PageSize > size - used) {
+                return nullptr;
+            }
+            p = base + used;
+            usize end = used + n * PageSize;
+            // commit whole regions
+            usize commitEnd = (end + kRegionSize - 1) / kRegionSize * kRegionSize;
+            if (commitEnd > committed) {
+                if (mprotect(base + committed, commitEnd - committed, PROT_READ | PROT_WRITE) != 0) {
+                    return nullptr;
+                }
+                committed = commitEnd;
+            }
+            used = end;
+        }
+        mark(p, n, type);
+        return p;
+    }
+
+    /**
+     * @brief give back n pages begin at p, memory is released to system
+     *
+     */
+    void freePages(u8* p, usize n) {
+        madvise(p, n * PageSize, MADV_DONTNEED);
+        std::lock_guard lock{spanLock};
+        usize first = usize(p - base) / PageSize, end = first + n;
+        // span ending at first, its last page records its first page
+        if (first != 0 && table[first - 1].type == MemType::kUnmanaged) {
+            usize prev = table[first - 1].start;
+            eraseFree(prev, first - prev);
+            first = prev;
+        }
+        // span beginning at end, its first page records its last page
+        if (end < used / PageSize && table[end].type == MemType::kUnmanaged) {
+            usize last = table[end].start;
+            eraseFree(end, last + 1 - end);
+            end = last + 1;
+        }
+        markFree(base + first * PageSize, end - first);
+        freeSpans.emplace(end - first, base + first * PageSize);
+    }
+
+    // byte of pages ever allocated
+    usize usedBytes() const { return used; }
+
+  private:
+    usize tableBytes() const { return size / PageSize * sizeof(PageInfo); }
+
+    void mark(u8* p, usize n, MemType type) {
+        u32 start = u32((p - base) / PageSize);
+        for (usize i = 0; i < n; ++i) {
+            table[start + i] = {type, false, {}, start};
+        }
+    }
+    void markFree(u8* p, usize n) {
+        mark(p, n, MemType::kUnmanaged);
+        table[(p - base) / PageSize].start += u32(n - 1);
+    }
+    // spanLock should be held
+    void eraseFree(usize first, usize n) {
+        auto [it, end] = freeSpans.equal_range(n);
+        for (; it != end; ++it) {
+            if (it->second == base + first * PageSize) {
+                freeSpans.erase(it);
+                return;
+            }
+        }
+    }
+
+    u8* mapped;
+    u8* base;
+    usize size;
+    PageInfo* table;
+
+    std::mutex spanLock;
+    usize used = 0;
+    usize committed = 0;
+    // page count -> first page
+    std::multimap<usize, u8*> freeSpans;
+};
+
+}
@@ -0,0 +1,128 @@
+/**
+ * @file safepoint.hpp
+ * @author agent
+ * @brief stop the world handshake between mutator threads
+ * @date 2026-10-19
+ *
+ * @details
+ *
+ * mutator thread attaches while it runs managed code. GC is requested by one thread (e.g. allocation found
+ * nursery full), every other attached thread polls the request at its next safepoint (call and back edge of
+ * interpreter) and parks there until GC finished. poll is one relaxed load when nothing is requested.
+ *
+ * thread requesting GC while another one is collecting parks as well, then retries what it failed to do.
+ * thread blocked outside managed code (e.g. in extern function) delays GC until it polls or detaches, so long
+ * blocking extern functions should return ExternStatus::kPending instead.
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Initial version.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+#include "defs.hpp"
+
+namespace rulejit {
+
+struct Safepoints {
+    Safepoints() = default;
+    Safepoints(const Safepoints&) = delete;
+    auto& operator=(const Safepoints&) = delete;
+
+    /**
+     * @brief current thread starts running managed code, waits if world is stopped
+     *
+     */
+    void attach() {
+        std::unique_lock lock{m};
+        waitUntil(lock, [this] { return !collecting; });
+        ++running;
+        attached = this;
+    }
+    void detach() {
+        std::lock_guard lock{m};
+        --running;
+        attached = nullptr;
+        notify();
+    }
+
+    bool requested() const { return request.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief called at safepoint if requested(), frames of current thread should be scannable
+     *
+     */
+    void park() {
+        std::unique_lock lock{m};
+        wait(lock);
+    }
+
+    /**
+     * @brief stop all attached threads other than current one
+     *
+     * @return bool false if another thread was collecting, current thread waited until it finished instead
+     */
+    bool stop() {
+        std::unique_lock lock{m};
+        if (collecting) {
+            wait(lock);
+            return false;
+        }
+        collecting = true;
+        request.store(true, std::memory_order_relaxed);
+        usize self = attached == this ? 1 : 0;
+        waitUntil(lock, [this, self] { return running == self; });
+        return true;
+    }
+    void resume() {
+        std::lock_guard lock{m};
+        collecting = false;
+        request.store(false, std::memory_order_relaxed);
+        notify();
+    }
+
+  private:
+    std::mutex m;
+    // changed with state under m, waiters sleep on it
+    std::atomic<u32> version = 0;
+    std::atomic<bool> request = false;
+    bool collecting = false;
+    // attached threads not parked
+    usize running = 0;
+
+    inline static thread_local const Safepoints* attached = nullptr;
+
+    void wait(std::unique_lock<std::mutex>& lock) {
+        bool counted = attached == this;
+        if (counted) {
+            --running;
+            notify();
+        }
+        waitUntil(lock, [this] { return !collecting; });
+        if (counted) {
+            ++running;
+        }
+    }
+
+    // m should be held
+    void notify() {
+        version.fetch_add(1, std::memory_order_relaxed);
+        version.notify_all();
+    }
+    template <typename P>
+    void waitUntil(std::unique_lock<std::mutex>& lock, P pred) {
+        while (!pred()) {
+            u32 seen = version.load(std::memory_order_relaxed);
+            lock.unlock();
+            version.wait(seen, std::memory_order_relaxed);
+            lock.lock();
+        }
+    }
+};
+
+}
@@ -0,0 +1,61 @@
+/**
+ * @file store_buffer.hpp
+ * @author agent
+ * @brief sequential store buffer, remembered set of slots out of nursery pointing into nursery, and SATB log
+ * @date 2026-10-18
+ *
+ * @details
+ *
+ * write barrier appends address of slot to StoreBuffer of current thread, which is one bump and limit check.
+ * full block is handed to Memory under lock and replaced by a cached one, so barrier never allocates in steady
+ * state. the same slot may be recorded many times, minor GC scans blocks linearly and duplicates are harmless.
+ *
+ * while major GC is marking, the barrier also appends the value being overwritten to the SATB (snapshot at the
+ * beginning) log of the same buffer, so everything reachable when marking began is marked. the log is flushed in
+ * the same way, and handed to marker.
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>SATB log of concurrent marking.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <memory>
+
+#include "defs.hpp"
+
+namespace rulejit {
+
+struct Memory;
+
+/**
+ * @brief per thread block of recorded slots, [block, top) is used
+ * registered to Memory on first flush, should not outlive it
+ *
+ */
+struct StoreBuffer {
+    // slots of one block
+    static constexpr usize kSize = 1024;
+    using Block = std::unique_ptr<reg**[]>;
+
+    reg*** top = nullptr;
+    reg*** limit = nullptr;
+    Block block;
+    // old values overwritten during marking, [satb, satbTop) is used
+    reg** satbTop = nullptr;
+    reg** satbLimit = nullptr;
+    std::unique_ptr<reg*[]> satb;
+    Memory* owner = nullptr;
+
+    StoreBuffer() = default;
+    StoreBuffer(const StoreBuffer&) = delete;
+    auto& operator=(const StoreBuffer&) = delete;
+    ~StoreBuffer();
+
+    void reset() { top = block.get(); }
+};
+
+}
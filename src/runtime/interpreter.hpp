@@ -0,0 +1,725 @@
+/**
+ * @file interpreter.hpp
+ * @author agent
+ * @brief bytecode interpreter
+ * @date 2026-10-18
+ *
+ * @details
+ *
+ * only verified Section can be executed (see backend/bytecode/verifier.hpp), so register index, CONST / STATIC
+ * offset, branch target and data-vs-pointer discipline are not checked when executing.
+ * the only checks left are at call boundary, where callee is known: callee is verified and signature matches.
+ *
+ * extern function is called directly from call boundary. if it returns pending future, evaluation is parked as
+ * Coroutine (see runtime/coroutine.hpp) and execute() returns ExecResult::kSuspended.
+ *
+ * tracepoints (see runtime/trace.hpp) are compiled into a separate instance of the dispatch loop, which is picked
+ * once per execute() / resume(), so the untraced loop has no check at all. switching Tracer during evaluation takes
+ * effect from the next one.
+ *
+ * fuel metering is selected the same way: metered loop charges one fuel at each call and back edge, where a
+ * runaway evaluation must pass, so the check is a single decrement-and-branch at these points only.
+ *
+ * calls and back edges are also where thread parks when another one stops the world for GC (see
+ * runtime/gc/safepoint.hpp), verifier records pointer maps there.
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Call extern function and park evaluation at pending call.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Execute vector opcodes.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Allocate frames and ALLOCsr / ALLOCsc on AUTO stack.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Unwind by exception table of each frame.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Poll sampling request at call and back edge.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Traced instance of dispatch loop.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Fuel metering at call and back edge.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>ALLOChr / ALLOChc bump in Tlab of ThreadVM.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Record pointer stores in StoreBuffer of ThreadVM.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>ALLOChr / ALLOChc collect at safepoint when nursery is full.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Execute TAGi / UNTAG / TAGOF.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Park at call and back edge when GC of another thread stops the world.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Load section with impls resolved.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Run STATIC initializer at first LOADst, typed boxes.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Record kinds of exception payload.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <expected>
+#include <memory>
+#include <optional>
+#include <span>
+#include <thread>
+
+#include "defs.hpp"
+#include "backend/bytecode/opcode.hpp"
+#include "backend/bytecode/verifier.hpp"
+#include "runtime/coroutine.hpp"
+#include "runtime/gc/mem.hpp"
+#include "runtime/profiler.hpp"
+#include "runtime/trace.hpp"
+#include "runtime/vm.hpp"
+
+namespace rulejit {
+
+enum class ExecResult {
+    kReturned,
+    // exception not caught by any exception table
+    kThrown,
+    // callee not verified or signature mismatch
+    kBadCall,
+    // parked at pending extern call, see Interpreter::resume()
+    kSuspended,
+    kDivideByZero,
+    // fuel of ThreadVM used up, see ThreadVM::Fuel
+    kOutOfFuel,
+    // heap is exhausted even after minor GC
+    kOutOfMemory,
+    // opcode rejected by Verifier, never for verified code
+    kUnsupported,
+};
+
+struct Interpreter {
+    using Section = CodeManager::Section;
+
+    VMContext* ctx;
+    Memory* mem;
+
+    /**
+     * @brief verify section and hand it to CodeManager
+     *
+     * @return pointer to loaded section or reason why verify failed
+     */
+    std::expected<const Section*, VerifyError> load(Section&& s) {
+        if (auto r = Verifier::verify(s); !r) {
+            return std::unexpected(r.error());
+        }
+        return ctx->cm->add(std::move(s));
+    }
+    /**
+     * @brief as load(), VTables of Section::implSlots are resolved by VMContext::vtm
+     *
+     * @param instantiate get function value of impl method from its template
+     */
+    template <typename Instantiate>
+    std::expected<const Section*, VerifyError> load(Section&& s, Instantiate&& instantiate) {
+        if (auto r = Verifier::verify(s); !r) {
+            return std::unexpected(r.error());
+        }
+        return ctx->cm->add(std::move(s), *ctx->vtm, *ctx->tm, std::forward<Instantiate>(instantiate));
+    }
+
+    /**
+     * @brief run function f on thread t, may re-entered (for example, from extern function)
+     *
+     * @param args size should be paramCnt of f
+     * @param rets size should be returnCnt of f
+     * @param parked if not nullptr, evaluation is allowed to suspend at pending extern call and parked here
+     * @return ExecResult
+     */
+    ExecResult execute(ThreadVM& t, const Section* f, std::span<const reg> args, std::span<reg> rets,
+                       std::unique_ptr<Coroutine>* parked = nullptr) {
+        if (!f->verified || f->native != nullptr || args.size() != f->info.paramCnt ||
+            rets.size() != f->info.returnCnt) {
+            return ExecResult::kBadCall;
+        }
+        usize entryDepth = t.frames.size();
+        usize base = stackTop(t);
+        if (parked != nullptr) {
+            t.a.beginSegment();
+        }
+        enterFrame(t, f, base);
+        std::copy(args.begin(), args.end(), t.r.begin() + base);
+
+        return finish(t, f, entryDepth, base, run(t, entryDepth, parked), rets);
+    }
+
+    /**
+     * @brief continue parked evaluation on thread t (may different from where it suspended) after its future
+     * completed
+     *
+     * @param rets size should be returnCnt of function called by execute()
+     * @param parked if not nullptr, evaluation is allowed to suspend again
+     * @return ExecResult
+     */
+    ExecResult resume(ThreadVM& t, std::unique_ptr<Coroutine> co, std::span<reg> rets,
+                      std::unique_ptr<Coroutine>* parked = nullptr) {
+        const Section* f = co->frames.front().section;
+        if (!co->future->ready() || co->future->rets.size() != co->retCnt || rets.size() != f->info.returnCnt) {
+            return ExecResult::kBadCall;
+        }
+        std::copy(co->future->rets.begin(), co->future->rets.end(), co->regs.begin() + co->retBase);
+
+        usize entryDepth = t.frames.size();
+        usize base = stackTop(t);
+        if (t.r.size() < base + co->regs.size()) {
+            t.r.resize(base + co->regs.size());
+        }
+        std::copy(co->regs.begin(), co->regs.end(), t.r.begin() + base);
+        co->frames.front().autoMark = t.a.mark();
+        t.a.attach(std::move(co->autoSegment));
+        for (auto frame : co->frames) {
+            frame.base += base;
+            t.frames.push_back(frame);
+        }
+
+        return finish(t, f, entryDepth, base, run(t, entryDepth, parked), rets);
+    }
+
+  private:
+    static usize stackTop(ThreadVM& t) {
+        if (t.frames.empty()) {
+            return 0;
+        }
+        return t.frames.back().base + t.frames.back().section->info.regUsageCnt;
+    }
+
+    static ExecResult finish(ThreadVM& t, const Section* f, usize entryDepth, usize base, ExecResult ret,
+                             std::span<reg> rets) {
+        if (ret == ExecResult::kReturned) {
+            auto begin = t.r.begin() + base + f->info.paramCnt;
+            std::copy(begin, begin + rets.size(), rets.begin());
+        }
+        if (ret == ExecResult::kSuspended) {
+            // AUTO stack is already detached into Coroutine
+            t.frames.resize(entryDepth);
+        } else {
+            popFrames(t, entryDepth);
+        }
+        return ret;
+    }
+
+    /**
+     * @brief run initializer of STATIC[slot] of sec once, others reading it wait. current frame should stop at
+     * safepoint, initializer runs nested on t
+     *
+     * @return ExecResult kReturned if STATIC[slot] is ready, kBadCall if it is read by its own initializer
+     */
+    ExecResult initStatic(ThreadVM& t, const Section* sec, u32 slot) {
+        auto it = std::find_if(sec->staticInits.begin(), sec->staticInits.end(),
+                               [slot](const Section::StaticInit& i) { return i.slot == slot; });
+        if (it == sec->staticInits.end()) {
+            return ExecResult::kBadCall;
+        }
+        auto& state = sec->staticState[slot];
+        usize self = usize(&t);
+        for (;;) {
+            usize now = state.load(std::memory_order_acquire);
+            if (now == Section::kStaticReady) {
+                return ExecResult::kReturned;
+            }
+            if (now == self) {
+                return ExecResult::kBadCall;
+            }
+            if (now == Section::kStaticPending &&
+                state.compare_exchange_strong(now, self, std::memory_order_acq_rel)) {
+                break;
+            }
+            // thread running initializer may stop the world for GC
+            if (mem->safepointRequested()) {
+                mem->parkAtSafepoint();
+            }
+            std::this_thread::yield();
+        }
+        // written once here, readers wait until ready. pointer slot is scanned by VM since ready
+        ExecResult r = execute(t, it->init, {}, {&sec->staticVar[slot], 1});
+        state.store(r == ExecResult::kReturned ? Section::kStaticReady : Section::kStaticPending,
+                    std::memory_order_release);
+        return r;
+    }
+
+    static void enterFrame(ThreadVM& t, const Section* f, usize base) {
+        if (t.r.size() < base + f->info.regUsageCnt) {
+            t.r.resize(base + f->info.regUsageCnt);
+        }
+        auto mark = t.a.mark();
+        reg* autoBase = t.a.push(f->info.autoStorageRequirement);
+        // scanned by GC before written
+        for (u32 slot : f->pointerMap.autoSlots) {
+            autoBase[slot].as<reg*>() = nullptr;
+        }
+        t.frames.push_back({f, 0, base, autoBase, mark});
+    }
+
+    // unwind frames above depth, with their AUTO storage
+    static void popFrames(ThreadVM& t, usize depth) {
+        if (t.frames.size() > depth) {
+            t.a.pop(t.frames[depth].autoMark);
+            t.frames.resize(depth);
+        }
+    }
+
+    /**
+     * @brief check callee at call boundary, args and returned values of callee are R[a+1, ...) of caller
+     *
+     */
+    static bool checkCall(const Section* caller, u32 a, const reg& fn, u8 paramCnt, u8 retCnt) {
+        auto* callee = std::bit_cast<const Section*>(fn);
+        if (callee == nullptr || !callee->verified || callee->info.paramCnt != paramCnt ||
+            callee->info.returnCnt != retCnt) {
+            return false;
+        }
+        usize cnt = usize(paramCnt) + retCnt;
+        if (cnt == 0) {
+            return true;
+        }
+        auto mask = RegisterPointerMap::Map{}.set() >> (256 - cnt);
+        return (((caller->info.pointerReg >> (a + 1)) ^ callee->info.pointerReg) & mask).none();
+    }
+
+    static const char* traceName(const Section* s) {
+        return s->name.empty() ? "<anonymous>" : s->name.c_str();
+    }
+
+    ExecResult run(ThreadVM& t, usize entryDepth, std::unique_ptr<Coroutine>* parked) {
+        if (!t.fuel.enabled) [[likely]] {
+            return run<false>(t, entryDepth, parked);
+        }
+        u64 before = t.fuel.left;
+        t.fuel.exhaustedIn = nullptr;
+        ExecResult ret = run<true>(t, entryDepth, parked);
+        // nested evaluation is counted in outer one, which finishes later
+        t.fuel.used = before - t.fuel.left;
+        return ret;
+    }
+
+    template <bool kMetered>
+    ExecResult run(ThreadVM& t, usize entryDepth, std::unique_ptr<Coroutine>* parked) {
+#ifndef RULEJIT_NO_TRACE
+        if (Tracer::enabled()) [[unlikely]] {
+            for (usize i = entryDepth; i < t.frames.size(); ++i) {
+                Tracer::emit(TracePoint::kFunctionEnter, traceName(t.frames[i].section));
+            }
+            ExecResult ret = interpret<true, kMetered>(t, entryDepth, parked);
+            // frames returned or unwound are closed by leave(), close the rest left by error or suspension
+            if (ret == ExecResult::kSuspended) {
+                Tracer::emit(TracePoint::kSuspend, "suspend");
+            }
+            for (usize i = t.frames.size(); i-- > entryDepth;) {
+                Tracer::emit(TracePoint::kFunctionExit, traceName(t.frames[i].section));
+            }
+            return ret;
+        }
+#endif
+        return interpret<false, kMetered>(t, entryDepth, parked);
+    }
+
+    template <bool kTraced, bool kMetered>
+    ExecResult interpret(ThreadVM& t, usize entryDepth, std::unique_ptr<Coroutine>* parked) {
+        const Section* sec = t.frames.back().section;
+        const Instruction* code = sec->code.data();
+        u32 ip = t.frames.back().ip;
+        usize base = t.frames.back().base;
+        reg* R = t.r.data() + base;
+        reg* AUTO = t.frames.back().autoBase;
+
+        // move frames since entryDepth out of t, pending returned values of callee goes to r[retAt, retAt + retCnt)
+        auto park = [&](std::shared_ptr<ExternFuture> future, const Section* callee, usize retAt, u8 retCnt) {
+            auto co = std::make_unique<Coroutine>();
+            usize entryBase = t.frames[entryDepth].base;
+            co->regs.assign(t.r.begin() + entryBase, t.r.begin() + base + sec->info.regUsageCnt);
+            for (usize i = entryDepth; i < t.frames.size(); ++i) {
+                auto frame = t.frames[i];
+                frame.base -= entryBase;
+                co->frames.push_back(frame);
+            }
+            co->autoSegment = t.a.detach(t.frames[entryDepth].autoBase);
+            co->future = std::move(future);
+            co->retBase = retAt - entryBase;
+            co->retCnt = retCnt;
+            co->retPointer = callee->info.pointerReg >> callee->info.paramCnt;
+            *parked = std::move(co);
+        };
+        // stop for GC of another thread, take sample if profiler asked and charge fuel, ip is next instruction.
+        // return false if out of fuel
+        auto poll = [&]() {
+            if (mem->safepointRequested()) [[unlikely]] {
+                // frames are scanned by pointer maps at safepoint, R may be updated
+                t.frames.back().ip = ip;
+                mem->parkAtSafepoint();
+            }
+            if (t.sampleRequested.load(std::memory_order_relaxed)) [[unlikely]] {
+                t.sampleRequested.store(false, std::memory_order_relaxed);
+                recordSample(t, sec, ip - 1);
+            }
+            if constexpr (kMetered) {
+                if (t.fuel.left-- == 0) [[unlikely]] {
+                    t.fuel.left = 0;
+                    t.fuel.exhaustedIn = sec;
+                    t.fuel.exhaustedAt = ip - 1;
+                    return false;
+                }
+            }
+            return true;
+        };
+        // call function value fn, callee frame begin at R[a+1]. return nullopt if execution should continue
+        auto call = [&](u32 a, reg fn, u8 paramCnt, u8 retCnt) -> std::optional<ExecResult> {
+            if (!checkCall(sec, a, fn, paramCnt, retCnt)) {
+                return ExecResult::kBadCall;
+            }
+            t.frames.back().ip = ip;
+            if (!poll()) {
+                return ExecResult::kOutOfFuel;
+            }
+            auto* callee = std::bit_cast<const Section*>(fn);
+            if (callee->native != nullptr) {
+                // extern function may re-enter interpreter on this thread and reallocate register stack
+                reg retBuf[256];
+                ExternCall ec{{R + a + 1, paramCnt}, {retBuf, retCnt}, callee->nativeData, nullptr};
+                if constexpr (kTraced) {
+                    Tracer::emit(TracePoint::kExternBegin, traceName(callee));
+                }
+                ExternStatus status = callee->native(ec);
+                if constexpr (kTraced) {
+                    Tracer::emit(TracePoint::kExternEnd, traceName(callee));
+                }
+                R = t.r.data() + base;
+                if (status == ExternStatus::kDone) {
+                    std::copy_n(retBuf, retCnt, R + a + 1 + paramCnt);
+                    return std::nullopt;
+                }
+                if (parked == nullptr || ec.future == nullptr) {
+                    return ExecResult::kBadCall;
+                }
+                park(std::move(ec.future), callee, base + a + 1 + paramCnt, retCnt);
+                return ExecResult::kSuspended;
+            }
+            sec = callee;
+            base += a + 1;
+            enterFrame(t, sec, base);
+            if constexpr (kTraced) {
+                Tracer::emit(TracePoint::kFunctionEnter, traceName(sec));
+            }
+            code = sec->code.data();
+            ip = 0;
+            R = t.r.data() + base;
+            AUTO = t.frames.back().autoBase;
+            return std::nullopt;
+        };
+        // pop current frame, return false if returned to caller of execute()
+        auto leave = [&]() {
+            if constexpr (kTraced) {
+                Tracer::emit(TracePoint::kFunctionExit, traceName(sec));
+            }
+            t.a.pop(t.frames.back().autoMark);
+            t.frames.pop_back();
+            if (t.frames.size() == entryDepth) {
+                return false;
+            }
+            auto& now = t.frames.back();
+            sec = now.section;
+            code = sec->code.data();
+            ip = now.ip;
+            base = now.base;
+            R = t.r.data() + base;
+            AUTO = now.autoBase;
+            return true;
+        };
+        // jump to handler of t.exception, from throwing instruction of current frame, then call instruction of each
+        // caller. return false if not caught
+        auto unwind = [&]() {
+            u64 type = t.exception.type.as<u64>();
+            const ExceptionRange* h;
+            while ((h = sec->findHandler(ip - 1, type)) == nullptr) {
+                if (!leave()) {
+                    return false;
+                }
+            }
+            ip = h->handler;
+            return true;
+        };
+
+#define RULEJIT_BINOP(OP, T, EXPR)                                                                                    \
+    case OPCode::OP: {                                                                                                \
+        T lhs = R[ins.b()].as<T>(), rhs = R[ins.c()].as<T>();                                                        \
+        R[ins.a()].as<T>() = static_cast<T>(EXPR);                                                                   \
+        break;                                                                                                       \
+    }
+#define RULEJIT_VECOP(OP, EXPR)                                                                                       \
+    case OPCode::OP: {                                                                                                \
+        f64 lhs[kVectorLanes], rhs[kVectorLanes], res[kVectorLanes];                                                  \
+        std::memcpy(lhs, R + ins.b(), sizeof(lhs));                                                                   \
+        std::memcpy(rhs, R + ins.c(), sizeof(rhs));                                                                   \
+        for (u32 i = 0; i < kVectorLanes; ++i) {                                                                      \
+            res[i] = EXPR;                                                                                            \
+        }                                                                                                             \
+        std::memcpy(R + ins.a(), res, sizeof(res));                                                                   \
+        break;                                                                                                        \
+    }
+#define RULEJIT_CMPOP(OP, T, EXPR)                                                                                    \
+    case OPCode::OP: {                                                                                                \
+        T lhs = R[ins.b()].as<T>(), rhs = R[ins.c()].as<T>();                                                        \
+        R[ins.a()].as<u64>() = (EXPR) ? 1 : 0;                                                                       \
+        break;                                                                                                       \
+    }
+
+        for (;;) {
+            Instruction ins = code[ip++];
+            switch (ins.op()) {
+            case OPCode::NOP:
+                break;
+            RULEJIT_BINOP(ADDu, u64, lhs + rhs)
+            RULEJIT_BINOP(ADDf, f64, lhs + rhs)
+            RULEJIT_BINOP(SUBu, u64, lhs - rhs)
+            RULEJIT_BINOP(SUBf, f64, lhs - rhs)
+            RULEJIT_BINOP(MULi, i64, u64(lhs) * u64(rhs))
+            RULEJIT_BINOP(MULf, f64, lhs * rhs)
+            RULEJIT_BINOP(DIVf, f64, lhs / rhs)
+            RULEJIT_BINOP(MULu, u64, lhs * rhs)
+            RULEJIT_BINOP(SHLu, u64, lhs << (rhs & 63))
+            RULEJIT_BINOP(SHRu, u64, lhs >> (rhs & 63))
+            RULEJIT_BINOP(AND, u64, lhs & rhs)
+            RULEJIT_BINOP(OR, u64, lhs | rhs)
+            RULEJIT_BINOP(XOR, u64, lhs ^ rhs)
+            RULEJIT_CMPOP(GEu, u64, lhs >= rhs)
+            RULEJIT_CMPOP(GEi, i64, lhs >= rhs)
+            RULEJIT_CMPOP(LEu, u64, lhs <= rhs)
+            RULEJIT_CMPOP(LEi, i64, lhs <= rhs)
+            RULEJIT_CMPOP(Gu, u64, lhs > rhs)
+            RULEJIT_CMPOP(Gi, i64, lhs > rhs)
+            RULEJIT_CMPOP(Lu, u64, lhs < rhs)
+            RULEJIT_CMPOP(Li, i64, lhs < rhs)
+            RULEJIT_CMPOP(EQ, u64, lhs == rhs)
+            RULEJIT_CMPOP(GEf, f64, lhs >= rhs)
+            RULEJIT_CMPOP(LEf, f64, lhs <= rhs)
+            RULEJIT_CMPOP(Gf, f64, lhs > rhs)
+            RULEJIT_CMPOP(Lf, f64, lhs < rhs)
+            RULEJIT_VECOP(VADDf, lhs[i] + rhs[i])
+            RULEJIT_VECOP(VSUBf, lhs[i] - rhs[i])
+            RULEJIT_VECOP(VMULf, lhs[i] * rhs[i])
+            RULEJIT_VECOP(VDIVf, lhs[i] / rhs[i])
+            // mask lane is u64 1 / 0, stored through f64 lane by bit pattern
+            RULEJIT_VECOP(VGEf, std::bit_cast<f64>(u64(lhs[i] >= rhs[i])))
+            RULEJIT_VECOP(VLEf, std::bit_cast<f64>(u64(lhs[i] <= rhs[i])))
+            RULEJIT_VECOP(VGf, std::bit_cast<f64>(u64(lhs[i] > rhs[i])))
+            RULEJIT_VECOP(VLf, std::bit_cast<f64>(u64(lhs[i] < rhs[i])))
+            case OPCode::VFMAf: {
+                f64 acc[kVectorLanes], lhs[kVectorLanes], rhs[kVectorLanes];
+                std::memcpy(acc, R + ins.a(), sizeof(acc));
+                std::memcpy(lhs, R + ins.b(), sizeof(lhs));
+                std::memcpy(rhs, R + ins.c(), sizeof(rhs));
+                for (u32 i = 0; i < kVectorLanes; ++i) {
+                    acc[i] += lhs[i] * rhs[i];
+                }
+                std::memcpy(R + ins.a(), acc, sizeof(acc));
+                break;
+            }
+            case OPCode::VSEL:
+                for (u32 i = 0; i < kVectorLanes; ++i) {
+                    R[ins.a() + i] = R[ins.c() + i].as<u64>() ? R[ins.b() + i] : R[ins.a() + i];
+                }
+                break;
+            case OPCode::VLOADao:
+                std::memcpy(R + ins.a(), R[ins.b()].as<reg*>() + ins.c(), kVectorLanes * sizeof(reg));
+                break;
+            case OPCode::VSTOREao:
+                std::memcpy(R[ins.a()].as<reg*>() + ins.c(), R + ins.b(), kVectorLanes * sizeof(reg));
+                break;
+            case OPCode::VSPLAT: {
+                reg v = R[ins.b()];
+                for (u32 i = 0; i < kVectorLanes; ++i) {
+                    R[ins.a() + i] = v;
+                }
+                break;
+            }
+            case OPCode::VHADDf: {
+                f64 v[kVectorLanes];
+                std::memcpy(v, R + ins.b(), sizeof(v));
+                R[ins.a()].as<f64>() = (v[0] + v[1]) + (v[2] + v[3]);
+                break;
+            }
+            case OPCode::DIVi: case OPCode::DIVu: case OPCode::MODu: {
+                u64 rhs = R[ins.c()].as<u64>();
+                if (rhs == 0) [[unlikely]] {
+                    return ExecResult::kDivideByZero;
+                }
+                if (ins.op() == OPCode::DIVi) {
+                    i64 lhs = R[ins.b()].as<i64>();
+                    // INT64_MIN / -1 overflows, wrap like other integer op
+                    R[ins.a()].as<i64>() = std::bit_cast<i64>(rhs) == -1 ? i64(0 - u64(lhs)) : lhs / i64(rhs);
+                } else if (ins.op() == OPCode::DIVu) {
+                    R[ins.a()].as<u64>() = R[ins.b()].as<u64>() / rhs;
+                } else {
+                    R[ins.a()].as<u64>() = R[ins.b()].as<u64>() % rhs;
+                }
+                break;
+            }
+            case OPCode::LOADrr: case OPCode::LOADrrp:
+                R[ins.a()] = R[ins.b()].as<reg*>()[R[ins.c()].as<u64>()];
+                break;
+            case OPCode::STORErr:
+                R[ins.a()].as<reg*>()[R[ins.c()].as<u64>()] = R[ins.b()];
+                break;
+            case OPCode::STORErrp:
+                mem->writeWithBarrier(t.storeBuffer, &R[ins.a()].as<reg*>()[R[ins.c()].as<u64>()].as<reg*>(),
+                                      R[ins.b()].as<reg*>());
+                break;
+            case OPCode::CMOV:
+                if (R[ins.c()].as<u64>()) {
+                    R[ins.a()] = R[ins.b()];
+                }
+                break;
+            case OPCode::LOADi: case OPCode::LOADip:
+                R[ins.a()] = R[ins.b()].as<reg*>()[ins.cImm()];
+                break;
+            case OPCode::STOREi:
+                R[ins.a()].as<reg*>()[ins.cImm()] = R[ins.b()];
+                break;
+            case OPCode::STOREip:
+                mem->writeWithBarrier(t.storeBuffer, &R[ins.a()].as<reg*>()[ins.cImm()].as<reg*>(),
+                                      R[ins.b()].as<reg*>());
+                break;
+            case OPCode::LOADao: case OPCode::LOADaop:
+                R[ins.a()] = R[ins.b()].as<reg*>()[ins.c()];
+                break;
+            case OPCode::STOREao:
+                R[ins.a()].as<reg*>()[ins.c()] = R[ins.b()];
+                break;
+            case OPCode::STOREaop:
+                mem->writeWithBarrier(t.storeBuffer, &R[ins.a()].as<reg*>()[ins.c()].as<reg*>(), R[ins.b()].as<reg*>());
+                break;
+            case OPCode::THROW: {
+                t.exception.type = R[ins.a()];
+                t.exception.payload.assign(R + ins.b(), R + ins.b() + ins.c() + 1);
+                t.exception.pointerMask = sec->info.pointerReg >> ins.b();
+                if (!unwind()) {
+                    return ExecResult::kThrown;
+                }
+                break;
+            }
+            case OPCode::ALLOCsr:
+                AUTO[ins.c()] = R[ins.b()];
+                R[ins.a()].as<reg*>() = AUTO + ins.c();
+                break;
+            case OPCode::ALLOCsc:
+                AUTO[ins.c()] = sec->constant[ins.b()];
+                R[ins.a()].as<reg*>() = AUTO + ins.c();
+                break;
+            case OPCode::LOADst: case OPCode::LOADstp:
+                if (sec->staticState != nullptr &&
+                    sec->staticState[ins.b()].load(std::memory_order_acquire) != Section::kStaticReady) [[unlikely]] {
+                    // safepoint, frames are scanned by pointer maps while initializer runs
+                    t.frames.back().ip = ip;
+                    ExecResult r = initStatic(t, sec, ins.b());
+                    R = t.r.data() + base;
+                    if (r == ExecResult::kThrown) {
+                        if (!unwind()) {
+                            return r;
+                        }
+                        break;
+                    }
+                    if (r != ExecResult::kReturned) {
+                        return r;
+                    }
+                }
+                R[ins.a()] = sec->staticVar[ins.b()];
+                break;
+            case OPCode::CALLc: case OPCode::CALLf:
+                if (auto r = call(ins.a(), R[ins.a()], ins.b(), ins.c())) {
+                    return *r;
+                }
+                break;
+            case OPCode::NOT:
+                R[ins.a()].as<u64>() = R[ins.b()].as<u64>() ? 0 : 1;
+                break;
+            case OPCode::DTRANSuf:
+                R[ins.a()].as<f64>() = static_cast<f64>(R[ins.b()].as<u64>());
+                break;
+            case OPCode::DTRANSfu:
+                R[ins.a()].as<u64>() = static_cast<u64>(R[ins.b()].as<f64>());
+                break;
+            case OPCode::DTRANSif:
+                R[ins.a()].as<f64>() = static_cast<f64>(R[ins.b()].as<i64>());
+                break;
+            case OPCode::DTRANSfi:
+                R[ins.a()].as<i64>() = static_cast<i64>(R[ins.b()].as<f64>());
+                break;
+            case OPCode::TAGi:
+                R[ins.a()].as<reg*>() = helper::getHackedPtr(R[ins.b()].as<u64>(), helper::PtrTag::kInt);
+                break;
+            case OPCode::UNTAG:
+                R[ins.a()].as<u64>() = helper::getHackedPayload(R[ins.b()].as<reg*>());
+                break;
+            case OPCode::TAGOF:
+                R[ins.a()].as<u64>() = u64(helper::getTag(R[ins.b()].as<reg*>()));
+                break;
+            case OPCode::MOV:
+                R[ins.a()] = R[ins.b()];
+                break;
+            case OPCode::CALLv: {
+                auto& site = sec->traitCallSites[ins.bcOffset()];
+                if (site.cacheId >= t.inlineCaches.size()) [[unlikely]] {
+                    t.inlineCaches.resize(site.cacheId + 1);
+                }
+                reg fn = t.inlineCaches[site.cacheId].lookup(std::bit_cast<const VTable*>(R[ins.a()]), site.slot);
+                if (auto r = call(ins.a(), fn, site.argCnt + 1, site.retCnt)) {
+                    return *r;
+                }
+                break;
+            }
+            case OPCode::RET: {
+                // returned values may overlap with destination
+                std::memmove(R + sec->info.paramCnt, R + ins.a(), ins.bcOffset() * sizeof(reg));
+                if (!leave()) {
+                    return ExecResult::kReturned;
+                }
+                break;
+            }
+            case OPCode::LOADc: case OPCode::LOADcp:
+                R[ins.a()] = sec->constant[ins.bcOffset()];
+                break;
+            case OPCode::ALLOChr: case OPCode::ALLOChc: {
+                // box of base type, as its shape made by TypeManager
+                bool isPointer = ins.op() == OPCode::ALLOChr && sec->info.pointerReg[ins.b()];
+                ObjHeader h{isPointer ? TypeManager::kAny : TypeManager::kU64, 1, 0,
+                            u8(isPointer ? ObjHeader::Flags::kHasPointerMember : ObjHeader::Flags{}), u8(isPointer)};
+                reg* p = mem->allocHeap(t.tlab, h);
+                if (p == nullptr) [[unlikely]] {
+                    // safepoint, frames are scanned by pointer maps (see forEachRoot()) and R[b] may be updated
+                    t.frames.back().ip = ip;
+                    if ((p = mem->allocHeapOrCollect(t.tlab, h)) == nullptr) {
+                        return ExecResult::kOutOfMemory;
+                    }
+                }
+                p[0] = ins.op() == OPCode::ALLOChr ? R[ins.b()] : sec->constant[ins.bcOffset()];
+                R[ins.a()].as<reg*>() = p;
+                break;
+            }
+            case OPCode::BEZ:
+                if (R[ins.a()].as<u64>() == 0) {
+                    if (ins.bcImm() < 0 && !poll()) {
+                        return ExecResult::kOutOfFuel;
+                    }
+                    ip += ins.bcImm();
+                }
+                break;
+            case OPCode::BNZ:
+                if (R[ins.a()].as<u64>() != 0) {
+                    if (ins.bcImm() < 0 && !poll()) {
+                        return ExecResult::kOutOfFuel;
+                    }
+                    ip += ins.bcImm();
+                }
+                break;
+            case OPCode::BR:
+                if (ins.abcImm() < 0 && !poll()) {
+                    return ExecResult::kOutOfFuel;
+                }
+                ip += ins.abcImm();
+                break;
+            default:
+                // INSTAN*, rejected by Verifier
+                return ExecResult::kUnsupported;
+            }
+        }
+#undef RULEJIT_BINOP
+#undef RULEJIT_CMPOP
+#undef RULEJIT_VECOP
+    }
+};
+
+}
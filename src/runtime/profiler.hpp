@@ -0,0 +1,365 @@
+/**
+ * @file profiler.hpp
+ * @author agent
+ * @brief sampling profiler of VM code
+ * @date 2026-10-18
+ *
+ * @details
+ *
+ * timer thread of Profiler sets ThreadVM::sampleRequested every interval, interpreter polls it at call and back
+ * edge of branch and records (Section, IP) of every frame. when profiler is stopped, the only cost is one relaxed
+ * load at these points.
+ * NOTE: since sample is taken at these points only, leaf IP is always a call or a back edge, so no per opcode
+ * count is reported, and line of leaf frame is the line of the enclosing loop or call.
+ *
+ * samples are recorded into fixed ring of each thread, preallocated when attached, oldest samples are overwritten
+ * when it is full and counted as dropped, stacks deeper than SampleBuffer::kMaxDepth keep leaf frames only.
+ * samples are aggregated per function and per source line (Section::lines) of the leaf frame, and exported as
+ * collapsed stack (for flamegraph.pl / speedscope) or pprof profile.proto (uncompressed, accepted by
+ * `go tool pprof`).
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Fixed ring of samples, drop per opcode count.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "defs.hpp"
+#include "runtime/vm.hpp"
+
+namespace rulejit {
+
+struct ProfileFrame {
+    const CodeManager::Section* section;
+    // index of executing instruction
+    u32 ip;
+
+    auto operator<=>(const ProfileFrame&) const = default;
+};
+
+/**
+ * @brief samples of one ThreadVM in fixed ring, appended by its owner thread, read by Profiler
+ *
+ */
+struct SampleBuffer {
+    // capacity, power of 2
+    static constexpr usize kFrames = 1 << 16;
+    static constexpr usize kSamples = 1 << 12;
+    // frames recorded per sample, leaf first
+    static constexpr usize kMaxDepth = 256;
+    static_assert(kMaxDepth <= kFrames);
+
+    std::mutex m;
+    // stacks are flattened, leaf first. positions are counted from start and wrap around in ring
+    std::unique_ptr<ProfileFrame[]> frames = std::make_unique<ProfileFrame[]>(kFrames);
+    // begin of each stack, stack i ends at begin of i + 1 or at frameEnd
+    std::unique_ptr<usize[]> begins = std::make_unique<usize[]>(kSamples);
+    usize frameEnd = 0;
+    usize sampleBegin = 0;
+    usize sampleEnd = 0;
+    // samples overwritten when ring is full
+    u64 dropped = 0;
+    // samples with callers cut at kMaxDepth
+    u64 truncated = 0;
+
+    usize size() const { return sampleEnd - sampleBegin; }
+    usize beginOf(usize i) const { return begins[i % kSamples]; }
+    usize endOf(usize i) const { return i + 1 == sampleEnd ? frameEnd : beginOf(i + 1); }
+    const ProfileFrame& frameAt(usize pos) const { return frames[pos % kFrames]; }
+
+    void clear() {
+        sampleBegin = sampleEnd;
+        dropped = 0;
+        truncated = 0;
+    }
+
+    // append stack of depth frames, fill(ProfileFrame* out, usize i) writes the i-th frame from leaf
+    template <typename F>
+    void push(usize depth, F&& fill) {
+        if (depth > kMaxDepth) {
+            depth = kMaxDepth;
+            ++truncated;
+        }
+        // oldest ones are overwritten
+        while (size() == kSamples || (size() != 0 && frameEnd + depth - beginOf(sampleBegin) > kFrames)) {
+            ++sampleBegin;
+            ++dropped;
+        }
+        begins[sampleEnd++ % kSamples] = frameEnd;
+        for (usize i = 0; i < depth; ++i) {
+            fill(&frames[frameEnd++ % kFrames], i);
+        }
+    }
+};
+
+/**
+ * @brief record stack of t, current frame is executing sec at ip. called by interpreter
+ *
+ */
+inline void recordSample(ThreadVM& t, const CodeManager::Section* sec, u32 ip) {
+    SampleBuffer* buf = t.samples;
+    if (buf == nullptr) {
+        return;
+    }
+    std::lock_guard lock{buf->m};
+    usize top = t.frames.size() - 1;
+    buf->push(t.frames.size(), [&](ProfileFrame* out, usize i) {
+        // callers, saved IP is next to call instruction
+        *out = i == 0 ? ProfileFrame{sec, ip} : ProfileFrame{t.frames[top - i].section, t.frames[top - i].ip - 1};
+    });
+}
+
+struct Profiler {
+    using Section = CodeManager::Section;
+
+    struct Report {
+        struct Count {
+            u64 self = 0;
+            // samples with function on stack, recursion counted once
+            u64 total = 0;
+        };
+        u64 samples = 0;
+        // overwritten in full ring of thread, not counted in samples
+        u64 dropped = 0;
+        // samples with root frames cut at SampleBuffer::kMaxDepth
+        u64 truncated = 0;
+        std::unordered_map<const Section*, Count> functions;
+        // (section, source line) of leaf frame, line is IP if no line table
+        std::map<std::pair<const Section*, u32>, u64> lines;
+        // root first
+        std::map<std::vector<ProfileFrame>, u64> stacks;
+    };
+
+    explicit Profiler(std::chrono::microseconds interval = std::chrono::milliseconds(1)) : interval(interval) {}
+    Profiler(const Profiler&) = delete;
+    auto& operator=(const Profiler&) = delete;
+    ~Profiler() {
+        stop();
+        for (auto& [t, buf] : threads) {
+            t->samples = nullptr;
+        }
+    }
+
+    /**
+     * @brief profile t, should called when t is not executing
+     *
+     */
+    void attach(ThreadVM& t) {
+        std::lock_guard lock{threadsMutex};
+        auto& [_, buf] = threads.emplace_back(&t, std::make_unique<SampleBuffer>());
+        t.samples = buf.get();
+    }
+    void attach(VM& vm) {
+        for (auto& t : vm.threads) {
+            attach(t);
+        }
+    }
+
+    /**
+     * @brief start sampling, can be switched at runtime
+     *
+     */
+    void start() {
+        if (timer.joinable()) {
+            return;
+        }
+        stopping = false;
+        timer = std::thread([this]() {
+            std::unique_lock lock{threadsMutex};
+            while (!stopCv.wait_for(lock, interval, [this]() { return stopping; })) {
+                for (auto& [t, _] : threads) {
+                    t->sampleRequested.store(true, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+
+    void stop() {
+        if (!timer.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard lock{threadsMutex};
+            stopping = true;
+        }
+        stopCv.notify_all();
+        timer.join();
+    }
+
+    bool running() const { return timer.joinable(); }
+
+    /**
+     * @brief drop samples recorded
+     *
+     */
+    void clear() {
+        std::lock_guard lock{threadsMutex};
+        for (auto& [_, buf] : threads) {
+            std::lock_guard bufLock{buf->m};
+            buf->clear();
+        }
+    }
+
+    Report report() {
+        Report r;
+        std::lock_guard lock{threadsMutex};
+        for (auto& [_, buf] : threads) {
+            std::lock_guard bufLock{buf->m};
+            r.dropped += buf->dropped;
+            r.truncated += buf->truncated;
+            for (usize k = buf->sampleBegin; k != buf->sampleEnd; ++k) {
+                usize begin = buf->beginOf(k), end = buf->endOf(k);
+                const ProfileFrame& leaf = buf->frameAt(begin);
+                ++r.samples;
+                r.functions[leaf.section].self++;
+                r.lines[{leaf.section, lineOf(leaf)}]++;
+                std::vector<ProfileFrame> stack;
+                stack.reserve(end - begin);
+                for (usize pos = end; pos-- > begin;) {
+                    stack.push_back(buf->frameAt(pos));
+                }
+                for (usize i = 0; i < stack.size(); ++i) {
+                    bool seen = false;
+                    for (usize j = 0; j < i && !seen; ++j) {
+                        seen = stack[j].section == stack[i].section;
+                    }
+                    if (!seen) {
+                        r.functions[stack[i].section].total++;
+                    }
+                }
+                r.stacks[std::move(stack)]++;
+            }
+        }
+        return r;
+    }
+
+    /**
+     * @brief one line per stack: "root;caller;leaf count"
+     *
+     */
+    static std::string collapsed(const Report& r) {
+        std::string out;
+        for (auto& [stack, cnt] : r.stacks) {
+            for (usize i = 0; i < stack.size(); ++i) {
+                if (i != 0) {
+                    out += ';';
+                }
+                out += nameOf(stack[i].section);
+            }
+            out += ' ';
+            out += std::to_string(cnt);
+            out += '\n';
+        }
+        return out;
+    }
+
+    /**
+     * @brief serialized perftools.profiles.Profile, one location per (section, IP)
+     *
+     */
+    std::string pprof(const Report& r) const {
+        ProtoWriter profile;
+        std::vector<std::string> strings{"", "samples", "count", "cpu", "nanoseconds"};
+        std::unordered_map<const Section*, u64> functionIds;
+        std::map<ProfileFrame, u64> locationIds;
+        auto stringId = [&](std::string s) {
+            strings.push_back(std::move(s));
+            return u64(strings.size() - 1);
+        };
+
+        // sample_type = {samples, count}
+        profile.message(1, ProtoWriter{}.varint(1, 1).varint(2, 2));
+        for (auto& [stack, cnt] : r.stacks) {
+            ProtoWriter sample;
+            // location_id, leaf first
+            for (usize i = stack.size(); i-- > 0;) {
+                auto [it, inserted] = locationIds.try_emplace(stack[i], locationIds.size() + 1);
+                sample.varint(1, it->second);
+            }
+            sample.varint(2, cnt);
+            profile.message(2, sample);
+        }
+        for (auto& [frame, id] : locationIds) {
+            auto [it, inserted] = functionIds.try_emplace(frame.section, functionIds.size() + 1);
+            ProtoWriter location;
+            location.varint(1, id);
+            location.varint(3, frame.ip);
+            location.message(4, ProtoWriter{}.varint(1, it->second).varint(2, lineOf(frame)));
+            profile.message(4, location);
+        }
+        for (auto& [section, id] : functionIds) {
+            u64 name = stringId(nameOf(section));
+            profile.message(5, ProtoWriter{}.varint(1, id).varint(2, name).varint(3, name));
+        }
+        for (auto& s : strings) {
+            profile.bytes(6, s);
+        }
+        // period_type = {cpu, nanoseconds}
+        profile.message(11, ProtoWriter{}.varint(1, 3).varint(2, 4));
+        profile.varint(12, u64(std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count()));
+        return std::move(profile.out);
+    }
+
+  private:
+    std::chrono::microseconds interval;
+    std::mutex threadsMutex;
+    std::vector<std::pair<ThreadVM*, std::unique_ptr<SampleBuffer>>> threads;
+    std::thread timer;
+    std::condition_variable stopCv;
+    bool stopping = false;
+
+    static u32 lineOf(const ProfileFrame& f) {
+        return f.ip < f.section->lines.size() ? f.section->lines[f.ip] : f.ip;
+    }
+
+    static std::string nameOf(const Section* s) {
+        if (!s->name.empty()) {
+            return s->name;
+        }
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "fn@%p", static_cast<const void*>(s));
+        return buf;
+    }
+
+    // protobuf wire format, enough for profile.proto
+    struct ProtoWriter {
+        std::string out;
+
+        void raw(u64 v) {
+            for (; v >= 0x80; v >>= 7) {
+                out += char(v | 0x80);
+            }
+            out += char(v);
+        }
+        ProtoWriter& varint(u32 field, u64 v) {
+            raw(u64(field) << 3);
+            raw(v);
+            return *this;
+        }
+        ProtoWriter& bytes(u32 field, const std::string& s) {
+            raw((u64(field) << 3) | 2);
+            raw(s.size());
+            out += s;
+            return *this;
+        }
+        ProtoWriter& message(u32 field, const ProtoWriter& m) { return bytes(field, m.out); }
+    };
+};
+
+}
@@ -0,0 +1,256 @@
+/**
+ * @file scheduler.hpp
+ * @author agent
+ * @brief run evaluation tasks on multiple ThreadVM
+ * @date 2026-10-18
+ *
+ * @details
+ *
+ * each worker thread owns one ThreadVM (register stack, AUTO stack, inline caches) and one work stealing deque.
+ * task submitted from worker goes to its own deque, from other threads goes to injection queue.
+ * idle worker steals from others, then sleeps until something submitted.
+ *
+ * evaluation suspended at pending extern call does not block worker, it is requeued when its future completed,
+ * so one worker can multiplex many in-flight evaluations.
+ *
+ * Section / CONST are immutable after loaded, so they are shared by workers without lock.
+ * heap is shared: each worker allocates in Tlab and records stores in StoreBuffer of its own ThreadVM, and is
+ * attached to Memory while running a task, so minor GC started by one worker stops the others at their safepoints.
+ * parked tasks are scanned as GC roots through VM::addParked().
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Requeue suspended task and add C++20 awaitable evaluate().</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Attach workers to Memory while running, scan parked tasks.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Remove ThreadVM of worker when it exits.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "defs.hpp"
+#include "runtime/coroutine.hpp"
+#include "runtime/interpreter.hpp"
+#include "runtime/vm.hpp"
+#include "tools/work_stealing_deque.hpp"
+
+namespace rulejit {
+
+struct Scheduler {
+    using Section = CodeManager::Section;
+    // called on worker thread, returned values are valid only during callback
+    using Callback = std::move_only_function<void(ExecResult, std::span<reg>)>;
+
+    struct Task {
+        const Section* f;
+        std::vector<reg> args;
+        Callback done;
+        // set if task is parked at pending extern call
+        std::unique_ptr<Coroutine> parked = nullptr;
+    };
+
+    Scheduler(VM& vm, usize workerCnt = std::thread::hardware_concurrency())
+        : vm(vm), interpreter{&vm.ctx, &vm.globalMemory} {
+        if (workerCnt == 0) {
+            workerCnt = 1;
+        }
+        for (usize i = 0; i < workerCnt; ++i) {
+            auto& w = workers.emplace_back();
+            w.owner = this;
+            w.t = &vm.addThread();
+            w.seed = i + 1;
+        }
+        for (auto& w : workers) {
+            w.thread = std::thread([this, &w]() { workerLoop(w); });
+        }
+    }
+    Scheduler(const Scheduler&) = delete;
+    auto& operator=(const Scheduler&) = delete;
+
+    ~Scheduler() {
+        stopping.store(true, std::memory_order_release);
+        signal.fetch_add(1, std::memory_order_release);
+        signal.notify_all();
+        for (auto& w : workers) {
+            w.thread.join();
+        }
+    }
+
+    /**
+     * @brief submit task, can called from any thread including worker
+     *
+     */
+    void submit(Task task) {
+        inflight.fetch_add(1, std::memory_order_relaxed);
+        push(new Task(std::move(task)));
+    }
+
+    /**
+     * @brief awaitable of one evaluation, map evaluation to C++20 coroutine of embedding code:
+     * ```auto [result, rets] = co_await scheduler.evaluate(f, args);```
+     * awaiting coroutine is resumed on worker thread.
+     *
+     */
+    struct EvalAwaitable {
+        Scheduler* s;
+        const Section* f;
+        std::vector<reg> args;
+
+        ExecResult result = {};
+        std::vector<reg> rets = {};
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) {
+            s->submit({.f = f, .args = std::move(args), .done = [this, h](ExecResult r, std::span<reg> ret) {
+                           result = r;
+                           rets.assign(ret.begin(), ret.end());
+                           h.resume();
+                       }});
+        }
+        std::pair<ExecResult, std::vector<reg>> await_resume() { return {result, std::move(rets)}; }
+    };
+    EvalAwaitable evaluate(const Section* f, std::vector<reg> args) {
+        return {.s = this, .f = f, .args = std::move(args)};
+    }
+
+    /**
+     * @brief block until all submitted task finished, SHOULDNOT called from worker
+     *
+     */
+    void wait() {
+        for (usize n = inflight.load(std::memory_order_acquire); n != 0; n = inflight.load(std::memory_order_acquire)) {
+            inflight.wait(n, std::memory_order_acquire);
+        }
+    }
+
+    usize workerCount() const { return workers.size(); }
+
+  private:
+    struct Worker {
+        Scheduler* owner;
+        ThreadVM* t;
+        tools::WorkStealingDeque<Task*> local;
+        std::thread thread;
+        // xorshift state to pick victim
+        u64 seed;
+    };
+
+    VM& vm;
+    Interpreter interpreter;
+    // deque to keep address stable
+    std::deque<Worker> workers;
+
+    std::mutex injectMutex;
+    std::deque<Task*> inject;
+
+    // changed on every submit, idle worker waits on it
+    std::atomic<u32> signal = 0;
+    std::atomic<usize> inflight = 0;
+    std::atomic<bool> stopping = false;
+
+    inline static thread_local Worker* current = nullptr;
+
+    void push(Task* p) {
+        if (current != nullptr && current->owner == this) {
+            current->local.push(p);
+        } else {
+            std::lock_guard lock{injectMutex};
+            inject.push_back(p);
+        }
+        signal.fetch_add(1, std::memory_order_release);
+        signal.notify_one();
+    }
+
+    Task* find(Worker& w) {
+        if (auto p = w.local.pop()) {
+            return *p;
+        }
+        {
+            std::lock_guard lock{injectMutex};
+            if (!inject.empty()) {
+                Task* p = inject.front();
+                inject.pop_front();
+                return p;
+            }
+        }
+        w.seed ^= w.seed << 13;
+        w.seed ^= w.seed >> 7;
+        w.seed ^= w.seed << 17;
+        usize start = w.seed % workers.size();
+        for (usize i = 0; i < workers.size(); ++i) {
+            auto& victim = workers[(start + i) % workers.size()];
+            if (&victim == &w) {
+                continue;
+            }
+            if (auto p = victim.local.steal()) {
+                return *p;
+            }
+        }
+        return nullptr;
+    }
+
+    void workerLoop(Worker& w) {
+        current = &w;
+        std::vector<reg> rets;
+        for (;;) {
+            Task* task = find(w);
+            if (task == nullptr) {
+                u32 seen = signal.load(std::memory_order_acquire);
+                // check again, submit may happened before seen loaded
+                task = find(w);
+                if (task == nullptr) {
+                    if (stopping.load(std::memory_order_acquire)) {
+                        break;
+                    }
+                    signal.wait(seen, std::memory_order_acquire);
+                    continue;
+                }
+            }
+
+            rets.resize(task->f->info.returnCnt);
+            std::unique_ptr<Coroutine> parked;
+            vm.globalMemory.attachMutator();
+            if (task->parked) {
+                vm.removeParked(task->parked.get());
+            }
+            ExecResult r = task->parked ? interpreter.resume(*w.t, std::move(task->parked), rets, &parked)
+                                        : interpreter.execute(*w.t, task->f, task->args, rets, &parked);
+            if (r == ExecResult::kSuspended) {
+                // still attached, so GC can not run before it is scanned as root
+                vm.addParked(parked.get());
+            }
+            vm.globalMemory.detachMutator();
+            if (r == ExecResult::kSuspended) {
+                // worker moves on, task comes back to any worker when extern call completed
+                auto future = parked->future;
+                task->parked = std::move(parked);
+                future->onReady([this, task]() { push(task); });
+                continue;
+            }
+            if (task->done) {
+                task->done(r, rets);
+            }
+            delete task;
+            if (inflight.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                inflight.notify_all();
+            }
+        }
+        current = nullptr;
+        // no task left, ThreadVM holds no frame
+        vm.removeThread(w.t);
+    }
+};
+
+}
@@ -0,0 +1,641 @@
+/**
+ * @file snapshot.hpp
+ * @author agent
+ * @brief save initialized code and heap as image, and start from it by mmap
+ * @date 2026-10-18
+ *
+ * @details
+ *
+ * image layout, all offsets are from begin of file:
+ *   | Header | sections | padding | heap (page aligned) | heap relocations |
+ *
+ * sections: every Section of CodeManager in order. values in CONST / STATIC are tagged:
+ *   1. pointer kind (loaded by LOADcp / LOADstp): offset of object in heap image, unless a tagged immediate
+ *   2. recorded in Section::addressSlots as function value: index of section
+ *   3. recorded in Section::addressSlots as VTable*: (type, trait) of it, found in VTableManager when loaded
+ *   4. others: as-is
+ * extern function is saved by name only, and bound through ExternRegistry when loaded.
+ * STATIC initializers should have run, initialized slots are saved as plain STATIC.
+ * pointer maps are not saved, every section saved as verified is verified again when loaded, so a corrupted
+ * image is rejected instead of executed unchecked.
+ *
+ * heap: objects reachable from STATIC / CONST, with header, in BFS order. pointer members are absolute addresses
+ * for Header::base, so if image is mapped at the same address nothing is written and all pages of heap image
+ * are shared by processes mapping the same file (MAP_PRIVATE, copy-on-write when written by VM). otherwise
+ * pointer members listed in heap relocations are patched.
+ * heap image is managed by Memory as static memory, objects in it never move and are never collected.
+ *
+ * image is only valid for the same build, since code and layout are saved as-is.
+ * data member of heap object has no record of what it holds, so image is refused if one of them equals address of
+ * a section or VTable.
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Seal CONST patched by function values.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Save safepoints and AUTO slots of pointer maps, version 2.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Keep tagged immediates as data.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Verify loaded sections, relocate recorded address slots, version 3.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Save STATIC with initializer once initialized.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Check heap relocations before sections added.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <expected>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "defs.hpp"
+#include "backend/bytecode/opcode.hpp"
+#include "backend/bytecode/verifier.hpp"
+#include "runtime/ffi.hpp"
+#include "runtime/gc/mem.hpp"
+#include "runtime/vm.hpp"
+#include "runtime/vtable.hpp"
+
+namespace rulejit {
+
+struct SnapshotError {
+    const char* reason;
+};
+
+/**
+ * @brief mapped image, should outlive sections restored from it and Memory using its heap
+ *
+ */
+struct SnapshotImage {
+    using Section = CodeManager::Section;
+
+    SnapshotImage(void* base, usize size, Memory* mem) : base(base), size(size), mem(mem) {}
+    SnapshotImage(const SnapshotImage&) = delete;
+    auto& operator=(const SnapshotImage&) = delete;
+    ~SnapshotImage() {
+        if (heapSize != 0) {
+            mem->removeStaticRegion(heap, heapSize);
+        }
+        munmap(base, size);
+    }
+
+    const Section* find(std::string_view name) const {
+        for (auto* s : sections) {
+            if (s->name == name) {
+                return s;
+            }
+        }
+        return nullptr;
+    }
+
+    // in order of CodeManager when saved
+    std::vector<const Section*> sections;
+    // heap image is not mapped at saved address, pages with pointer are no longer shared
+    bool relocated = false;
+
+    void* base;
+    usize size;
+    Memory* mem;
+    std::byte* heap = nullptr;
+    usize heapSize = 0;
+};
+
+struct Snapshot {
+    using Section = CodeManager::Section;
+
+    // "RJITIMG1"
+    static constexpr u64 kMagic = 0x31474d4954494a52;
+    static constexpr u32 kVersion = 3;
+    // image is mapped here if possible, so heap pointers need no relocation
+    static constexpr usize kDefaultBase = 0x3e0000000000;
+
+    /**
+     * @brief save all sections of cm and objects they refer to. GC should not be running
+     *
+     * @param base address to map image when loading
+     * @param vtm VTables referred by address slots, nullptr if none
+     */
+    static std::expected<void, SnapshotError> save(const std::string& path, const CodeManager& cm, Memory& mem,
+                                                   usize base = kDefaultBase, const VTableManager* vtm = nullptr) {
+        if (!mem.idle()) {
+            return std::unexpected(SnapshotError{"GC is running"});
+        }
+        if (base % PageSize != 0) {
+            return std::unexpected(SnapshotError{"base not aligned"});
+        }
+        std::unordered_map<const Section*, u32> sectionIds;
+        for (auto& s : cm.all()) {
+            sectionIds.emplace(&s, u32(sectionIds.size()));
+        }
+
+        // layout of heap image, offset of object is offset of its first member
+        std::unordered_map<reg*, u64> objects;
+        std::vector<reg*> order;
+        u64 heapEnd = 0;
+        auto visit = [&](reg* p) {
+            if (p == nullptr || helper::isImmediate(p) || objects.contains(p)) {
+                return;
+            }
+            objects.emplace(p, heapEnd + sizeof(reg));
+            heapEnd += sizeof(reg) + alignUp(mem.objectSize(p), sizeof(reg));
+            order.push_back(p);
+        };
+        for (auto& s : cm.all()) {
+            auto [constPtr, staticPtr] = pointerSlots(s);
+            for (usize i = 0; i < s.constant.size(); ++i) {
+                if (constPtr[i]) {
+                    visit(std::bit_cast<reg*>(s.constant[i]));
+                }
+            }
+            for (usize i = 0; i < s.staticVar.size(); ++i) {
+                if (staticPtr[i]) {
+                    visit(std::bit_cast<reg*>(s.staticVar[i]));
+                }
+            }
+        }
+        for (usize i = 0; i < order.size(); ++i) {
+            mem.forEachPointerMember(order[i], [&](reg** f) { visit(*f); });
+        }
+        if (const char* reason = checkHeapData(order, mem, cm, vtm); reason) {
+            return std::unexpected(SnapshotError{reason});
+        }
+
+        Writer w;
+        for (auto& s : cm.all()) {
+            if (s.native != nullptr && s.name.empty()) {
+                return std::unexpected(SnapshotError{"extern function without name"});
+            }
+            for (auto& i : s.staticInits) {
+                if (s.staticState[i.slot].load(std::memory_order_acquire) != Section::kStaticReady) {
+                    return std::unexpected(SnapshotError{"STATIC initializer not run before snapshot"});
+                }
+            }
+            if (const char* reason = writeSection(w, s, sectionIds, objects); reason) {
+                return std::unexpected(SnapshotError{reason});
+            }
+        }
+
+        Header h{};
+        h.magic = kMagic;
+        h.version = kVersion;
+        h.pageSize = PageSize;
+        h.base = base;
+        h.heapOffset = alignUp(sizeof(Header) + w.out.size(), PageSize);
+        h.heapSize = alignUp(heapEnd, PageSize);
+        h.relocOffset = h.heapOffset + h.heapSize;
+        h.sectionCnt = u32(sectionIds.size());
+
+        std::string heap(h.heapSize, '\0');
+        std::vector<u64> relocs;
+        u64 heapBase = base + h.heapOffset;
+        for (reg* p : order) {
+            u64 off = objects[p];
+            ObjHeader header = helper::getHeader(p);
+            header.removeFlag(ObjHeader::Flags::kIsMinorObject);
+            std::memcpy(heap.data() + off - sizeof(reg), &header, sizeof(reg));
+            std::memcpy(heap.data() + off, p, mem.objectSize(p));
+            mem.forEachPointerMember(p, [&](reg** f) {
+                if (*f == nullptr || helper::isImmediate(*f)) {
+                    return;
+                }
+                u64 at = off + u64(reinterpret_cast<reg*>(f) - p) * sizeof(reg);
+                u64 target = heapBase + objects[*f];
+                std::memcpy(heap.data() + at, &target, sizeof(u64));
+                relocs.push_back(at);
+            });
+        }
+        h.relocCnt = relocs.size();
+        h.fileSize = h.relocOffset + relocs.size() * sizeof(u64);
+
+        std::FILE* f = std::fopen(path.c_str(), "wb");
+        if (f == nullptr) {
+            return std::unexpected(SnapshotError{"can not open file"});
+        }
+        std::string padding(h.heapOffset - sizeof(Header) - w.out.size(), '\0');
+        bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1 &&
+                  std::fwrite(w.out.data(), 1, w.out.size(), f) == w.out.size() &&
+                  std::fwrite(padding.data(), 1, padding.size(), f) == padding.size() &&
+                  std::fwrite(heap.data(), 1, heap.size(), f) == heap.size() &&
+                  std::fwrite(relocs.data(), sizeof(u64), relocs.size(), f) == relocs.size();
+        ok = std::fclose(f) == 0 && ok;
+        if (!ok) {
+            return std::unexpected(SnapshotError{"write failed"});
+        }
+        return {};
+    }
+
+    /**
+     * @brief map image and add its sections into cm, heap image is managed by mem as static memory
+     *
+     * @param externs to bind extern functions by name
+     * @param vtm to find VTables referred by address slots, their impls should be loaded before
+     */
+    static std::expected<std::unique_ptr<SnapshotImage>, SnapshotError> load(const std::string& path, CodeManager& cm,
+                                                                            Memory& mem,
+                                                                            const ExternRegistry& externs,
+                                                                            const VTableManager* vtm = nullptr) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return std::unexpected(SnapshotError{"can not open file"});
+        }
+        struct stat st;
+        Header h;
+        if (fstat(fd, &st) != 0 || pread(fd, &h, sizeof(h), 0) != sizeof(h)) {
+            close(fd);
+            return std::unexpected(SnapshotError{"truncated image"});
+        }
+        if (h.magic != kMagic || h.version != kVersion || h.pageSize != PageSize) {
+            close(fd);
+            return std::unexpected(SnapshotError{"not an image of this build"});
+        }
+        if (h.fileSize != usize(st.st_size) || h.heapOffset % PageSize != 0 || h.heapOffset < sizeof(Header) ||
+            h.heapOffset + h.heapSize != h.relocOffset || h.relocOffset + h.relocCnt * sizeof(u64) != h.fileSize) {
+            close(fd);
+            return std::unexpected(SnapshotError{"corrupted image"});
+        }
+
+        void* addr = mapAt(fd, h.base, h.fileSize);
+        if (addr == MAP_FAILED) {
+            addr = mmap(nullptr, h.fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if (addr == MAP_FAILED) {
+            return std::unexpected(SnapshotError{"mmap failed"});
+        }
+        auto image = std::make_unique<SnapshotImage>(addr, h.fileSize, &mem);
+        auto* bytes = static_cast<std::byte*>(addr);
+        // checked before anything added into cm, wherever image is mapped
+        auto* relocs = reinterpret_cast<const u64*>(bytes + h.relocOffset);
+        for (u64 i = 0; i < h.relocCnt; ++i) {
+            if (relocs[i] % sizeof(u64) != 0 || relocs[i] >= h.heapSize) {
+                return std::unexpected(SnapshotError{"corrupted image"});
+            }
+        }
+
+        // parse all before adding any into cm, function values are patched after all added since sections may
+        // refer to sections behind
+        std::vector<Section> parsed;
+        std::vector<const Section*> bound;
+        std::vector<Fixup> fixups;
+        Reader r{bytes + sizeof(Header), bytes + h.heapOffset};
+        u64 heapBase = u64(addr) + h.heapOffset;
+        for (u32 i = 0; i < h.sectionCnt; ++i) {
+            u8 native;
+            std::string name;
+            if (!r.get(native) || !r.getString(name)) {
+                return std::unexpected(SnapshotError{"corrupted image"});
+            }
+            if (native) {
+                const Section* s = externs.find(name);
+                if (s == nullptr) {
+                    return std::unexpected(SnapshotError{"extern function not registered"});
+                }
+                bound.push_back(s);
+                continue;
+            }
+            if (const char* reason = readSection(r, parsed.emplace_back(), i, heapBase, h.heapSize, vtm, fixups);
+                reason) {
+                return std::unexpected(SnapshotError{reason});
+            }
+            parsed.back().name = std::move(name);
+            bound.push_back(nullptr);
+        }
+        for (auto& fix : fixups) {
+            if (fix.target >= bound.size()) {
+                return std::unexpected(SnapshotError{"corrupted image"});
+            }
+        }
+        std::vector<Section*> added(bound.size(), nullptr);
+        for (usize i = 0, j = 0; i < bound.size(); ++i) {
+            if (bound[i] == nullptr) {
+                added[i] = cm.add(std::move(parsed[j++]));
+                bound[i] = added[i];
+            }
+        }
+        for (auto& fix : fixups) {
+            auto value = std::bit_cast<reg>(bound[fix.target]);
+            if (fix.isStatic) {
+                added[fix.section]->staticVar[fix.slot] = value;
+            } else {
+                added[fix.section]->constant.set(fix.slot, value);
+            }
+        }
+        for (auto* s : added) {
+            if (s != nullptr) {
+                cm.seal(s);
+            }
+        }
+        image->sections = std::move(bound);
+
+        image->heap = bytes + h.heapOffset;
+        image->heapSize = h.heapSize;
+        if (addr != reinterpret_cast<void*>(h.base)) {
+            image->relocated = true;
+            u64 delta = u64(addr) - h.base;
+            for (u64 i = 0; i < h.relocCnt; ++i) {
+                reinterpret_cast<u64*>(image->heap + relocs[i])[0] += delta;
+            }
+        }
+        if (image->heapSize != 0) {
+            mem.addStaticRegion(image->heap, image->heapSize);
+        }
+        return image;
+    }
+
+  private:
+    struct Header {
+        u64 magic;
+        u32 version;
+        u32 pageSize;
+        // address image is expected to be mapped at
+        u64 base;
+        u64 fileSize;
+        u64 heapOffset;
+        u64 heapSize;
+        u64 relocOffset;
+        u64 relocCnt;
+        u32 sectionCnt;
+        u32 reserved;
+    };
+
+    enum class Tag : u8 {
+        kData,
+        kSection,
+        kHeap,
+        kVTable,
+    };
+
+    struct Writer {
+        std::string out;
+
+        template <typename T>
+        void put(const T& v) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            out.append(reinterpret_cast<const char*>(&v), sizeof(T));
+        }
+        template <typename T>
+        void putVector(const std::vector<T>& v) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            put(u64(v.size()));
+            out.append(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+        }
+        void putString(const std::string& s) {
+            put(u64(s.size()));
+            out += s;
+        }
+    };
+
+    struct Reader {
+        const std::byte* p;
+        const std::byte* end;
+
+        template <typename T>
+        bool get(T& v) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            if (usize(end - p) < sizeof(T)) {
+                return false;
+            }
+            std::memcpy(&v, p, sizeof(T));
+            p += sizeof(T);
+            return true;
+        }
+        template <typename T>
+        bool getVector(std::vector<T>& v) {
+            u64 n;
+            if (!get(n) || n > usize(end - p) / sizeof(T)) {
+                return false;
+            }
+            v.resize(n);
+            if (n != 0) {
+                std::memcpy(v.data(), p, n * sizeof(T));
+            }
+            p += n * sizeof(T);
+            return true;
+        }
+        bool getString(std::string& s) {
+            u64 n;
+            if (!get(n) || n > usize(end - p)) {
+                return false;
+            }
+            s.assign(reinterpret_cast<const char*>(p), n);
+            p += n;
+            return true;
+        }
+    };
+
+    static constexpr usize alignUp(usize n, usize align) { return (n + align - 1) / align * align; }
+
+    static void* mapAt(int fd, u64 base, usize size) {
+#ifdef MAP_FIXED_NOREPLACE
+        void* addr = mmap(reinterpret_cast<void*>(base), size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_FIXED_NOREPLACE, fd, 0);
+#else
+        void* addr = mmap(reinterpret_cast<void*>(base), size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+#endif
+        if (addr != MAP_FAILED && addr != reinterpret_cast<void*>(base)) {
+            // hint is not taken by kernel
+            munmap(addr, size);
+            return MAP_FAILED;
+        }
+        return addr;
+    }
+
+    // CONST / STATIC slots of pointer kind
+    static std::pair<std::vector<bool>, std::vector<bool>> pointerSlots(const Section& s) {
+        std::vector<bool> constPtr(s.constant.size()), staticPtr(s.staticVar.size());
+        for (auto ins : s.code) {
+            if (ins.op() == OPCode::LOADcp && ins.bcOffset() < constPtr.size()) {
+                constPtr[ins.bcOffset()] = true;
+            } else if (ins.op() == OPCode::LOADstp && ins.b() < staticPtr.size()) {
+                staticPtr[ins.b()] = true;
+            }
+        }
+        return {std::move(constPtr), std::move(staticPtr)};
+    }
+
+    /**
+     * @brief data members of heap objects should not hold address of section or VTable, they can not be relocated
+     *
+     * @return const char* reason, nullptr if ok
+     */
+    static const char* checkHeapData(const std::vector<reg*>& order, Memory& mem, const CodeManager& cm,
+                                     const VTableManager* vtm) {
+        std::unordered_set<u64> addresses;
+        for (auto& s : cm.all()) {
+            addresses.insert(u64(&s));
+        }
+        if (vtm != nullptr) {
+            for (auto& vt : vtm->all()) {
+                addresses.insert(u64(&vt));
+            }
+        }
+        std::vector<bool> isPtr;
+        for (reg* p : order) {
+            isPtr.assign(mem.objectSize(p) / sizeof(reg), false);
+            mem.forEachPointerMember(p, [&](reg** f) { isPtr[reinterpret_cast<reg*>(f) - p] = true; });
+            for (usize i = 0; i < isPtr.size(); ++i) {
+                if (!isPtr[i] && addresses.contains(p[i].as<u64>())) {
+                    return "heap object holds function value or VTable*";
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief write section, address slots are written by what they refer to
+     *
+     * @return const char* reason, nullptr if ok
+     */
+    static const char* writeSection(Writer& w, const Section& s,
+                                    const std::unordered_map<const Section*, u32>& sectionIds,
+                                    const std::unordered_map<reg*, u64>& objects) {
+        w.put(u8(s.native != nullptr));
+        w.putString(s.name);
+        if (s.native != nullptr) {
+            return nullptr;
+        }
+        w.put(u8(s.verified));
+        w.put(s.info);
+        w.putVector(s.code);
+        w.putVector(s.traitCallSites);
+        w.putVector(s.exceptionTable);
+        w.putVector(s.lines);
+
+        auto [constPtr, staticPtr] = pointerSlots(s);
+        std::vector<const Section::AddressSlot*> constAddr(s.constant.size()), staticAddr(s.staticVar.size());
+        for (auto& a : s.addressSlots) {
+            auto& addr = a.isStatic ? staticAddr : constAddr;
+            auto& isPtr = a.isStatic ? staticPtr : constPtr;
+            if (a.slot >= addr.size() || isPtr[a.slot]) {
+                return "address slot out of range or of pointer kind";
+            }
+            addr[a.slot] = &a;
+        }
+        auto values = [&](std::span<const reg> v, const std::vector<bool>& isPtr,
+                          const std::vector<const Section::AddressSlot*>& addr) -> const char* {
+            w.put(u64(v.size()));
+            for (usize i = 0; i < v.size(); ++i) {
+                auto* p = std::bit_cast<reg*>(v[i]);
+                if (isPtr[i] && p != nullptr && !helper::isImmediate(p)) {
+                    w.put(Tag::kHeap);
+                    w.put(objects.at(p));
+                } else if (addr[i] != nullptr && addr[i]->kind == Section::AddressSlot::Kind::kFunction) {
+                    auto it = sectionIds.find(std::bit_cast<const Section*>(v[i]));
+                    if (it == sectionIds.end()) {
+                        return "function value not in CodeManager";
+                    }
+                    w.put(Tag::kSection);
+                    w.put(u64(it->second));
+                } else if (addr[i] != nullptr) {
+                    auto* vt = std::bit_cast<const VTable*>(v[i]);
+                    if (vt == nullptr) {
+                        return "VTable* is null";
+                    }
+                    w.put(Tag::kVTable);
+                    w.put((u64(vt->type.data) << 32) | u64(vt->trait.data));
+                } else {
+                    w.put(Tag::kData);
+                    w.put(v[i]);
+                }
+            }
+            return nullptr;
+        };
+        if (const char* reason = values(s.constant, constPtr, constAddr); reason) {
+            return reason;
+        }
+        return values(s.staticVar, staticPtr, staticAddr);
+    }
+
+    // function value in CONST / STATIC of section
+    struct Fixup {
+        u32 section;
+        bool isStatic;
+        usize slot;
+        u32 target;
+    };
+
+    /**
+     * @brief read section except native flag and name, function values are appended to fixups.
+     * section saved as verified is verified again, pointer maps are rebuilt by Verifier
+     *
+     * @return const char* reason, nullptr if ok
+     */
+    static const char* readSection(Reader& r, Section& s, u32 id, u64 heapBase, u64 heapSize,
+                                   const VTableManager* vtm, std::vector<Fixup>& fixups) {
+        constexpr const char* kCorrupted = "corrupted image";
+        u8 verified;
+        if (!r.get(verified) || !r.get(s.info) || !r.getVector(s.code) || !r.getVector(s.traitCallSites) ||
+            !r.getVector(s.exceptionTable) || !r.getVector(s.lines)) {
+            return kCorrupted;
+        }
+
+        const char* error = nullptr;
+        auto values = [&](std::vector<reg>& v, bool isStatic) {
+            u64 n;
+            if (!r.get(n) || n > usize(r.end - r.p) / (sizeof(Tag) + sizeof(reg))) {
+                return false;
+            }
+            v.resize(n);
+            for (usize i = 0; i < n; ++i) {
+                Tag tag;
+                u64 value;
+                if (!r.get(tag) || !r.get(value)) {
+                    return false;
+                }
+                switch (tag) {
+                case Tag::kData:
+                    v[i] = std::bit_cast<reg>(value);
+                    break;
+                case Tag::kSection:
+                    fixups.push_back({id, isStatic, i, u32(value)});
+                    s.addressSlots.push_back({Section::AddressSlot::Kind::kFunction, isStatic, u32(i)});
+                    break;
+                case Tag::kHeap:
+                    if (value >= heapSize) {
+                        return false;
+                    }
+                    v[i] = std::bit_cast<reg>(heapBase + value);
+                    break;
+                case Tag::kVTable: {
+                    const VTable* vt = vtm == nullptr ? nullptr : vtm->find(TypeToken{u32(value >> 32)}, TraitToken{u32(value)});
+                    if (vt == nullptr) {
+                        error = "VTable not loaded";
+                        return false;
+                    }
+                    v[i] = std::bit_cast<reg>(vt);
+                    s.addressSlots.push_back({Section::AddressSlot::Kind::kVTable, isStatic, u32(i)});
+                    break;
+                }
+                default:
+                    return false;
+                }
+            }
+            return true;
+        };
+        std::vector<reg> constant;
+        if (!values(constant, false) || !values(s.staticVar, true)) {
+            return error != nullptr ? error : kCorrupted;
+        }
+        s.constant = std::move(constant);
+        if (verified && !Verifier::verify(s)) {
+            return "section of image fails verification";
+        }
+        return nullptr;
+    }
+};
+
+}
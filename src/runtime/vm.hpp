@@ -10,35 +10,293 @@
  * <table>
  * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
  * <tr><td>nanaglutamate</td><td>2024-11-15</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Add VTableManager and trait call site cache.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Add register kinds, pointer map and call frames.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Move inline caches into ThreadVM.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Add extern function section.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Add chunked AUTO stack to ThreadVM.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Replace runtime traps with exception table of Section.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Add debug info of Section and sampling request of ThreadVM.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>List sections of CodeManager.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Add fuel of ThreadVM.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Intern CONST of sections into ConstantPool.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Add Tlab of ThreadVM.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Add StoreBuffer of ThreadVM.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Pointer maps at safepoints only, walk frames as GC roots.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Scan coroutines parked by embedder as roots.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Record CONST / STATIC slots holding address.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Resolve ImplToken into VTable when section added.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Lazy initializer of STATIC slot.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Scan pointers in exception payload.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Remove ThreadVM of exited thread.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Intern constant objects of CONST.</td></tr>
  * </table>
  */
 #pragma once
 
-#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <cassert>
+#include <deque>
 #include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
 
 #include "defs.hpp"
+#include "auto_stack.hpp"
+#include "constant_pool.hpp"
+#include "backend/bytecode/opcode.hpp"
 #include "gc/mem.hpp"
+#include "vtable.hpp"
 #include "ir/type.hpp"
 #include "ir/func.hpp"
 #include "ir/tplate.hpp"
 
 namespace rulejit {
 
+/**
+ * @brief registers hold pointer at each safepoint, generated by verifier for GC root scan
+ * safepoints are instructions GC may run at: calls, heap allocations and back edges. frame not on top of its ThreadVM stops
+ * at a call, registers of callee frame (behind args) are excluded from its map
+ * 
+ */
+struct RegisterPointerMap {
+    using Map = std::bitset<256>;
+    // sorted
+    std::vector<u32> safepoints;
+    // index to maps of each safepoint, describe registers hold pointer before it executes
+    std::vector<u16> index;
+    std::vector<Map> maps;
+    // AUTO offsets written from pointer register by ALLOCsr, zeroed when frame entered
+    std::vector<u32> autoSlots;
+
+    // nullptr if ip is not safepoint
+    const Map* at(u32 ip) const {
+        auto it = std::lower_bound(safepoints.begin(), safepoints.end(), ip);
+        if (it == safepoints.end() || *it != ip) {
+            return nullptr;
+        }
+        return &maps[index[it - safepoints.begin()]];
+    }
+};
+
+struct ExternFuture;
+struct SampleBuffer;
+
+enum class ExternStatus : u8 {
+    kDone,
+    // returned values will be given through ExternCall::future, evaluation is suspended until it completes
+    kPending,
+};
+
+struct ExternCall {
+    std::span<const reg> args;
+    std::span<reg> rets;
+    // bound when extern function registered
+    void* data;
+    // should be set by extern function if it returns ExternStatus::kPending
+    std::shared_ptr<ExternFuture> future;
+};
+using NativeFunction = ExternStatus (*)(ExternCall&);
+
+/**
+ * @brief one try block, handler catches exception thrown by instruction in [begin, end)
+ * 
+ */
+struct ExceptionRange {
+    static constexpr u64 kCatchAll = ~u64(0);
+
+    u32 begin;
+    u32 end;
+    u32 handler;
+    // type of exception (R[A] of THROW) to catch, or kCatchAll
+    u64 type;
+};
+
 struct CodeManager {
     struct Section {
-        std::vector<OPCode> code;
-        std::vector<reg> staticVar;
-        std::vector<reg> constant;
+        std::vector<Instruction> code;
+        // written by initializer of slot after added, see StaticInit
+        mutable std::vector<reg> staticVar;
+        // interned when added, see constant_pool.hpp
+        ConstantTable constant;
+        // indexed by OFFSET of CALLv
+        std::vector<TraitCallSite> traitCallSites;
+        // sorted by begin, ranges are nested or disjoint, inner one is behind outer one
+        std::vector<ExceptionRange> exceptionTable;
+        /**
+         * @brief CONST / STATIC slot of data kind holding address valid only in this process, recorded by whoever
+         * writes it (e.g. function value patched after section added), so snapshot can relocate it
+         * 
+         */
+        struct AddressSlot {
+            enum class Kind : u8 {
+                // const Section*
+                kFunction,
+                // const VTable*
+                kVTable,
+            };
+            Kind kind;
+            bool isStatic;
+            u32 slot;
+        };
+        std::vector<AddressSlot> addressSlots;
+        /**
+         * @brief CONST slot of data kind receiving VTable* of impl (e.g. to make trait object), resolved when added,
+         * see CodeManager::add()
+         * 
+         */
+        struct ImplSlot {
+            ImplToken impl;
+            u32 slot;
+        };
+        std::vector<ImplSlot> implSlots;
+        /**
+         * @brief STATIC slot initialized by first LOADst / LOADstp reading it, through calling init once. init takes
+         * no param and returns one value of the kind of slot. pointer slot is GC root since initialized
+         * 
+         */
+        struct StaticInit {
+            u32 slot;
+            const Section* init;
+        };
+        std::vector<StaticInit> staticInits;
+        // state of each STATIC slot made when added, nullptr if no initializer. otherwise address of ThreadVM running
+        // its initializer
+        static constexpr usize kStaticPending = 0, kStaticReady = 1;
+        std::unique_ptr<std::atomic<usize>[]> staticState;
         struct FunctionInfo {
+            // count of reg
             usize autoStorageRequirement;
             // never higher than 256 according to restriction of OPCode
             u8 regUsageCnt;
             u8 paramCnt;
             u8 returnCnt;
+            // !!pointerReg[n] if R[n] stores pointer, the same reg can only store data or pointer
+            // params are R[0, paramCnt), returned values are R[paramCnt, paramCnt + returnCnt)
+            std::bitset<256> pointerReg;
         } info;
+
+        // set by Verifier, unverified section can not be executed
+        bool verified = false;
+        RegisterPointerMap pointerMap;
+
+        // debug info, may empty. source line of each instruction
+        std::string name;
+        std::vector<u32> lines;
+
+        // not nullptr if implemented by extern function, code is empty then
+        NativeFunction native = nullptr;
+        void* nativeData = nullptr;
+
+        /**
+         * @brief innermost handler catches exception of type thrown at ip
+         * 
+         * @return nullptr if not caught in this section
+         */
+        const ExceptionRange* findHandler(u32 ip, u64 type) const {
+            auto it = std::upper_bound(exceptionTable.begin(), exceptionTable.end(), ip,
+                                       [](u32 ip, const ExceptionRange& r) { return ip < r.begin; });
+            // ranges begin before ip, inner ones first
+            while (it != exceptionTable.begin()) {
+                --it;
+                if (ip < it->end && (it->type == ExceptionRange::kCatchAll || it->type == type)) {
+                    return &*it;
+                }
+            }
+            return nullptr;
+        }
     };
     Section instantiation(const FunctionTemplate& ft) {}
+
+    /**
+     * @brief take ownership of section, section should be verified before executed.
+     * section is immutable after added and shared by all ThreadVM without lock.
+     * CONST is interned into constant pool, shared with sections of the same CONST.
+     * not thread safe, should called when loading
+     * 
+     * @return Section* address is stable
+     */
+    Section* add(Section&& s) {
+        assert(s.implSlots.empty() && "use add() resolving ImplToken");
+        for (auto& site : s.traitCallSites) {
+            site.cacheId = inlineCacheCnt++;
+        }
+        if (!s.staticInits.empty()) {
+            s.staticState = std::make_unique<std::atomic<usize>[]>(s.staticVar.size());
+            for (usize i = 0; i < s.staticVar.size(); ++i) {
+                s.staticState[i].store(Section::kStaticReady, std::memory_order_relaxed);
+            }
+            for (auto& i : s.staticInits) {
+                s.staticState[i.slot].store(Section::kStaticPending, std::memory_order_relaxed);
+            }
+        }
+        s.constant.intern(pool, constPointerSlots(s));
+        return &sections.emplace_back(std::move(s));
+    }
+
+    /**
+     * @brief as add(), VTable of each ImplToken in Section::implSlots is resolved (built when first loaded) and
+     * written into its CONST slot before interned
+     * 
+     * @param instantiate get function value of impl method from its template, see VTableManager::resolve()
+     * @return Section* address is stable
+     */
+    template <typename Instantiate>
+    Section* add(Section&& s, VTableManager& vtm, TypeManager& tm, Instantiate&& instantiate) {
+        for (auto& i : s.implSlots) {
+            assert(i.slot < s.constant.size());
+            s.constant.set(i.slot, std::bit_cast<reg>(vtm.resolve(i.impl, tm, instantiate)));
+            s.addressSlots.push_back({Section::AddressSlot::Kind::kVTable, false, i.slot});
+        }
+        s.implSlots.clear();
+        return add(std::move(s));
+    }
+
+    /**
+     * @brief intern CONST of added section again, after it is patched (e.g. function value referring to itself)
+     * 
+     */
+    void seal(Section* s) { s->constant.intern(pool, constPointerSlots(*s)); }
+
+    /**
+     * @brief add extern function, which can be called as normal function value
+     * 
+     * @param info only paramCnt, returnCnt and pointerReg are used
+     * @return Section* address is stable
+     */
+    Section* addNative(Section::FunctionInfo info, NativeFunction fn, void* data = nullptr) {
+        Section s;
+        s.info = info;
+        s.info.regUsageCnt = info.paramCnt + info.returnCnt;
+        s.verified = true;
+        s.native = fn;
+        s.nativeData = data;
+        return &sections.emplace_back(std::move(s));
+    }
+
+    const std::deque<Section>& all() const { return sections; }
+    const ConstantPool& constants() const { return pool; }
+
+  private:
+    std::deque<Section> sections;
+    ConstantPool pool;
+    u32 inlineCacheCnt = 0;
+
+    // CONST slots loaded by LOADcp, objects referred by them are interned
+    static std::vector<bool> constPointerSlots(const Section& s) {
+        std::vector<bool> ptr(s.constant.size());
+        for (auto ins : s.code) {
+            if (ins.op() == OPCode::LOADcp && ins.bcOffset() < ptr.size()) {
+                ptr[ins.bcOffset()] = true;
+            }
+        }
+        return ptr;
+    }
 };
 
 struct VMContext {
@@ -48,15 +306,121 @@ struct VMContext {
     TypeManager* tm;
 
     CodeManager* cm;
+    VTableManager* vtm;
 };
 
 struct ThreadVM {
+    // register stack, R[n] of current function is r[frames.back().base + n]
     std::vector<reg> r;
-    std::vector<reg*> a;
+    // AUTO stack, AUTO[n] of current function is frames.back().autoBase[n]
+    AutoStack a;
     struct FunctionExecutionContext {
+        const CodeManager::Section* section;
+        // IP to continue in this function
+        u32 ip;
+        // index of R[0] in r
+        usize base;
+        reg* autoBase;
+        // HEAD of AUTO stack before this frame entered
+        AutoStack::Mark autoMark;
     };
+    std::vector<FunctionExecutionContext> frames;
+
+    struct Exception {
+        reg type;
+        std::vector<reg> payload;
+        // payload[n] is pointer if pointerMask[n], kinds of registers thrown
+        std::bitset<256> pointerMask;
+    } exception;
+
+    // indexed by TraitCallSite::cacheId
+    std::vector<InlineCache> inlineCaches;
+
+    // nursery chunk objects allocated by ALLOChr / ALLOChc are bumped in
+    Tlab tlab;
+    // slots recorded by write barrier of STORE*p
+    StoreBuffer storeBuffer;
+
+    // set by Profiler, polled by interpreter at call and back edge
+    std::atomic<bool> sampleRequested = false;
+    SampleBuffer* samples = nullptr;
+
+    // instruction budget, one is charged at each call and back edge if enabled.
+    // evaluation returns ExecResult::kOutOfFuel when it is 0
+    struct Fuel {
+        bool enabled = false;
+        u64 left = 0;
+        // stats of the last evaluation: fuel charged, and where it ran out (nullptr if not)
+        u64 used = 0;
+        const CodeManager::Section* exhaustedIn = nullptr;
+        u32 exhaustedAt = 0;
+    } fuel;
 };
 
+/**
+ * @brief call f with address of each slot of frame holding pointer, R is R[0] of frame
+ * frame should stop at safepoint (ip is behind it), or not started yet
+ * 
+ */
+template <typename F>
+void forEachFrameRoot(const ThreadVM::FunctionExecutionContext& frame, reg* R, F&& f) {
+    auto& info = frame.section->info;
+    auto& pm = frame.section->pointerMap;
+    if (frame.ip == 0) {
+        for (u32 i = 0; i < info.paramCnt; ++i) {
+            if (info.pointerReg[i]) {
+                f(&R[i].as<reg*>());
+            }
+        }
+    } else if (const auto* m = pm.at(frame.ip - 1)) {
+        for (u32 i = 0; i < info.regUsageCnt; ++i) {
+            if ((*m)[i]) {
+                f(&R[i].as<reg*>());
+            }
+        }
+    } else {
+        assert(false && "frame is not at safepoint");
+    }
+    for (u32 slot : pm.autoSlots) {
+        f(&frame.autoBase[slot].as<reg*>());
+    }
+}
+
+/**
+ * @brief call f with address of each register and AUTO slot of t holding pointer, precisely by pointer maps, and
+ * each pointer in payload of last exception thrown
+ * 
+ */
+template <typename F>
+void forEachRoot(ThreadVM& t, F&& f) {
+    for (auto& frame : t.frames) {
+        forEachFrameRoot(frame, t.r.data() + frame.base, f);
+    }
+    for (usize i = 0; i < t.exception.payload.size(); ++i) {
+        if (t.exception.pointerMask[i]) {
+            f(&t.exception.payload[i].as<reg*>());
+        }
+    }
+}
+
+/**
+ * @brief pointer STATIC slots whose initializer returned, other STATIC are data or not written yet
+ * 
+ */
+template <typename F>
+void forEachRoot(const CodeManager::Section& s, F&& f) {
+    for (auto& i : s.staticInits) {
+        if (i.init->info.pointerReg[0] &&
+            s.staticState[i.slot].load(std::memory_order_acquire) == CodeManager::Section::kStaticReady) {
+            f(&s.staticVar[i.slot].as<reg*>());
+        }
+    }
+}
+
+struct Coroutine;
+template <typename F>
+void forEachRoot(Coroutine& co, F&& f);
+
 struct VM {
     struct ObjPools {
 
@@ -68,6 +432,71 @@ struct VM {
     void step() {
         
     }
+
+    /**
+     * @brief frames of all threads, parked coroutines and initialized pointer STATIC are scanned as roots of
+     * globalMemory on begin of each GC
+     * 
+     */
+    void registerRootScanner() {
+        globalMemory.registerGcRootScanner([this] {
+            auto scan = [this](reg** p) { globalMemory.scanRoot(p); };
+            {
+                std::lock_guard lock{threadLock};
+                for (auto& t : threads) {
+                    forEachRoot(t, scan);
+                }
+            }
+            if (ctx.cm != nullptr) {
+                for (auto& s : ctx.cm->all()) {
+                    forEachRoot(s, scan);
+                }
+            }
+            std::lock_guard lock{parkedLock};
+            for (auto* co : parked) {
+                forEachRoot(*co, scan);
+            }
+        });
+    }
+
+    /**
+     * @brief ThreadVM of a new thread, scanned as root until removed. address is stable
+     * 
+     */
+    ThreadVM& addThread() {
+        std::lock_guard lock{threadLock};
+        return threads.emplace_back();
+    }
+    /**
+     * @brief remove ThreadVM of exited thread, its Tlab and StoreBuffer are given back to globalMemory.
+     * should not be running, thread owned it should be detached from globalMemory
+     * 
+     */
+    void removeThread(ThreadVM* t) {
+        globalMemory.detach(t->tlab);
+        globalMemory.detach(t->storeBuffer);
+        std::lock_guard lock{threadLock};
+        threads.remove_if([t](const ThreadVM& x) { return &x == t; });
+    }
+
+    /**
+     * @brief coroutine owned by embedder (e.g. Scheduler) is scanned as root until removed.
+     * should be added before the thread parked it detaches from globalMemory, and removed before resumed
+     * 
+     */
+    void addParked(Coroutine* co) {
+        std::lock_guard lock{parkedLock};
+        parked.push_back(co);
+    }
+    void removeParked(Coroutine* co) {
+        std::lock_guard lock{parkedLock};
+        std::erase(parked, co);
+    }
+
+  private:
+    std::mutex threadLock;
+    std::mutex parkedLock;
+    std::vector<Coroutine*> parked;
 };
 
 }
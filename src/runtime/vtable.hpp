@@ -0,0 +1,149 @@
+/**
+ * @file vtable.hpp
+ * @author agent
+ * @brief function tables of trait object and inline cache of trait method call
+ * @date 2026-10-18
+ *
+ * @details
+ *
+ * trait object are stored as {VTable*, data pointer}, see opcode.hpp.
+ * one dense VTable is built for each (type, trait) pair when ImplToken is resolved, slot of a method is its index
+ * in Trait::methodNames, therefore slot number can be fixed in bytecode.
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Split call site info and per thread InlineCache.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>List built VTables.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <cassert>
+#include <deque>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+
+#include "defs.hpp"
+#include "ir/type.hpp"
+
+namespace rulejit {
+
+struct VTable {
+    // type identifier of the real object
+    TypeToken type;
+    TraitToken trait;
+    u32 slotCnt;
+    // function value of each method, the same as what CALLf accepts in R[A]
+    std::unique_ptr<reg[]> slots;
+
+    reg get(u16 slot) const {
+        assert(slot < slotCnt);
+        return slots[slot];
+    }
+};
+
+/**
+ * @brief static info of one trait method call site (CALLv)
+ *
+ */
+struct TraitCallSite {
+    u16 slot;
+    // count of args, not contains trait object itself
+    u8 argCnt;
+    u8 retCnt;
+    // index of InlineCache in ThreadVM, assigned by CodeManager when section added
+    u32 cacheId;
+};
+
+/**
+ * @brief monomorphic inline cache for one trait method call site, owned by one ThreadVM so code can be shared
+ * between threads without lock
+ *
+ */
+struct InlineCache {
+    const VTable* cachedTable = nullptr;
+    reg cachedTarget;
+
+    /**
+     * @brief get function value to call, only touch VTable if receiver type changed
+     *
+     * @param vt function table of receiver
+     * @param slot
+     * @return reg function value
+     */
+    reg lookup(const VTable* vt, u16 slot) {
+        if (vt == cachedTable) [[likely]] {
+            return cachedTarget;
+        }
+        cachedTable = vt;
+        cachedTarget = vt->get(slot);
+        return cachedTarget;
+    }
+};
+
+struct VTableManager {
+    /**
+     * @brief build (or get built) VTable for impl, called when ImplToken is loaded
+     *
+     * @param i impl to resolve
+     * @param tm
+     * @param instantiate get function value from function template, called once per method
+     * @return const VTable* pointer stable during lifetime of VTableManager
+     */
+    template <typename Instantiate>
+        requires std::is_invocable_r_v<reg, Instantiate, FunctionTemplateToken>
+    const VTable* resolve(ImplToken i, TypeManager& tm, Instantiate&& instantiate) {
+        if (auto it = byImpl.find(i); it != byImpl.end()) {
+            return it->second;
+        }
+        Impl& impl = tm.getImpl(i);
+        Trait& trait = tm.getTrait(impl.trait);
+
+        u64 key = getKey(impl.type, impl.trait);
+        if (auto it = byPair.find(key); it != byPair.end()) {
+            // the same (type, trait) impl may referenced through different token
+            byImpl.emplace(i, it->second);
+            return it->second;
+        }
+
+        u32 slotCnt = static_cast<u32>(trait.methodNames.size());
+        auto& vt = tables.emplace_back(impl.type, impl.trait, slotCnt, std::make_unique<reg[]>(slotCnt));
+        for (u32 slot = 0; slot < vt.slotCnt; ++slot) {
+            auto it = impl.methods.find(trait.methodNames[slot]);
+            // should rejected when check impl
+            assert(it != impl.methods.end());
+            vt.slots[slot] = instantiate(it->second);
+        }
+
+        byImpl.emplace(i, &vt);
+        byPair.emplace(key, &vt);
+        return &vt;
+    }
+
+    /**
+     * @brief find VTable built, used when cast object to trait object at runtime (e.g. from dynamic)
+     *
+     * @return const VTable* nullptr if type not impl trait or impl not loaded
+     */
+    const VTable* find(TypeToken type, TraitToken trait) const {
+        if (auto it = byPair.find(getKey(type, trait)); it != byPair.end()) {
+            return it->second;
+        }
+        return nullptr;
+    }
+
+    const std::deque<VTable>& all() const { return tables; }
+
+  private:
+    static u64 getKey(TypeToken type, TraitToken trait) { return (u64(type.data) << 32) | u64(trait.data); }
+
+    // deque to keep address stable
+    std::deque<VTable> tables;
+    std::unordered_map<u32, const VTable*> byImpl;
+    std::unordered_map<u64, const VTable*> byPair;
+};
+
+}
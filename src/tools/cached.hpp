@@ -10,6 +10,7 @@
  * <table>
  * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
  * <tr><td>nanaglutamate</td><td>2024-11-17</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Fix typo, keep cache map in std::any.</td></tr>
  * </table>
  */
 #pragma once
@@ -17,6 +18,7 @@
 #include <type_traits>
 #include <memory>
 #include <any>
+#include <map>
 #include <unordered_map>
 #include <atomic>
 #include <tuple>
@@ -28,12 +30,15 @@ struct CachedFunc;
 
 struct Cache {
 private:
+    template <typename F, typename T>
+    friend struct CachedFunc;
+
     inline static std::atomic<size_t> uuidCounter = 0;
     std::unordered_map<size_t, std::any> caches;
 public:
     static size_t getCounter() { return uuidCounter++; }
 
-    template<typenamne R, typename ...Arg>
+    template<typename R, typename ...Arg>
     struct CacheObject {};
 };
 
@@ -43,13 +48,18 @@ template <typename R, typename ...Arg, typename T>
             && requires { T{}.evaluate(); }
             // && (std::is_same_v<Arg, std::remove_cv_ref_t<Arg>>...)
 struct CachedFunc<R(Arg...), T> {
-    R operator(Cache c, Arg... arg) {
+    R operator()(Cache& c, Arg... arg) {
+        using Map = std::map<std::tuple<std::remove_cvref_t<Arg>...>, std::remove_cvref_t<R>>;
         static size_t thisCounter = Cache::getCounter();
-        auto& cache = c.caches[thisCounter];
-        if (auto it = cache.find({arg...}); it != cache.end()) {
+        auto& slot = c.caches[thisCounter];
+        if (!slot.has_value()) {
+            slot = Map{};
+        }
+        auto& cache = std::any_cast<Map&>(slot);
+        if (auto it = cache.find(std::tuple{arg...}); it != cache.end()) {
             return it->second;
         }
-        auto [it, _] = cache.emplace({arg...}, this.evaluate());
+        auto [it, _] = cache.emplace(std::tuple{arg...}, static_cast<T*>(this)->evaluate());
         return it->second;
     }
 private:
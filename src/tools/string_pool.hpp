@@ -10,6 +10,7 @@
  * <table>
  * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
  * <tr><td>nanaglutamate</td><td>2024-11-15</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-19</td><td>Take C string, const hash.</td></tr>
  * </table>
  */
 #pragma once
@@ -36,6 +37,8 @@ struct StringPool {
         return {&*it};
     }
 
+    StringToken take(const char* s) { return take(std::string_view{s}); }
+
     StringToken take(std::string_view s) {
         auto it = table.find(s);
         if (it == table.end()) {
@@ -64,5 +67,5 @@ struct StringPool {
 
 template <>
 struct std::hash<tools::StringToken> {
-    static size_t operator()(tools::StringToken v) noexcept { return hash<const std::string_view*>{}(v.data); }
+    size_t operator()(tools::StringToken v) const noexcept { return hash<const std::string_view*>{}(v.data); }
 };
\ No newline at end of file
@@ -0,0 +1,132 @@
+/**
+ * @file work_stealing_deque.hpp
+ * @author agent
+ * @brief Chase-Lev work stealing deque
+ * @date 2026-10-18
+ *
+ * @details
+ *
+ * owner thread push / pop at bottom, other threads steal from top.
+ * implementation follows "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al. 2013).
+ * ring buffer grows when full, old buffers are kept until deque destroyed since thief may still read them.
+ *
+ * @par history
+ * <table>
+ * <tr><th>Author</th><th>Date</th><th>Changes</th></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Initial version.</td></tr>
+ * <tr><td>agent</td><td>2026-10-18</td><td>Publish pushed item by release store of bottom.</td></tr>
+ * </table>
+ */
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace tools {
+
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+struct WorkStealingDeque {
+    explicit WorkStealingDeque(size_t capacity = 256) {
+        assert((capacity & (capacity - 1)) == 0);
+        rings.push_back(std::make_unique<Ring>(capacity));
+        ring.store(rings.back().get(), std::memory_order_relaxed);
+    }
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    auto& operator=(const WorkStealingDeque&) = delete;
+
+    /**
+     * @brief push to bottom, only called by owner
+     *
+     */
+    void push(T v) {
+        std::ptrdiff_t b = bottom.load(std::memory_order_relaxed);
+        std::ptrdiff_t t = top.load(std::memory_order_acquire);
+        Ring* r = ring.load(std::memory_order_relaxed);
+        if (b - t > std::ptrdiff_t(r->mask)) {
+            r = grow(r, t, b);
+        }
+        r->at(b).store(v, std::memory_order_relaxed);
+        // release store instead of standalone fence, thief acquiring bottom sees writes made before push
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief pop from bottom, only called by owner
+     *
+     */
+    std::optional<T> pop() {
+        std::ptrdiff_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Ring* r = ring.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::ptrdiff_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+        T v = r->at(b).load(std::memory_order_relaxed);
+        if (t == b) {
+            // last one, race with thief
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            if (!won) {
+                return std::nullopt;
+            }
+        }
+        return v;
+    }
+
+    /**
+     * @brief steal from top, can called by any thread
+     *
+     */
+    std::optional<T> steal() {
+        std::ptrdiff_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::ptrdiff_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return std::nullopt;
+        }
+        Ring* r = ring.load(std::memory_order_acquire);
+        T v = r->at(t).load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return std::nullopt;
+        }
+        return v;
+    }
+
+    bool empty() const {
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+
+  private:
+    struct Ring {
+        explicit Ring(size_t capacity) : mask(capacity - 1), data(std::make_unique<std::atomic<T>[]>(capacity)) {}
+        size_t mask;
+        std::unique_ptr<std::atomic<T>[]> data;
+        std::atomic<T>& at(std::ptrdiff_t i) { return data[size_t(i) & mask]; }
+    };
+
+    Ring* grow(Ring* old, std::ptrdiff_t t, std::ptrdiff_t b) {
+        auto& r = rings.emplace_back(std::make_unique<Ring>((old->mask + 1) * 2));
+        for (std::ptrdiff_t i = t; i < b; ++i) {
+            r->at(i).store(old->at(i).load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        ring.store(r.get(), std::memory_order_release);
+        return r.get();
+    }
+
+    alignas(64) std::atomic<std::ptrdiff_t> top = 0;
+    alignas(64) std::atomic<std::ptrdiff_t> bottom = 0;
+    std::atomic<Ring*> ring;
+    // owned by owner thread, retired rings may still be read by thief
+    std::vector<std::unique_ptr<Ring>> rings;
+};
+
+} // namespace tools
@@ -0,0 +1,871 @@
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "backend/bytecode/kernel.hpp"
+#include "runtime/batch.hpp"
+#include "runtime/ffi.hpp"
+#include "runtime/interpreter.hpp"
+#include "runtime/profiler.hpp"
+#include "runtime/trace.hpp"
+
+using namespace rulejit;
+
+namespace {
+
+f64 scale(f64 v, i64 n) {
+    return v * f64(n);
+}
+u64 first(reg* p) {
+    return p->as<u64>();
+}
+
+using I = Instruction;
+using O = OPCode;
+using Section = CodeManager::Section;
+
+struct Vm {
+    CodeManager cm;
+    VM vm{};
+    Interpreter in{&vm.ctx, &vm.globalMemory};
+    ThreadVM* t;
+
+    Vm() {
+        vm.ctx.cm = &cm;
+        vm.registerRootScanner();
+        t = &vm.threads.emplace_back();
+    }
+
+    const Section* load(Section&& s) {
+        auto r = in.load(std::move(s));
+        EXPECT_TRUE(r.has_value()) << r.error().ip << ": " << r.error().reason;
+        return r ? *r : nullptr;
+    }
+};
+
+// () -> box of 42
+Section makeBox() {
+    Section s;
+    s.info = {0, 1, 0, 1, {}};
+    s.info.pointerReg.set(0);
+    s.constant = {std::bit_cast<reg>(u64(42))};
+    s.code = {I::makeABo(O::ALLOChc, 0, 0), I::makeABo(O::RET, 0, 1)};
+    return s;
+}
+
+// () -> STATIC[0] twice, initialized by init
+Section makeReader(const Section* init) {
+    Section s;
+    s.info = {0, 2, 0, 2, {}};
+    s.info.pointerReg.set(0);
+    s.info.pointerReg.set(1);
+    s.staticVar = {reg{}};
+    s.staticInits = {{0, init}};
+    s.code = {I::makeABC(O::LOADstp, 0, 0, 0), I::makeABC(O::LOADstp, 1, 0, 0), I::makeABo(O::RET, 0, 2)};
+    return s;
+}
+
+// (n) -> 7 after n iterations, one back edge each
+Section makeCountdown() {
+    Section s;
+    s.info = {0, 3, 1, 1, {}};
+    s.constant = {std::bit_cast<reg>(u64(1)), std::bit_cast<reg>(u64(7))};
+    s.code = {I::makeABo(O::LOADc, 2, 0), I::makeABi(O::BEZ, 0, 2), I::makeABC(O::SUBu, 0, 0, 2),
+              I::makeAi(O::BR, -3), I::makeABo(O::LOADc, 1, 1), I::makeABo(O::RET, 1, 1)};
+    return s;
+}
+
+}
+
+TEST(StaticInitTest, InitializerRunsOnceAtFirstLoad) {
+    Vm x;
+    auto* f = x.load(makeReader(x.load(makeBox())));
+    reg rets[2];
+    ASSERT_EQ(x.in.execute(*x.t, f, {}, rets), ExecResult::kReturned);
+    reg* p = rets[0].as<reg*>();
+    EXPECT_EQ(p, rets[1].as<reg*>());
+    EXPECT_EQ(p[0].as<u64>(), 42);
+    EXPECT_EQ(helper::getHeader(p).typeId, TypeManager::kU64);
+    ASSERT_EQ(x.in.execute(*x.t, f, {}, rets), ExecResult::kReturned);
+    EXPECT_EQ(rets[0].as<reg*>(), p);
+}
+
+TEST(StaticInitTest, PointerStaticIsGcRoot) {
+    Vm x;
+    auto* f = x.load(makeReader(x.load(makeBox())));
+    reg rets[2];
+    ASSERT_EQ(x.in.execute(*x.t, f, {}, rets), ExecResult::kReturned);
+    reg* young = rets[0].as<reg*>();
+    for (int k = 0; k < 7; ++k) {
+        x.vm.globalMemory.collectMinor();
+    }
+    ASSERT_EQ(x.in.execute(*x.t, f, {}, rets), ExecResult::kReturned);
+    EXPECT_NE(rets[0].as<reg*>(), young);
+    EXPECT_EQ(rets[0].as<reg*>()[0].as<u64>(), 42);
+    EXPECT_FALSE(helper::getHeader(rets[0].as<reg*>()).hasFlag(ObjHeader::Flags::kIsMinorObject));
+}
+
+TEST(StaticInitTest, ExceptionOfInitializerIsThrownAtLoad) {
+    Vm x;
+    Section thrower;
+    thrower.info = {0, 2, 0, 1, {}};
+    thrower.info.pointerReg.set(0);
+    thrower.constant = {std::bit_cast<reg>(u64(7))};
+    thrower.code = {I::makeABo(O::LOADc, 1, 0), I::makeABC(O::THROW, 1, 1, 0)};
+    // 1 if STATIC[0] loaded, 2 if caught
+    Section s;
+    s.info = {0, 2, 0, 1, {}};
+    s.info.pointerReg.set(1);
+    s.staticVar = {reg{}};
+    s.staticInits = {{0, x.load(std::move(thrower))}};
+    s.constant = {std::bit_cast<reg>(u64(1)), std::bit_cast<reg>(u64(2))};
+    s.exceptionTable = {{0, 1, 3, ExceptionRange::kCatchAll}};
+    s.code = {I::makeABC(O::LOADstp, 1, 0, 0), I::makeABo(O::LOADc, 0, 0), I::makeABo(O::RET, 0, 1),
+              I::makeABo(O::LOADc, 0, 1), I::makeABo(O::RET, 0, 1)};
+    auto* f = x.load(std::move(s));
+    reg ret;
+    // slot stays uninitialized, initializer runs again
+    for (int k = 0; k < 2; ++k) {
+        ASSERT_EQ(x.in.execute(*x.t, f, {}, {&ret, 1}), ExecResult::kReturned);
+        EXPECT_EQ(ret.as<u64>(), 2);
+        EXPECT_EQ(x.t->exception.type.as<u64>(), 7);
+    }
+}
+
+TEST(StaticInitTest, ConcurrentFirstReadRunsInitializerOnce) {
+    Vm x;
+    // () -> box of 42, after a loop long enough for readers to meet
+    Section slow;
+    slow.info = {0, 3, 0, 1, {}};
+    slow.info.pointerReg.set(0);
+    slow.constant = {std::bit_cast<reg>(u64(200000)), std::bit_cast<reg>(u64(1)), std::bit_cast<reg>(u64(42))};
+    slow.code = {I::makeABo(O::LOADc, 1, 0), I::makeABo(O::LOADc, 2, 1),     I::makeABi(O::BEZ, 1, 2),
+                 I::makeABC(O::SUBu, 1, 1, 2), I::makeAi(O::BR, -3),         I::makeABo(O::ALLOChc, 0, 2),
+                 I::makeABo(O::RET, 0, 1)};
+    auto* f = x.load(makeReader(x.load(std::move(slow))));
+
+    constexpr usize kReaders = 4;
+    std::vector<ThreadVM*> tvs;
+    for (usize i = 0; i < kReaders; ++i) {
+        tvs.push_back(&x.vm.threads.emplace_back());
+    }
+    std::atomic<usize> arrived = 0;
+    std::vector<reg*> seen(kReaders, nullptr);
+    std::vector<std::thread> readers;
+    for (usize i = 0; i < kReaders; ++i) {
+        readers.emplace_back([&, i] {
+            x.vm.globalMemory.attachMutator();
+            arrived.fetch_add(1);
+            while (arrived.load() != kReaders) {
+            }
+            reg rets[2];
+            if (x.in.execute(*tvs[i], f, {}, rets) == ExecResult::kReturned) {
+                seen[i] = rets[0].as<reg*>();
+            }
+            x.vm.globalMemory.detachMutator();
+        });
+    }
+    for (auto& r : readers) {
+        r.join();
+    }
+    ASSERT_NE(seen[0], nullptr);
+    EXPECT_EQ(seen[0][0].as<u64>(), 42);
+    for (reg* p : seen) {
+        EXPECT_EQ(p, seen[0]);
+    }
+}
+
+TEST(StaticInitTest, SelfReferentialInitializerIsBadCall) {
+    Vm x;
+    // () -> STATIC[0], initialized by itself
+    Section s;
+    s.info = {0, 1, 0, 1, {}};
+    s.info.pointerReg.set(0);
+    s.staticVar = {reg{}};
+    s.staticInits = {{0, x.load(makeBox())}};
+    s.code = {I::makeABC(O::LOADstp, 0, 0, 0), I::makeABo(O::RET, 0, 1)};
+    auto* f = x.load(std::move(s));
+    const_cast<Section*>(f)->staticInits[0].init = f;
+    reg ret;
+    // slot stays pending, reading it again fails the same way
+    for (int k = 0; k < 2; ++k) {
+        EXPECT_EQ(x.in.execute(*x.t, f, {}, {&ret, 1}), ExecResult::kBadCall);
+        EXPECT_EQ(f->staticState[0].load(), Section::kStaticPending);
+        EXPECT_TRUE(x.t->frames.empty());
+    }
+    x.vm.globalMemory.collectMinor();
+}
+
+TEST(StaticInitTest, VerifierRejectsKindMismatchAndInstantiation) {
+    Vm x;
+    Section s = makeReader(x.load(makeBox()));
+    s.info.pointerReg.reset(0);
+    s.code[0] = I::makeABC(O::LOADst, 0, 0, 0);
+    EXPECT_FALSE(x.in.load(std::move(s)).has_value());
+
+    Section t;
+    t.info = {0, 2, 1, 1, {}};
+    t.code = {I::makeABo(O::INSTANf, 0, 0), I::makeABo(O::RET, 0, 1)};
+    EXPECT_FALSE(x.in.load(std::move(t)).has_value());
+}
+
+TEST(CoroutineTest, PointerReturnedByFutureIsGcRoot) {
+    Vm x;
+    std::shared_ptr<ExternFuture> pending;
+    Section::FunctionInfo nativeInfo{0, 0, 0, 1, {}};
+    nativeInfo.pointerReg.set(0);
+    auto* fetch = x.cm.addNative(
+        nativeInfo,
+        [](ExternCall& ec) {
+            ec.future = std::make_shared<ExternFuture>();
+            *static_cast<std::shared_ptr<ExternFuture>*>(ec.data) = ec.future;
+            return ExternStatus::kPending;
+        },
+        &pending);
+    // () -> fetch()
+    Section s;
+    s.info = {0, 3, 0, 1, {}};
+    s.info.pointerReg.set(0);
+    s.info.pointerReg.set(2);
+    s.constant = {std::bit_cast<reg>(fetch)};
+    s.code = {I::makeABo(O::LOADc, 1, 0), I::makeABC(O::CALLf, 1, 0, 1), I::makeABC(O::MOV, 0, 2, 0),
+              I::makeABo(O::RET, 0, 1)};
+    auto* f = x.load(std::move(s));
+
+    std::unique_ptr<Coroutine> co;
+    reg ret;
+    ASSERT_EQ(x.in.execute(*x.t, f, {}, {&ret, 1}, &co), ExecResult::kSuspended);
+    ASSERT_NE(pending, nullptr);
+    x.vm.addParked(co.get());
+    // box of u64 as ALLOChc, filled by completing thread
+    reg* young = x.vm.globalMemory.allocHeap(x.t->tlab, ObjHeader{TypeManager::kU64, 1, 0, 0, 0});
+    young[0].as<u64>() = 42;
+    pending->rets = {std::bit_cast<reg>(young)};
+    pending->complete();
+    // completed future waits for resume across GCs, until promoted
+    for (int k = 0; k < 7; ++k) {
+        x.vm.globalMemory.collectMinor();
+    }
+    x.vm.removeParked(co.get());
+    ASSERT_EQ(x.in.resume(*x.t, std::move(co), {&ret, 1}), ExecResult::kReturned);
+    EXPECT_NE(ret.as<reg*>(), young);
+    EXPECT_EQ(ret.as<reg*>()[0].as<u64>(), 42);
+    EXPECT_FALSE(helper::getHeader(ret.as<reg*>()).hasFlag(ObjHeader::Flags::kIsMinorObject));
+}
+
+TEST(FuelTest, InfiniteLoopRunsOutOfFuel) {
+    Vm x;
+    Section s;
+    s.info = {0, 1, 0, 1, {}};
+    s.code = {I::makeAi(O::BR, -1)};
+    auto* f = x.load(std::move(s));
+    x.t->fuel.enabled = true;
+    x.t->fuel.left = 1000;
+    reg ret;
+    ASSERT_EQ(x.in.execute(*x.t, f, {}, {&ret, 1}), ExecResult::kOutOfFuel);
+    EXPECT_EQ(x.t->fuel.left, 0);
+    EXPECT_EQ(x.t->fuel.used, 1000);
+    EXPECT_EQ(x.t->fuel.exhaustedIn, f);
+    EXPECT_EQ(x.t->fuel.exhaustedAt, 0);
+    EXPECT_TRUE(x.t->frames.empty());
+}
+
+TEST(FuelTest, ChargeOfLoopAndCall) {
+    Vm x;
+    auto* loop = x.load(makeCountdown());
+    // () -> loop(10)
+    Section s;
+    s.info = {0, 4, 0, 1, {}};
+    s.constant = {std::bit_cast<reg>(loop), std::bit_cast<reg>(u64(10))};
+    s.code = {I::makeABo(O::LOADc, 1, 0), I::makeABo(O::LOADc, 2, 1), I::makeABC(O::CALLf, 1, 1, 1),
+              I::makeABC(O::MOV, 0, 3, 0), I::makeABo(O::RET, 0, 1)};
+    auto* f = x.load(std::move(s));
+    x.t->fuel.enabled = true;
+    x.t->fuel.left = 100;
+    reg arg = std::bit_cast<reg>(u64(10)), ret;
+    ASSERT_EQ(x.in.execute(*x.t, loop, {&arg, 1}, {&ret, 1}), ExecResult::kReturned);
+    EXPECT_EQ(ret.as<u64>(), 7);
+    EXPECT_EQ(x.t->fuel.used, 10);
+    EXPECT_EQ(x.t->fuel.exhaustedIn, nullptr);
+    // one more for the call
+    ASSERT_EQ(x.in.execute(*x.t, f, {}, {&ret, 1}), ExecResult::kReturned);
+    EXPECT_EQ(x.t->fuel.used, 11);
+    EXPECT_EQ(x.t->fuel.left, 100 - 10 - 11);
+    // not enough for the last back edge
+    x.t->fuel.left = 9;
+    ASSERT_EQ(x.in.execute(*x.t, loop, {&arg, 1}, {&ret, 1}), ExecResult::kOutOfFuel);
+    EXPECT_EQ(x.t->fuel.used, 9);
+    EXPECT_EQ(x.t->fuel.exhaustedIn, loop);
+    EXPECT_EQ(x.t->fuel.exhaustedAt, 3);
+}
+
+TEST(AutoStackTest, ChunkIsLinkedAndFreedAtBoundary) {
+    AutoStack a;
+    auto base = a.mark();
+    constexpr usize kFrame = AutoStack::kChunkSize / 3;
+    std::vector<AutoStack::Mark> marks;
+    std::vector<reg*> frames;
+    for (usize i = 0; i < 10; ++i) {
+        marks.push_back(a.mark());
+        frames.push_back(a.push(kFrame));
+        frames.back()[0] = std::bit_cast<reg>(u64(i));
+        frames.back()[kFrame - 1] = std::bit_cast<reg>(u64(i));
+    }
+    // 3 frames per chunk, the 4th starts a new one
+    EXPECT_EQ(frames[1], frames[0] + kFrame);
+    EXPECT_NE(frames[3], frames[2] + kFrame);
+    EXPECT_NE(marks[3].chunk, marks[4].chunk);
+    // larger than one chunk gets its own
+    auto beforeLarge = a.mark();
+    reg* large = a.push(AutoStack::kChunkSize + 1);
+    large[AutoStack::kChunkSize] = reg{};
+    a.pop(beforeLarge);
+    for (usize i = 10; i-- > 0;) {
+        EXPECT_EQ(frames[i][0].as<u64>(), i);
+        EXPECT_EQ(frames[i][kFrame - 1].as<u64>(), i);
+        a.pop(marks[i]);
+        EXPECT_EQ(a.mark().head, marks[i].head);
+    }
+    EXPECT_EQ(a.mark().chunk, base.chunk);
+    EXPECT_EQ(a.mark().head, base.head);
+}
+
+TEST(AutoStackTest, RecursionCrossesChunkBoundary) {
+    Vm x;
+    // (n) -> n + (n - 1) + ... + 0, each term kept in AUTO[255] of its frame across the call
+    Section s;
+    s.info = {1000, 7, 1, 1, {}};
+    s.info.pointerReg.set(2);
+    s.constant = {std::bit_cast<reg>(u64(1)), reg{}};
+    s.code = {I::makeABo(O::LOADc, 1, 0),      I::makeABi(O::BEZ, 0, 7),         I::makeABC(O::ALLOCsr, 2, 0, 255),
+              I::makeABo(O::LOADc, 3, 1),      I::makeABC(O::SUBu, 4, 0, 1),     I::makeABC(O::CALLf, 3, 1, 1),
+              I::makeABC(O::LOADao, 6, 2, 0),  I::makeABC(O::ADDu, 0, 5, 6),     I::makeABo(O::RET, 0, 1),
+              I::makeABo(O::RET, 0, 1)};
+    auto* f = const_cast<Section*>(x.load(std::move(s)));
+    f->constant.set(1, std::bit_cast<reg>(static_cast<const Section*>(f)));
+    x.cm.seal(f);
+    auto before = x.t->a.mark();
+    for (u64 n : {1, 4, 30, 100}) {
+        reg arg = std::bit_cast<reg>(n), ret;
+        ASSERT_EQ(x.in.execute(*x.t, f, {&arg, 1}, {&ret, 1}), ExecResult::kReturned);
+        EXPECT_EQ(ret.as<u64>(), n * (n + 1) / 2);
+        EXPECT_EQ(x.t->a.mark().chunk, before.chunk);
+        EXPECT_EQ(x.t->a.mark().head, before.head);
+    }
+}
+
+TEST(ProfilerTest, FullRingDropsOldestSamples) {
+    auto buf = std::make_unique<SampleBuffer>();
+    auto fillWith = [](u32 ip) { return [ip](ProfileFrame* out, usize i) { *out = {nullptr, ip + u32(i)}; }; };
+    // limited by count of samples
+    for (u32 k = 0; k < SampleBuffer::kSamples + 5; ++k) {
+        buf->push(1, fillWith(k));
+    }
+    EXPECT_EQ(buf->size(), SampleBuffer::kSamples);
+    EXPECT_EQ(buf->dropped, 5);
+    EXPECT_EQ(buf->frameAt(buf->beginOf(buf->sampleBegin)).ip, 5);
+    EXPECT_EQ(buf->frameAt(buf->beginOf(buf->sampleEnd - 1)).ip, SampleBuffer::kSamples + 4);
+
+    // limited by count of frames
+    buf->clear();
+    EXPECT_EQ(buf->size(), 0);
+    constexpr usize kFit = SampleBuffer::kFrames / SampleBuffer::kMaxDepth;
+    for (u32 k = 0; k < kFit + 3; ++k) {
+        buf->push(SampleBuffer::kMaxDepth, fillWith(k));
+    }
+    EXPECT_EQ(buf->size(), kFit);
+    EXPECT_EQ(buf->dropped, 3);
+    for (usize k = buf->sampleBegin; k != buf->sampleEnd; ++k) {
+        EXPECT_EQ(buf->endOf(k) - buf->beginOf(k), SampleBuffer::kMaxDepth);
+    }
+    EXPECT_EQ(buf->frameAt(buf->beginOf(buf->sampleBegin)).ip, 3);
+
+    // deep stack keeps leaf frames
+    buf->clear();
+    buf->push(SampleBuffer::kMaxDepth + 10, fillWith(1000));
+    EXPECT_EQ(buf->truncated, 1);
+    usize k = buf->sampleEnd - 1;
+    EXPECT_EQ(buf->endOf(k) - buf->beginOf(k), SampleBuffer::kMaxDepth);
+    EXPECT_EQ(buf->frameAt(buf->beginOf(k)).ip, 1000);
+    EXPECT_EQ(buf->frameAt(buf->endOf(k) - 1).ip, 1000 + SampleBuffer::kMaxDepth - 1);
+}
+
+TEST(ProfilerTest, SampleIsTakenAtNextBackEdge) {
+    Vm x;
+    // requests sample of calling thread, like timer of Profiler
+    auto* arm = x.cm.addNative(
+        Section::FunctionInfo{0, 0, 0, 0, {}},
+        [](ExternCall& ec) {
+            static_cast<ThreadVM*>(ec.data)->sampleRequested.store(true, std::memory_order_relaxed);
+            return ExternStatus::kDone;
+        },
+        x.t);
+    // (n) -> 7, calls arm n times
+    Section inner;
+    inner.name = "inner";
+    inner.info = {0, 4, 1, 1, {}};
+    inner.constant = {std::bit_cast<reg>(u64(1)), std::bit_cast<reg>(arm), std::bit_cast<reg>(u64(7))};
+    inner.lines = {10, 11, 12, 12, 13, 14, 15, 15};
+    inner.code = {I::makeABo(O::LOADc, 2, 0),    I::makeABi(O::BEZ, 0, 4), I::makeABo(O::LOADc, 3, 1),
+                  I::makeABC(O::CALLf, 3, 0, 0), I::makeABC(O::SUBu, 0, 0, 2), I::makeAi(O::BR, -5),
+                  I::makeABo(O::LOADc, 1, 2),    I::makeABo(O::RET, 1, 1)};
+    auto* g = x.load(std::move(inner));
+    // () -> inner(3)
+    Section outer;
+    outer.name = "outer";
+    outer.info = {0, 4, 0, 1, {}};
+    outer.constant = {std::bit_cast<reg>(g), std::bit_cast<reg>(u64(3))};
+    outer.code = {I::makeABo(O::LOADc, 1, 0), I::makeABo(O::LOADc, 2, 1), I::makeABC(O::CALLf, 1, 1, 1),
+                  I::makeABC(O::MOV, 0, 3, 0), I::makeABo(O::RET, 0, 1)};
+    auto* f = x.load(std::move(outer));
+
+    Profiler prof;
+    prof.attach(x.vm);
+    reg ret;
+    ASSERT_EQ(x.in.execute(*x.t, f, {}, {&ret, 1}), ExecResult::kReturned);
+    EXPECT_EQ(ret.as<u64>(), 7);
+    auto r = prof.report();
+    EXPECT_EQ(r.samples, 3);
+    EXPECT_EQ(r.dropped, 0);
+    ASSERT_EQ(r.stacks.size(), 1);
+    std::vector<ProfileFrame> stack{{f, 2}, {g, 5}};
+    EXPECT_EQ(r.stacks.begin()->first, stack);
+    EXPECT_EQ(r.functions[g].self, 3);
+    EXPECT_EQ(r.functions[g].total, 3);
+    EXPECT_EQ(r.functions[f].self, 0);
+    EXPECT_EQ(r.functions[f].total, 3);
+    EXPECT_EQ((r.lines[{g, 14}]), 3);
+    EXPECT_EQ(Profiler::collapsed(r), "outer;inner 3\n");
+    prof.clear();
+    EXPECT_EQ(prof.report().samples, 0);
+}
+
+TEST(TraceTest, EventsAreExportedInOrder) {
+    Vm x;
+    auto* ext = x.cm.addNative(Section::FunctionInfo{0, 0, 0, 0, {}}, [](ExternCall&) { return ExternStatus::kDone; });
+    ext->name = "ext";
+    Section box = makeBox();
+    box.name = "box";
+    auto* g = x.load(std::move(box));
+    // () -> box(), after ext()
+    Section s;
+    s.name = "say \"hi\"";
+    s.info = {0, 3, 0, 1, {}};
+    s.info.pointerReg.set(0);
+    s.info.pointerReg.set(2);
+    s.constant = {std::bit_cast<reg>(static_cast<const Section*>(ext)), std::bit_cast<reg>(g)};
+    s.code = {I::makeABo(O::LOADc, 1, 0), I::makeABC(O::CALLf, 1, 0, 0), I::makeABo(O::LOADc, 1, 1),
+              I::makeABC(O::CALLf, 1, 0, 1), I::makeABC(O::MOV, 0, 2, 0), I::makeABo(O::RET, 0, 1)};
+    auto* f = x.load(std::move(s));
+    const std::string empty = "{\"traceEvents\":[\n]}\n";
+    Tracer::collect();
+
+    reg ret;
+    ASSERT_EQ(x.in.execute(*x.t, f, {}, {&ret, 1}), ExecResult::kReturned);
+    EXPECT_EQ(Tracer::collect(), empty);
+
+    Tracer::enable(true);
+    ASSERT_EQ(x.in.execute(*x.t, f, {}, {&ret, 1}), ExecResult::kReturned);
+    Tracer::enable(false);
+    std::string json = Tracer::collect();
+    auto event = [](std::string name, std::string ph) { return "\"name\":\"" + name + "\",\"ph\":\"" + ph + '"'; };
+    std::string caller = "say \\\"hi\\\"";
+    std::vector<std::string> expected = {event(caller, "B"),
+                                         event("ext", "B"),
+                                         event("ext", "E"),
+                                         event("box", "B"),
+                                         event("alloc", "i"),
+                                         "\"args\":{\"type\":" + std::to_string(TypeManager::kU64) + '}',
+                                         event("box", "E"),
+                                         event(caller, "E")};
+    usize pos = 0;
+    for (auto& e : expected) {
+        usize next = json.find(e, pos);
+        ASSERT_NE(next, std::string::npos) << e << " not found after " << pos << " in " << json;
+        pos = next + e.size();
+    }
+    EXPECT_EQ(json.substr(0, 16), "{\"traceEvents\":[");
+    EXPECT_EQ(json.substr(json.size() - 4), "\n]}\n");
+    EXPECT_EQ(Tracer::collect(), empty);
+}
+
+TEST(TraceTest, FullRingCountsDropped) {
+    Tracer::collect();
+    for (usize k = 0; k < TraceRing::kSize + 3; ++k) {
+        Tracer::emit(TracePoint::kSuspend, "suspend");
+    }
+    std::string json = Tracer::collect();
+    EXPECT_NE(json.find("\"name\":\"trace dropped\",\"ph\":\"i\""), std::string::npos);
+    EXPECT_NE(json.find("\"args\":{\"count\":3}"), std::string::npos);
+    EXPECT_EQ(Tracer::collect(), "{\"traceEvents\":[\n]}\n");
+}
+
+TEST(ExceptionTest, InnermostMatchingRangeHandles) {
+    Section s;
+    s.exceptionTable = {{0, 10, 20, ExceptionRange::kCatchAll},
+                        {2, 5, 30, 7},
+                        {3, 4, 40, 9},
+                        {12, 15, 50, ExceptionRange::kCatchAll}};
+    auto handler = [&](u32 ip, u64 type) {
+        auto* r = s.findHandler(ip, type);
+        return r ? r->handler : 0;
+    };
+    EXPECT_EQ(handler(0, 7), 20);
+    EXPECT_EQ(handler(2, 7), 30);
+    EXPECT_EQ(handler(3, 7), 30);
+    EXPECT_EQ(handler(3, 9), 40);
+    EXPECT_EQ(handler(3, 8), 20);
+    // end is exclusive
+    EXPECT_EQ(handler(4, 9), 20);
+    EXPECT_EQ(handler(9, 7), 20);
+    EXPECT_EQ(handler(10, 7), 0);
+    EXPECT_EQ(handler(12, 1), 50);
+    EXPECT_EQ(handler(15, 1), 0);
+}
+
+TEST(ExceptionTest, UncaughtTypeUnwindsToCaller) {
+    Vm x;
+    // (n) -> throw n(n), 1 if n is 7
+    Section callee;
+    callee.info = {0, 2, 1, 1, {}};
+    callee.constant = {std::bit_cast<reg>(u64(1))};
+    callee.exceptionTable = {{0, 1, 1, 7}};
+    callee.code = {I::makeABC(O::THROW, 0, 0, 0), I::makeABo(O::LOADc, 0, 0), I::makeABo(O::RET, 0, 1)};
+    // (n) -> callee(n), 2 if n is 9
+    Section s;
+    s.info = {0, 4, 1, 1, {}};
+    s.constant = {std::bit_cast<reg>(x.load(std::move(callee))), std::bit_cast<reg>(u64(2))};
+    s.exceptionTable = {{0, 3, 4, 9}};
+    s.code = {I::makeABo(O::LOADc, 1, 0), I::makeABC(O::MOV, 2, 0, 0), I::makeABC(O::CALLf, 1, 1, 1),
+              I::makeABo(O::RET, 3, 1),   I::makeABo(O::LOADc, 0, 1), I::makeABo(O::RET, 0, 1)};
+    auto* f = x.load(std::move(s));
+    auto before = x.t->a.mark();
+    auto run = [&](u64 n, ExecResult expected) {
+        reg arg = std::bit_cast<reg>(n), ret{};
+        EXPECT_EQ(x.in.execute(*x.t, f, {&arg, 1}, {&ret, 1}), expected);
+        EXPECT_EQ(x.t->exception.type.as<u64>(), n);
+        EXPECT_EQ(x.t->exception.payload.size(), 1);
+        EXPECT_EQ(x.t->exception.payload[0].as<u64>(), n);
+        EXPECT_TRUE(x.t->frames.empty());
+        EXPECT_EQ(x.t->a.mark().head, before.head);
+        return ret.as<u64>();
+    };
+    EXPECT_EQ(run(7, ExecResult::kReturned), 1);
+    EXPECT_EQ(run(9, ExecResult::kReturned), 2);
+    run(5, ExecResult::kThrown);
+}
+
+TEST(ExceptionTest, PointerInPayloadIsGcRoot) {
+    Vm x;
+    // throw 7(box of 42, 5)
+    Section s;
+    s.info = {0, 4, 0, 1, {}};
+    s.info.pointerReg.set(1);
+    s.constant = {std::bit_cast<reg>(u64(42)), std::bit_cast<reg>(u64(5)), std::bit_cast<reg>(u64(7))};
+    s.code = {I::makeABo(O::ALLOChc, 1, 0), I::makeABo(O::LOADc, 2, 1), I::makeABo(O::LOADc, 3, 2),
+              I::makeABC(O::THROW, 3, 1, 1)};
+    auto* f = x.load(std::move(s));
+    reg ret;
+    ASSERT_EQ(x.in.execute(*x.t, f, {}, {&ret, 1}), ExecResult::kThrown);
+    auto& e = x.t->exception;
+    ASSERT_EQ(e.payload.size(), 2);
+    reg* young = e.payload[0].as<reg*>();
+    for (int k = 0; k < 7; ++k) {
+        x.vm.globalMemory.collectMinor();
+    }
+    EXPECT_NE(e.payload[0].as<reg*>(), young);
+    EXPECT_EQ(e.payload[0].as<reg*>()[0].as<u64>(), 42);
+    EXPECT_EQ(e.payload[1].as<u64>(), 5);
+}
+
+TEST(ConstantPoolTest, EqualConstantObjectsAreShared) {
+    Vm x;
+    // two copies of {box of 42, 7}, header first
+    std::vector<reg> box[2], pair[2];
+    for (int i = 0; i < 2; ++i) {
+        box[i] = {std::bit_cast<reg>(ObjHeader{TypeManager::kU64, 1, 0, 0, 0}), std::bit_cast<reg>(u64(42))};
+        pair[i] = {std::bit_cast<reg>(ObjHeader{TypeManager::kAny, 2, 0, u8(ObjHeader::Flags::kHasPointerMember), 1}),
+                   std::bit_cast<reg>(box[i].data() + 1), std::bit_cast<reg>(u64(7))};
+    }
+    const Section* f[2];
+    for (int i = 0; i < 2; ++i) {
+        Section s;
+        s.info = {0, 1, 0, 1, {}};
+        s.info.pointerReg.set(0);
+        // slot 1 only differs, so tables are not merged as a whole
+        s.constant = {std::bit_cast<reg>(pair[i].data() + 1), std::bit_cast<reg>(u64(i))};
+        s.code = {I::makeABo(O::LOADcp, 0, 0), I::makeABo(O::RET, 0, 1)};
+        f[i] = x.load(std::move(s));
+    }
+    EXPECT_NE(f[0]->constant.data(), f[1]->constant.data());
+    reg rets[2];
+    ASSERT_EQ(x.in.execute(*x.t, f[0], {}, {rets, 1}), ExecResult::kReturned);
+    ASSERT_EQ(x.in.execute(*x.t, f[1], {}, {rets + 1, 1}), ExecResult::kReturned);
+    reg* p = rets[0].as<reg*>();
+    EXPECT_EQ(p, rets[1].as<reg*>());
+    EXPECT_NE(p, pair[0].data() + 1);
+    EXPECT_EQ(p[1].as<u64>(), 7);
+    reg* b = p[0].as<reg*>();
+    EXPECT_NE(b, box[0].data() + 1);
+    EXPECT_EQ(b[0].as<u64>(), 42);
+    EXPECT_EQ(x.cm.constants().objectSize(), 2);
+}
+
+TEST(ConstantPoolTest, EqualTablesAreStoredOnce) {
+    ConstantPool pool;
+    std::vector<reg> a = {std::bit_cast<reg>(u64(1)), std::bit_cast<reg>(u64(2))};
+    std::vector<reg> b = a, c = {std::bit_cast<reg>(u64(1)), std::bit_cast<reg>(u64(3))};
+    std::vector<reg> huge(ConstantPool::kHugeSize + 1, std::bit_cast<reg>(u64(5)));
+    EXPECT_EQ(pool.intern(std::span<const reg>{}), nullptr);
+    const reg* p = pool.intern(a);
+    EXPECT_NE(p, a.data());
+    EXPECT_EQ(pool.intern(b), p);
+    EXPECT_NE(pool.intern(c), p);
+    const reg* h = pool.intern(huge);
+    EXPECT_EQ(pool.intern(std::vector<reg>(huge)), h);
+    EXPECT_EQ(std::bit_cast<u64>(h[ConstantPool::kHugeSize]), 5);
+    EXPECT_EQ(pool.size(), 3);
+    EXPECT_EQ(pool.interned(), 5);
+    EXPECT_EQ(pool.bytes(), (2 + 2 + huge.size()) * sizeof(reg));
+
+    // writer gets private copy, until interned again
+    ConstantTable t1 = ConstantTable(std::move(a)), t2 = ConstantTable(std::move(b));
+    t1.intern(pool);
+    t2.intern(pool);
+    EXPECT_TRUE(t1.isPooled());
+    EXPECT_EQ(t1.data(), p);
+    EXPECT_EQ(t2.data(), p);
+    t1.set(1, std::bit_cast<reg>(u64(3)));
+    EXPECT_FALSE(t1.isPooled());
+    EXPECT_EQ(std::bit_cast<u64>(t1[1]), 3);
+    EXPECT_EQ(std::bit_cast<u64>(t2[1]), 2);
+    EXPECT_EQ(std::bit_cast<u64>(p[1]), 2);
+    t1.intern(pool);
+    EXPECT_EQ(t1.data(), pool.intern(c));
+    EXPECT_EQ(t2.append(std::bit_cast<reg>(u64(4))), 2);
+    EXPECT_EQ(t2.size(), 3);
+    EXPECT_EQ(std::bit_cast<u64>(p[1]), 2);
+}
+
+TEST(ConstantPoolTest, SectionsShareTableUntilPatched) {
+    Vm x;
+    const Section* f[2];
+    for (auto& fi : f) {
+        fi = x.load(makeCountdown());
+    }
+    EXPECT_EQ(f[0]->constant.data(), f[1]->constant.data());
+    // returns 8 instead of 7
+    auto* g = const_cast<Section*>(f[1]);
+    g->constant.set(1, std::bit_cast<reg>(u64(8)));
+    EXPECT_NE(f[0]->constant.data(), g->constant.data());
+    x.cm.seal(g);
+    EXPECT_TRUE(g->constant.isPooled());
+    reg arg = std::bit_cast<reg>(u64(3)), ret;
+    ASSERT_EQ(x.in.execute(*x.t, f[0], {&arg, 1}, {&ret, 1}), ExecResult::kReturned);
+    EXPECT_EQ(ret.as<u64>(), 7);
+    ASSERT_EQ(x.in.execute(*x.t, g, {&arg, 1}, {&ret, 1}), ExecResult::kReturned);
+    EXPECT_EQ(ret.as<u64>(), 8);
+    // patched back, shared again
+    g->constant.set(1, std::bit_cast<reg>(u64(7)));
+    x.cm.seal(g);
+    EXPECT_EQ(f[0]->constant.data(), g->constant.data());
+}
+
+TEST(TagTest, ImmediateOfRegisterAndConst) {
+    Vm x;
+    // (n) -> (untag(tag(n)), tag of tag(n), tag of box, tag of CONST[1], untag(CONST[1]))
+    Section s;
+    s.info = {0, 14, 1, 5, {}};
+    for (u32 r : {6, 7, 8}) {
+        s.info.pointerReg.set(r);
+    }
+    s.constant = {std::bit_cast<reg>(u64(42)), std::bit_cast<reg>(helper::getHackedPtr('x', helper::PtrTag::kChar))};
+    s.code = {I::makeABC(O::TAGi, 6, 0, 0),   I::makeABC(O::UNTAG, 9, 6, 0),  I::makeABC(O::TAGOF, 10, 6, 0),
+              I::makeABo(O::ALLOChc, 7, 0),   I::makeABC(O::TAGOF, 11, 7, 0), I::makeABo(O::LOADcp, 8, 1),
+              I::makeABC(O::TAGOF, 12, 8, 0), I::makeABC(O::UNTAG, 13, 8, 0), I::makeABo(O::RET, 9, 5)};
+    auto* f = x.load(std::move(s));
+    // CONST immediate is not interned as object
+    EXPECT_EQ(std::bit_cast<reg*>(f->constant[1]), helper::getHackedPtr('x', helper::PtrTag::kChar));
+    // highest bit is dropped
+    std::pair<i64, i64> cases[] = {{0, 0},
+                                   {-5, -5},
+                                   {helper::kMaxHackedInt, helper::kMaxHackedInt},
+                                   {helper::kMinHackedInt, helper::kMinHackedInt},
+                                   {helper::kMaxHackedInt + 1, helper::kMinHackedInt}};
+    for (auto [n, untagged] : cases) {
+        reg arg = std::bit_cast<reg>(n), rets[5];
+        ASSERT_EQ(x.in.execute(*x.t, f, {&arg, 1}, rets), ExecResult::kReturned);
+        EXPECT_EQ(rets[0].as<i64>(), untagged);
+        EXPECT_EQ(rets[1].as<u64>(), u64(helper::PtrTag::kInt));
+        EXPECT_EQ(rets[2].as<u64>(), u64(helper::PtrTag::kPointer));
+        EXPECT_EQ(rets[3].as<u64>(), u64(helper::PtrTag::kChar));
+        EXPECT_EQ(rets[4].as<u64>(), u64('x'));
+    }
+}
+
+TEST(TagTest, VerifierChecksKindOfTagOperands) {
+    Vm x;
+    auto make = [](O op, bool pointerB) {
+        Section s;
+        s.info = {0, 2, 1, 1, {}};
+        s.info.pointerReg.set(0, pointerB);
+        s.info.pointerReg.set(1, op == O::TAGi);
+        s.code = {I::makeABC(op, 1, 0, 0), I::makeABo(O::RET, 1, 1)};
+        return s;
+    };
+    EXPECT_TRUE(x.in.load(make(O::TAGi, false)).has_value());
+    EXPECT_FALSE(x.in.load(make(O::TAGi, true)).has_value());
+    for (O op : {O::UNTAG, O::TAGOF}) {
+        EXPECT_TRUE(x.in.load(make(op, true)).has_value());
+        EXPECT_FALSE(x.in.load(make(op, false)).has_value());
+    }
+}
+
+TEST(ArrayKernelTest, DotAndAddLoopPastOffsetRange) {
+    for (usize n : {3, 8, 13, 300, 1000}) {
+        Vm x;
+        ArrayType t{{n}, TypeToken{TypeManager::kF64}};
+        // (lhs, rhs, out) -> dot, element i at [ptr + 1 + i]
+        Section s;
+        s.info = {0, 32, 3, 1, {}};
+        for (int r : {0, 1, 2}) {
+            s.info.pointerReg.set(r);
+        }
+        ASSERT_TRUE(ArrayKernel::emitDot(s, 3, 0, 1, 1, t, 8));
+        ASSERT_TRUE(ArrayKernel::emitElementwise(s, OPCode::VADDf, 2, 0, 1, 1, t, 20));
+        s.code.push_back(I::makeABo(O::RET, 3, 1));
+        auto* f = x.load(std::move(s));
+        ASSERT_NE(f, nullptr);
+        std::vector<reg> a(n + 1), b(n + 1), out(n + 1);
+        f64 expect = 0;
+        for (usize i = 0; i < n; ++i) {
+            a[i + 1].as<f64>() = f64(i % 7);
+            b[i + 1].as<f64>() = f64(i % 5) + 0.5;
+            expect += f64(i % 7) * (f64(i % 5) + 0.5);
+        }
+        reg args[3], ret;
+        args[0].as<reg*>() = a.data();
+        args[1].as<reg*>() = b.data();
+        args[2].as<reg*>() = out.data();
+        ASSERT_EQ(x.in.execute(*x.t, f, args, {&ret, 1}), ExecResult::kReturned);
+        EXPECT_EQ(ret.as<f64>(), expect);
+        for (usize i = 0; i < n; ++i) {
+            EXPECT_EQ(out[i + 1].as<f64>(), a[i + 1].as<f64>() + b[i + 1].as<f64>());
+        }
+    }
+}
+
+TEST(ArrayKernelTest, RejectNonF64OrDynamicArray) {
+    Section s;
+    EXPECT_FALSE(ArrayKernel::emitDot(s, 3, 0, 1, 0, ArrayType{{8}, TypeToken{TypeManager::kI64}}, 8));
+    EXPECT_FALSE(ArrayKernel::emitElementwise(s, OPCode::VADDf, 2, 0, 1, 0, ArrayType{{}, TypeToken{TypeManager::kF64}},
+                                              20));
+    EXPECT_TRUE(s.code.empty());
+    EXPECT_TRUE(s.constant.empty());
+}
+
+TEST(BatchTest, VectorOpcodesRunLaneWise) {
+    Vm x;
+    // (v) -> sum of lanes of max(2 * v * v, v)
+    Section s;
+    s.info = {0, 14, 1, 1, {}};
+    s.code = {I::makeABC(O::VSPLAT, 2, 0, 0), I::makeABC(O::VMULf, 6, 2, 2), I::makeABC(O::VFMAf, 6, 2, 2),
+              I::makeABC(O::VGf, 10, 6, 2),   I::makeABC(O::VSEL, 2, 6, 10),  I::makeABC(O::VHADDf, 1, 2, 0),
+              I::makeABo(O::RET, 1, 1)};
+    auto* f = x.load(std::move(s));
+    ASSERT_TRUE(BatchInterpreter::supports(f));
+    constexpr usize kRows = 100;
+    std::vector<f64> in(kRows), out(kRows);
+    for (usize i = 0; i < kRows; ++i) {
+        in[i] = f64(i) / 64;
+    }
+    BatchInterpreter batch{&x.in};
+    BatchInput params[] = {std::span<const f64>(in)};
+    BatchOutput rets[] = {std::span<f64>(out)};
+    ASSERT_EQ(batch.run(*x.t, f, kRows, params, rets), ExecResult::kReturned);
+    for (usize i = 0; i < kRows; ++i) {
+        reg arg = std::bit_cast<reg>(in[i]), ret;
+        ASSERT_EQ(x.in.execute(*x.t, f, {&arg, 1}, {&ret, 1}), ExecResult::kReturned);
+        EXPECT_EQ(out[i], ret.as<f64>());
+    }
+}
+
+TEST(BatchTest, PointerParamIsRejected) {
+    Vm x;
+    Section s;
+    s.info = {0, 2, 1, 1, {}};
+    s.info.pointerReg.set(0);
+    s.code = {I::makeABC(O::LOADao, 1, 0, 0), I::makeABo(O::RET, 1, 1)};
+    auto* f = x.load(std::move(s));
+    std::vector<u64> in(4), out(4);
+    BatchInterpreter batch{&x.in};
+    BatchInput params[] = {std::span<const u64>(in)};
+    BatchOutput rets[] = {std::span<u64>(out)};
+    EXPECT_EQ(batch.run(*x.t, f, in.size(), params, rets), ExecResult::kBadCall);
+}
+
+TEST(BatchTest, BackEdgeStopsForGc) {
+    Vm x;
+    auto* f = x.load(makeCountdown());
+    ASSERT_TRUE(BatchInterpreter::supports(f));
+    std::vector<u64> in(kBatchLanes, 200000), out(kBatchLanes);
+    std::atomic<bool> started = false, finished = false;
+    std::thread worker([&] {
+        x.vm.globalMemory.attachMutator();
+        started.store(true);
+        BatchInterpreter batch{&x.in};
+        BatchInput params[] = {std::span<const u64>(in)};
+        BatchOutput rets[] = {std::span<u64>(out)};
+        EXPECT_EQ(batch.run(*x.t, f, in.size(), params, rets), ExecResult::kReturned);
+        finished.store(true);
+        x.vm.globalMemory.detachMutator();
+    });
+    while (!started.load()) {
+    }
+    // returns once worker parks at a back edge, not after it detached
+    ASSERT_TRUE(x.vm.globalMemory.stopMutators());
+    EXPECT_FALSE(finished.load());
+    x.vm.globalMemory.resumeMutators();
+    worker.join();
+    EXPECT_EQ(std::count(out.begin(), out.end(), 7), kBatchLanes);
+}
+
+TEST(BatchTest, FunctionHoldingPointerRunsByScalar) {
+    Vm x;
+    // () -> box of 42 unboxed, pointer only in R1
+    Section s;
+    s.info = {0, 2, 0, 1, {}};
+    s.info.pointerReg.set(1);
+    s.constant = {std::bit_cast<reg>(u64(42))};
+    s.code = {I::makeABo(O::ALLOChc, 1, 0), I::makeABC(O::LOADao, 0, 1, 0), I::makeABo(O::RET, 0, 1)};
+    auto* f = x.load(std::move(s));
+    EXPECT_FALSE(BatchInterpreter::supports(f));
+    std::vector<u64> out(3);
+    BatchInterpreter batch{&x.in};
+    BatchOutput rets[] = {std::span<u64>(out)};
+    ASSERT_EQ(batch.run(*x.t, f, out.size(), {}, rets), ExecResult::kReturned);
+    EXPECT_EQ(std::count(out.begin(), out.end(), 42), 3);
+}
+
+TEST(ExternRegistryTest, BindMatchesFullFunctionType) {
+    CodeManager cm;
+    ExternRegistry externs{&cm};
+    auto* s = externs.def<&scale>("scale");
+    auto* f = externs.def<&first>("first");
+    auto param = [](u32 t, bool ref = false) {
+        return FunctionType::FunctionParamType{TypeToken{t}, false, false, ref, false};
+    };
+    auto f64T = TypeManager::kF64, i64T = TypeManager::kI64, u64T = TypeManager::kU64;
+    EXPECT_EQ(externs.bind("scale", FunctionType{{param(f64T), param(i64T)}, TypeToken{f64T}}), s);
+    EXPECT_EQ(externs.bind("scale", FunctionType{{param(f64T), param(i64T)}, TypeToken{i64T}}), nullptr);
+    EXPECT_EQ(externs.bind("scale", FunctionType{{param(f64T), param(u64T)}, TypeToken{f64T}}), nullptr);
+    EXPECT_EQ(externs.bind("scale", FunctionType{{param(f64T)}, TypeToken{f64T}}), nullptr);
+    // held by pointer: referenced scalar or non-scalar type
+    EXPECT_EQ(externs.bind("first", FunctionType{{param(u64T, true)}, TypeToken{u64T}}), f);
+    EXPECT_EQ(externs.bind("first", FunctionType{{param(TypeManager::kAny)}, TypeToken{u64T}}), f);
+    EXPECT_EQ(externs.bind("first", FunctionType{{param(u64T)}, TypeToken{u64T}}), nullptr);
+}
@@ -1,5 +1,52 @@
-// #include <gtest/
+#include <string_view>
+#include <vector>
+
+#include <gtest/gtest.h>
 
 #include "frontend/lexer/lexer.hpp"
 
-int main() { return 0; }
\ No newline at end of file
+using namespace rulejit;
+using namespace std::literals;
+
+namespace {
+
+using Type = LexerContext::TokenType;
+
+std::vector<std::pair<std::string_view, Type>> tokenize(LexerContext& ctx) {
+    std::vector<std::pair<std::string_view, Type>> ret;
+    for (auto t = ctx.first(); t.type != Type::kEOF; t = ctx.next(t.iter)) {
+        ret.emplace_back(t.iter.token, t.type);
+        if (t.type == Type::kUnknown) {
+            break;
+        }
+    }
+    return ret;
+}
+
+}
+
+TEST(LexerTest, TokenDoesNotContainLeadingSpaceOrComment) {
+    LexerContext ctx{"  a  // comment\n  bc 12"sv};
+    auto tokens = tokenize(ctx);
+    ASSERT_EQ(tokens.size(), 3);
+    EXPECT_EQ(tokens[0].first, "a"sv);
+    EXPECT_EQ(tokens[1].first, "bc"sv);
+    EXPECT_EQ(tokens[1].second, Type::kIdentifier);
+    EXPECT_EQ(tokens[2].first, "12"sv);
+    EXPECT_EQ(tokens[2].second, Type::kInt);
+}
+
+TEST(LexerTest, CachedTokenIsReturnedOnSecondLookup) {
+    LexerContext ctx{"x  +=  3.5f"sv};
+    auto first = tokenize(ctx);
+    // second pass hits cache of every start index
+    auto second = tokenize(ctx);
+    ASSERT_EQ(first.size(), 3);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(second[1].first, "+="sv);
+    EXPECT_EQ(second[1].second, Type::kSymbol);
+    EXPECT_EQ(second[2].first, "3.5f"sv);
+    EXPECT_EQ(second[2].second, Type::kReal);
+    // token views point into source, not into copies
+    EXPECT_EQ(first[2].first.data(), second[2].first.data());
+}
@@ -0,0 +1,588 @@
+#include <algorithm>
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ir/type.hpp"
+#include "runtime/gc/mem.hpp"
+#include "tools/string_pool.hpp"
+
+using namespace rulejit;
+
+namespace {
+
+struct Heap {
+    tools::StringPool sp;
+    TypeManager tm{&sp};
+    Memory mem{&tm};
+    TypeToken boxed{TypeManager::kI64};
+    // (next, value), list node
+    TypeToken node = tm.tupleTypeOf({TypeToken{TypeManager::kAny}, TypeToken{TypeManager::kI64}});
+
+    reg* cons(reg* next, u64 value) {
+        reg* p = mem.allocHeap(node);
+        mem.writeWithBarrier(&p[0].as<reg*>(), next);
+        p[1].as<u64>() = value;
+        return p;
+    }
+
+    // promoted after surviving 5 minor GCs
+    void promote() {
+        for (int k = 0; k < 7; ++k) {
+            mem.collectMinor();
+        }
+    }
+};
+
+bool isMinor(reg* p) {
+    return helper::getHeader(p).hasFlag(ObjHeader::Flags::kIsMinorObject);
+}
+
+}
+
+class MinorGcTest : public testing::TestWithParam<usize> {};
+
+TEST_P(MinorGcTest, SurvivorIsMovedAndSlotsAreUpdated) {
+    Heap h;
+    h.mem.setGcWorkers(GetParam());
+    reg* old = h.cons(nullptr, 1);
+    h.mem.registerGcRoot(&old);
+    h.promote();
+    ASSERT_FALSE(isMinor(old));
+
+    reg* young = h.cons(nullptr, 42);
+    reg* root = young;
+    h.mem.registerGcRoot(&root);
+    // remembered slot of old object
+    h.mem.writeWithBarrier(&old[0].as<reg*>(), young);
+    for (int i = 0; i < 1000; ++i) {
+        h.cons(nullptr, u64(i));
+    }
+    ASSERT_TRUE(isMinor(young));
+    h.mem.collectMinor();
+
+    EXPECT_NE(root, young);
+    EXPECT_EQ(root[1].as<u64>(), 42);
+    EXPECT_EQ(old[0].as<reg*>(), root);
+    EXPECT_EQ(old[1].as<u64>(), 1);
+}
+
+TEST_P(MinorGcTest, ListSurvivesAndIsPromoted) {
+    Heap h;
+    h.mem.setGcWorkers(GetParam());
+    reg* head = nullptr;
+    h.mem.registerGcRoot(&head);
+    constexpr u64 n = 20000;
+    for (u64 i = 0; i < n; ++i) {
+        head = h.cons(head, i);
+        // garbage
+        h.mem.allocHeap(h.boxed);
+    }
+    h.promote();
+    u64 i = n;
+    for (reg* p = head; p != nullptr; p = p[0].as<reg*>()) {
+        ASSERT_EQ(p[1].as<u64>(), --i);
+        ASSERT_FALSE(isMinor(p));
+    }
+    EXPECT_EQ(i, 0);
+    EXPECT_GT(h.mem.majorHeapBytes(), 0);
+}
+
+TEST_P(MinorGcTest, ImmediateIsSkippedByEvacuate) {
+    Heap h;
+    h.mem.setGcWorkers(GetParam());
+    reg* young = h.cons(nullptr, 0);
+    // immediates aliasing address of a young object
+    reg* root = reinterpret_cast<reg*>(usize(young) | usize(helper::PtrTag::kNone));
+    h.mem.registerGcRoot(&root);
+    reg* holder = h.cons(nullptr, 0);
+    h.mem.registerGcRoot(&holder);
+    reg* member = reinterpret_cast<reg*>(usize(young) | 1);
+    h.mem.writeWithBarrier(&holder[0].as<reg*>(), member);
+    for (int k = 0; k < 3; ++k) {
+        h.mem.collectMinor();
+    }
+    EXPECT_EQ(root, reinterpret_cast<reg*>(usize(young) | usize(helper::PtrTag::kNone)));
+    EXPECT_EQ(holder[0].as<reg*>(), member);
+    // promoted holder keeps immediate member through major GC
+    h.promote();
+    h.mem.collectMajor();
+    EXPECT_EQ(holder[0].as<reg*>(), member);
+    EXPECT_EQ(helper::getHackedPayload(member), usize(young) >> 1);
+}
+
+INSTANTIATE_TEST_SUITE_P(Workers, MinorGcTest, testing::Values(1, 4));
+
+TEST(MajorGcTest, OverwrittenReferenceSurvivesMarking) {
+    Heap h;
+    // long list keeps marker busy for several steps, b is its last node
+    reg* head = nullptr;
+    h.mem.registerGcRoot(&head);
+    reg* black = h.cons(nullptr, 7);
+    h.mem.registerGcRoot(&black);
+    constexpr u64 kMagic = 0x5a7b;
+    head = h.cons(nullptr, kMagic);
+    for (u64 i = 0; i < 4096; ++i) {
+        head = h.cons(head, i);
+    }
+    h.promote();
+    reg* beforeB = head;
+    while (beforeB[0].as<reg*>()[0].as<reg*>() != nullptr) {
+        beforeB = beforeB[0].as<reg*>();
+    }
+    reg* b = beforeB[0].as<reg*>();
+    ASSERT_EQ(b[1].as<u64>(), kMagic);
+    ASSERT_FALSE(isMinor(b));
+    ASSERT_FALSE(isMinor(black));
+
+    h.mem.beginMajorGc();
+    // root shaded last is scanned first, list is only partly marked
+    ASSERT_FALSE(h.mem.concurrentGcStep());
+    // b moves from unscanned part of list into scanned object
+    h.mem.writeWithBarrier(&black[0].as<reg*>(), b);
+    h.mem.writeWithBarrier(&beforeB[0].as<reg*>(), nullptr);
+    b = nullptr;
+    while (!h.mem.concurrentGcStep()) {
+    }
+    h.mem.finishMajorMark();
+    while (!h.mem.concurrentGcStep()) {
+    }
+
+    // swept slot would be linked into free list through its header
+    reg* kept = black[0].as<reg*>();
+    EXPECT_EQ(helper::getHeader(kept).typeId, u32(h.node));
+    EXPECT_EQ(kept[1].as<u64>(), kMagic);
+    EXPECT_EQ(black[1].as<u64>(), 7);
+}
+
+TEST(PageTest, SweepRebuildsFreeListFromMarks) {
+    using P = Page<32>;
+    PageSpace space{PageSpace::kRegionSize};
+    MarkBitmap marks{space};
+    auto* page = P::init(space.allocPages(1, MemType::kMajor), sizeClassOf(32));
+    auto freeCount = [&] {
+        usize n = 0;
+        for (void* p = page->header().freeList; p != nullptr; p = *static_cast<void**>(p)) {
+            ++n;
+        }
+        return n;
+    };
+    ASSERT_EQ(freeCount(), P::kObjects - P::kReserved);
+
+    // live objects: first, one smaller than its slot, and last
+    std::vector<usize> live = {P::kReserved, P::kReserved + 5, P::kObjects - 1};
+    for (usize i : live) {
+        marks.mark(&page->data[i]);
+        marks.setLive(&page->data[i], i == P::kReserved + 5 ? 16 : 32);
+    }
+    EXPECT_EQ(page->sweep(marks), live.size());
+    EXPECT_EQ(page->header().live, live.size());
+    EXPECT_TRUE(page->header().swept);
+    EXPECT_EQ(freeCount(), P::kObjects - P::kReserved - live.size());
+    for (void* p = page->header().freeList; p != nullptr; p = *static_cast<void**>(p)) {
+        usize i = page->header().indexOf(p);
+        EXPECT_GE(i, P::kReserved);
+        EXPECT_EQ(std::count(live.begin(), live.end(), i), 0);
+    }
+    // bitmap is cleared for next major GC
+    EXPECT_EQ(marks.liveBytes(page, PageSize), 0);
+    EXPECT_FALSE(marks.isMarked(&page->data[live[0]]));
+
+    // nothing marked, every slot is free
+    EXPECT_EQ(page->sweep(marks), 0);
+    EXPECT_EQ(freeCount(), P::kObjects - P::kReserved);
+}
+
+TEST(PageTest, FreedSpansAreMergedWithNeighbours) {
+    PageSpace space{PageSpace::kRegionSize};
+    u8* a = space.allocPages(2, MemType::kMajor);
+    u8* b = space.allocPages(3, MemType::kHuge);
+    u8* c = space.allocPages(1, MemType::kMajor);
+    u8* end = space.allocPages(1, MemType::kMajor);
+    ASSERT_EQ(c, a + 5 * PageSize);
+    // left, then right neighbour of b is freed
+    space.freePages(b, 3);
+    space.freePages(a, 2);
+    space.freePages(c, 1);
+    u8* whole = space.allocPages(6, MemType::kHuge);
+    EXPECT_EQ(whole, a);
+    EXPECT_EQ(space.spanOf(whole + 5 * PageSize), whole);
+    // split remainder is merged back
+    space.freePages(whole, 6);
+    u8* head = space.allocPages(2, MemType::kMajor);
+    EXPECT_EQ(head, a);
+    space.freePages(head, 2);
+    EXPECT_EQ(space.allocPages(6, MemType::kMajor), a);
+    EXPECT_EQ(space.allocPages(1, MemType::kMajor), end + PageSize);
+}
+
+TEST(CompactionTest, CompactStepForwardsRememberedSlot) {
+    Heap h;
+    h.mem.setCompaction(true);
+    TypeToken any{TypeManager::kAny};
+    // other size class than boxed values, never picked with them
+    reg* holder = h.mem.allocHeap(h.tm.tupleTypeOf({any, any, any, any, any}));
+    h.mem.registerGcRoot(&holder);
+    constexpr usize n = 4096;
+    std::vector<reg*> values(n);
+    for (usize i = 0; i < n; ++i) {
+        h.mem.registerGcRoot(&values[i]);
+        values[i] = h.mem.allocHeap(h.boxed);
+        values[i][0].as<u64>() = i;
+    }
+    h.promote();
+    // values kept in 1 of 8 are only referenced by holder, pages of them become sparse
+    for (usize i = 0; i < n; ++i) {
+        if (i % 8 == 0) {
+            h.mem.writeWithBarrier(&holder[i / 8 % 5].as<reg*>(), values[i]);
+        }
+        values[i] = nullptr;
+    }
+    reg* kept[5];
+    for (usize i = 0; i < 5; ++i) {
+        kept[i] = holder[i].as<reg*>();
+        ASSERT_FALSE(isMinor(kept[i]));
+    }
+    h.mem.collectMajor();
+    // picks sparse pages by live count of last sweep, concurrent steps leave them to compactStep()
+    h.mem.beginMajorGc();
+    while (!h.mem.concurrentGcStep()) {
+    }
+    h.mem.finishMajorMark();
+    while (!h.mem.concurrentGcStep()) {
+    }
+    ASSERT_TRUE(h.mem.compactionPending());
+    while (!h.mem.compactStep()) {
+    }
+    EXPECT_FALSE(h.mem.compactionPending());
+    usize moved = 0;
+    for (usize i = 0; i < 5; ++i) {
+        reg* p = holder[i].as<reg*>();
+        moved += p != kept[i];
+        EXPECT_FALSE(helper::getHeader(p).hasFlag(ObjHeader::Flags::kIsMoved));
+        EXPECT_EQ(p[0].as<u64>() % 8, 0);
+        EXPECT_EQ(p[0].as<u64>() / 8 % 5, i);
+    }
+    EXPECT_GT(moved, 0);
+}
+
+TEST(StaticTest, MajorGcKeepsAndForwardsObjectsReferencedByStatic) {
+    Heap h;
+    h.mem.setCompaction(true);
+    TypeToken any{TypeManager::kAny};
+    // not a root, only scanned as static object
+    reg* holder = h.mem.allocStatic(h.tm.getType(h.tm.tupleTypeOf({any, any, any, any, any})).headerPrototype());
+    ASSERT_NE(holder, nullptr);
+    constexpr usize n = 4096;
+    std::vector<reg*> values(n);
+    for (usize i = 0; i < n; ++i) {
+        h.mem.registerGcRoot(&values[i]);
+        values[i] = h.mem.allocHeap(h.boxed);
+        values[i][0].as<u64>() = i;
+    }
+    h.promote();
+    for (usize i = 0; i < n; ++i) {
+        if (i % 8 == 0) {
+            h.mem.writeWithBarrier(&holder[i / 8 % 5].as<reg*>(), values[i]);
+        }
+        values[i] = nullptr;
+    }
+    reg* kept[5];
+    for (usize i = 0; i < 5; ++i) {
+        kept[i] = holder[i].as<reg*>();
+    }
+    h.mem.collectMajor();
+    h.mem.beginMajorGc();
+    while (!h.mem.concurrentGcStep()) {
+    }
+    h.mem.finishMajorMark();
+    while (!h.mem.concurrentGcStep()) {
+    }
+    while (!h.mem.compactStep()) {
+    }
+    usize moved = 0;
+    for (usize i = 0; i < 5; ++i) {
+        reg* p = holder[i].as<reg*>();
+        moved += p != kept[i];
+        EXPECT_EQ(p[0].as<u64>() % 8, 0);
+        EXPECT_EQ(p[0].as<u64>() / 8 % 5, i);
+    }
+    EXPECT_GT(moved, 0);
+    // objects swept by mistake would be promoted into again
+    for (usize i = 0; i < n; ++i) {
+        values[i] = h.mem.allocHeap(h.boxed);
+    }
+    h.promote();
+    for (usize i = 0; i < 5; ++i) {
+        EXPECT_EQ(std::count(values.begin(), values.end(), holder[i].as<reg*>()), 0);
+        EXPECT_EQ(holder[i].as<reg*>()[0].as<u64>() / 8 % 5, i);
+    }
+}
+
+TEST(ReadBarrierTest, NullSlotDuringMinorGc) {
+    Heap h;
+    reg* empty = nullptr;
+    reg* young = h.cons(nullptr, 7);
+    reg* seen = nullptr;
+    h.mem.registerGcRoot(&young);
+    // scanner runs in kMinorGC stage, before young is evacuated
+    h.mem.registerGcRootScanner([&] {
+        EXPECT_EQ(h.mem.readWithBarrier(&empty), nullptr);
+        seen = h.mem.readWithBarrier(&young);
+    });
+    h.mem.collectMinor();
+    EXPECT_NE(seen, nullptr);
+    EXPECT_EQ(young[1].as<u64>(), 7);
+}
+
+TEST(ArrayShapeTest, StaticArrayMembersAreTraced) {
+    Heap h;
+    TypeToken arr = h.tm.arrayTypeOf(TypeToken{TypeManager::kAny}, 20);
+    EXPECT_EQ(h.tm.arrayTypeOf(TypeToken{TypeManager::kAny}, 20), arr);
+    EXPECT_NE(h.tm.arrayTypeOf(TypeToken{TypeManager::kAny}, 21), arr);
+    EXPECT_EQ(h.tm.getType(arr).objSize(), 20 * sizeof(u64));
+    EXPECT_FALSE(h.tm.getType(h.tm.arrayTypeOf(TypeToken{TypeManager::kAny})).shaped);
+
+    reg* a = h.mem.allocHeap(arr);
+    h.mem.registerGcRoot(&a);
+    reg* young = h.cons(nullptr, 42);
+    // out of pointerMask, found by pointerMembers
+    h.mem.writeWithBarrier(&a[15].as<reg*>(), young);
+    h.mem.collectMinor();
+    ASSERT_NE(a[15].as<reg*>(), nullptr);
+    EXPECT_NE(a[15].as<reg*>(), young);
+    EXPECT_EQ(a[15].as<reg*>()[1].as<u64>(), 42);
+}
+
+TEST(TaggedTest, ImmediateRoundTrip) {
+    using helper::PtrTag;
+    reg* i = helper::getHackedPtr(u64(-5), PtrTag::kInt);
+    EXPECT_TRUE(helper::isImmediate(i));
+    EXPECT_EQ(helper::getTag(i), PtrTag::kInt);
+    EXPECT_EQ(i64(helper::getHackedPayload(i)), -5);
+    for (i64 v : {helper::kMinHackedInt, helper::kMaxHackedInt, i64(0)}) {
+        EXPECT_EQ(i64(helper::getHackedPayload(helper::getHackedPtr(u64(v), PtrTag::kInt))), v);
+    }
+    reg* c = helper::getHackedPtr('x', PtrTag::kChar);
+    EXPECT_EQ(helper::getTag(c), PtrTag::kChar);
+    EXPECT_EQ(helper::getHackedPayload(c), 'x');
+    reg* b = helper::getHackedPtr(1, PtrTag::kBool);
+    EXPECT_EQ(helper::getTag(b), PtrTag::kBool);
+    EXPECT_EQ(helper::getHackedPayload(b), 1);
+    EXPECT_EQ(helper::getTag(helper::getHackedPtr(0, PtrTag::kNone)), PtrTag::kNone);
+    EXPECT_FALSE(helper::isImmediate(nullptr));
+    EXPECT_EQ(helper::getTag(nullptr), PtrTag::kPointer);
+}
+
+TEST(NurseryTest, ChunksAreGrabbedFromActiveSemispace) {
+    PageSpace space{usize(64) << 20};
+    Nursery n{space, 4 * Nursery::kTlabSize};
+    ASSERT_EQ(n.capacity(), 2 * Nursery::kTlabSize);
+    reg* a = n.grab();
+    reg* b = n.grab();
+    ASSERT_NE(a, nullptr);
+    EXPECT_EQ(reinterpret_cast<u8*>(b), reinterpret_cast<u8*>(a) + Nursery::kTlabSize);
+    EXPECT_EQ(n.grab(), nullptr);
+    EXPECT_EQ(n.used(), n.capacity());
+    EXPECT_EQ(space.typeOf(a), MemType::kMinor);
+    EXPECT_TRUE(n.inActive(a));
+    EXPECT_FALSE(n.inFromSpace(a));
+
+    n.flip();
+    EXPECT_EQ(n.used(), 0);
+    EXPECT_TRUE(n.inFromSpace(a));
+    EXPECT_TRUE(n.inFromSpace(b));
+    reg* c = n.grab();
+    EXPECT_TRUE(n.inActive(c));
+    EXPECT_TRUE(n.contains(c));
+    EXPECT_EQ(reinterpret_cast<u8*>(c), reinterpret_cast<u8*>(a) + n.capacity());
+    EXPECT_FALSE(n.contains(reinterpret_cast<u8*>(a) + 2 * n.capacity()));
+}
+
+TEST(NurseryTest, ConcurrentGrabsAreDistinct) {
+    PageSpace space{usize(64) << 20};
+    Nursery n{space, 256 * Nursery::kTlabSize};
+    constexpr usize kThreads = 4;
+    std::vector<std::vector<reg*>> got(kThreads);
+    std::atomic<usize> arrived = 0;
+    std::vector<std::thread> threads;
+    for (usize i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&, i] {
+            arrived.fetch_add(1);
+            while (arrived.load() != kThreads) {
+            }
+            while (reg* p = n.grab()) {
+                got[i].push_back(p);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    std::set<reg*> all;
+    for (auto& g : got) {
+        all.insert(g.begin(), g.end());
+    }
+    EXPECT_EQ(all.size(), n.capacity() / Nursery::kTlabSize);
+    for (reg* p : all) {
+        EXPECT_EQ((reinterpret_cast<u8*>(p) - reinterpret_cast<u8*>(*all.begin())) % Nursery::kTlabSize, 0);
+        EXPECT_TRUE(n.inActive(p));
+    }
+}
+
+TEST(NurseryTest, TlabBumpsUntilFullThenRefills) {
+    Heap h;
+    Tlab t1, t2;
+    ObjHeader box{TypeManager::kU64, 1, 0, 0, 0};
+    reg* a = h.mem.allocHeap(t1, box);
+    reg* b = h.mem.allocHeap(t1, box);
+    reg* c = h.mem.allocHeap(t2, box);
+    ASSERT_NE(a, nullptr);
+    // header and one member each
+    EXPECT_EQ(b, a + 2);
+    EXPECT_GE(std::max(a, c) - std::min(a, c), isize(Nursery::kTlabSize / sizeof(reg)));
+    EXPECT_TRUE(isMinor(a));
+    EXPECT_EQ(b[0].as<u64>(), 0);
+    EXPECT_EQ(h.mem.nurseryUsed(), 2 * Nursery::kTlabSize);
+
+    // rest of the chunk of t1, then a new one
+    for (usize i = 2; i < Nursery::kTlabSize / sizeof(reg) / 2; ++i) {
+        EXPECT_EQ(h.mem.allocHeap(t1, box), a + 2 * i);
+    }
+    EXPECT_EQ(h.mem.nurseryUsed(), 2 * Nursery::kTlabSize);
+    reg* d = h.mem.allocHeap(t1, box);
+    EXPECT_NE(d, a + Nursery::kTlabSize / sizeof(reg));
+    EXPECT_EQ(h.mem.nurseryUsed(), 3 * Nursery::kTlabSize);
+
+    // full nursery fails allocation until flipped by minor GC
+    for (Tlab* t : {&t1, &t2}) {
+        while (h.mem.allocHeap(*t, box) != nullptr) {
+        }
+    }
+    EXPECT_EQ(h.mem.nurseryUsed(), Nursery::kDefaultSize / 2);
+    h.mem.collectMinor();
+    EXPECT_LT(h.mem.nurseryUsed(), 2 * Nursery::kTlabSize);
+    EXPECT_NE(h.mem.allocHeap(t1, box), nullptr);
+    EXPECT_NE(h.mem.allocHeap(t2, box), nullptr);
+}
+
+TEST(StoreBufferTest, OnlyOldToYoungSlotsAreRecorded) {
+    Heap h;
+    reg* old = h.cons(nullptr, 1);
+    h.mem.registerGcRoot(&old);
+    h.promote();
+    ASSERT_FALSE(isMinor(old));
+    reg* young[2] = {h.cons(nullptr, 10), h.cons(nullptr, 11)};
+    auto recorded = [](const StoreBuffer& sb) { return usize(sb.top - sb.block.get()); };
+
+    StoreBuffer sb;
+    // young to young, immediate, null
+    h.mem.writeWithBarrier(sb, &young[0][0].as<reg*>(), young[1]);
+    h.mem.writeWithBarrier(sb, &old[0].as<reg*>(), helper::getHackedPtr(3, helper::PtrTag::kInt));
+    h.mem.writeWithBarrier(sb, &old[0].as<reg*>(), nullptr);
+    EXPECT_EQ(sb.owner, nullptr);
+    h.mem.writeWithBarrier(sb, &old[0].as<reg*>(), young[0]);
+    EXPECT_EQ(sb.owner, &h.mem);
+    EXPECT_EQ(recorded(sb), 1);
+    // value not changed
+    h.mem.writeWithBarrier(sb, &old[0].as<reg*>(), young[0]);
+    EXPECT_EQ(recorded(sb), 1);
+    EXPECT_EQ(old[0].as<reg*>(), young[0]);
+
+    // full block is handed over, slots in it are still remembered
+    for (usize i = 1; i < StoreBuffer::kSize + 10; ++i) {
+        h.mem.writeWithBarrier(sb, &old[0].as<reg*>(), young[i % 2]);
+    }
+    EXPECT_EQ(recorded(sb), 10);
+    h.mem.collectMinor();
+    EXPECT_EQ(recorded(sb), 0);
+    reg* moved = old[0].as<reg*>();
+    EXPECT_NE(moved, young[1]);
+    EXPECT_EQ(moved[1].as<u64>(), 11);
+    EXPECT_EQ(moved[0].as<reg*>(), nullptr);
+}
+
+TEST(StoreBufferTest, SlotsOfDetachedBufferAreKept) {
+    Heap h;
+    reg* old = h.cons(nullptr, 1);
+    h.mem.registerGcRoot(&old);
+    h.promote();
+    {
+        StoreBuffer sb;
+        h.mem.writeWithBarrier(sb, &old[0].as<reg*>(), h.cons(nullptr, 42));
+    }
+    h.mem.collectMinor();
+    reg* moved = old[0].as<reg*>();
+    ASSERT_NE(moved, nullptr);
+    EXPECT_EQ(moved[1].as<u64>(), 42);
+    // survivor still in nursery stays remembered until promoted
+    for (int k = 0; k < 7; ++k) {
+        h.mem.collectMinor();
+    }
+    EXPECT_FALSE(isMinor(old[0].as<reg*>()));
+    EXPECT_EQ(old[0].as<reg*>()[1].as<u64>(), 42);
+}
+
+TEST(MarkBitmapTest, MarkAndLiveBitsOfGranules) {
+    PageSpace space{usize(64) << 20};
+    MarkBitmap bm{space};
+    constexpr usize kG = MarkBitmap::kGranule;
+    // two words of bitmap
+    constexpr usize kSpan = 2 * kG * MarkBitmap::kPerWord;
+    u8* p = space.begin() + PageSize;
+    EXPECT_FALSE(bm.mark(p));
+    EXPECT_TRUE(bm.mark(p));
+    EXPECT_TRUE(bm.isMarked(p));
+    EXPECT_FALSE(bm.isMarked(p + kG));
+    // gray object has no live byte
+    EXPECT_EQ(bm.liveBytes(p, kSpan), 0);
+
+    bm.setLive(p, 3 * kG + 1);
+    // crosses word boundary
+    bm.mark(p + 30 * kG);
+    bm.setLive(p + 30 * kG, 5 * kG);
+    EXPECT_EQ(bm.liveBytes(p, kSpan), 9 * kG);
+    EXPECT_FALSE(bm.isMarked(p + 31 * kG));
+    usize g = bm.granuleOf(p);
+    EXPECT_EQ(bm.findFree(g, g + 64), g + 4);
+    EXPECT_EQ(bm.findLive(g + 4, g + 64), g + 30);
+    EXPECT_EQ(bm.findFree(g + 30, g + 64), g + 35);
+    EXPECT_EQ(bm.findLive(g + 35, g + 64), g + 64);
+    EXPECT_EQ(bm.findLive(g + 4, g + 20), g + 20);
+
+    bm.clear(p, kSpan);
+    EXPECT_FALSE(bm.isMarked(p));
+    EXPECT_FALSE(bm.isMarked(p + 30 * kG));
+    EXPECT_EQ(bm.liveBytes(p, kSpan), 0);
+    EXPECT_EQ(bm.findFree(g, g + 64), g);
+}
+
+TEST(MarkBitmapTest, ConcurrentMarksOfOneWord) {
+    PageSpace space{usize(64) << 20};
+    MarkBitmap bm{space};
+    constexpr usize kThreads = 4;
+    u8* p = space.begin();
+    std::atomic<usize> arrived = 0, won = 0;
+    std::vector<std::thread> threads;
+    for (usize i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&] {
+            arrived.fetch_add(1);
+            while (arrived.load() != kThreads) {
+            }
+            // every thread marks all granules of one word, each granule is won once
+            for (usize k = 0; k < MarkBitmap::kPerWord; ++k) {
+                won.fetch_add(!bm.mark(p + k * MarkBitmap::kGranule));
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(won.load(), MarkBitmap::kPerWord);
+    for (usize k = 0; k < MarkBitmap::kPerWord; ++k) {
+        EXPECT_TRUE(bm.isMarked(p + k * MarkBitmap::kGranule));
+    }
+}
@@ -0,0 +1,68 @@
+#include <atomic>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "runtime/interpreter.hpp"
+#include "runtime/scheduler.hpp"
+
+using namespace rulejit;
+
+namespace {
+
+using I = Instruction;
+using O = OPCode;
+
+/**
+ * @brief builds a chain of R0 + 1 boxes in R2, then walks it back and returns the leaf value
+ * every box is young when allocated, so chain survives only if GC of other workers updates R2
+ *
+ */
+CodeManager::Section makeChain() {
+    CodeManager::Section s;
+    s.info = {0, 8, 1, 1, {}};
+    s.info.pointerReg.set(2);
+    s.constant = {std::bit_cast<reg>(u64(1))};
+    s.code = {
+        I::makeABC(O::MOV, 6, 0, 0),     I::makeABo(O::LOADc, 4, 0),      I::makeABC(O::ALLOChr, 2, 0, 0),
+        // build
+        I::makeABi(O::BEZ, 0, 3),        I::makeABC(O::ALLOChr, 2, 2, 0), I::makeABC(O::SUBu, 0, 0, 4),
+        I::makeAi(O::BR, -4),
+        // walk
+        I::makeABC(O::MOV, 7, 6, 0),     I::makeABi(O::BEZ, 7, 3),        I::makeABC(O::LOADaop, 2, 2, 0),
+        I::makeABC(O::SUBu, 7, 7, 4),    I::makeAi(O::BR, -4),
+        I::makeABC(O::LOADao, 1, 2, 0),  I::makeABo(O::RET, 1, 1),
+    };
+    return s;
+}
+
+}
+
+TEST(SchedulerTest, MinorGcOfOneWorkerStopsOthers) {
+    VM vm{};
+    CodeManager cm;
+    vm.ctx.cm = &cm;
+    vm.registerRootScanner();
+    Interpreter in{&vm.ctx, &vm.globalMemory};
+    auto f = in.load(makeChain());
+    ASSERT_TRUE(f.has_value());
+
+    constexpr usize kTasks = 32;
+    std::atomic<usize> good = 0;
+    {
+        Scheduler s{vm, 4};
+        for (usize i = 0; i < kTasks; ++i) {
+            u64 n = 100000 + i;
+            s.submit({.f = *f,
+                      .args = {std::bit_cast<reg>(n)},
+                      .done = [&good, n](ExecResult r, std::span<reg> ret) {
+                          good += r == ExecResult::kReturned && ret[0].as<u64>() == n;
+                      }});
+        }
+        s.wait();
+        EXPECT_EQ(vm.threads.size(), 4);
+    }
+    EXPECT_EQ(good.load(), kTasks);
+    // removed by exited workers
+    EXPECT_TRUE(vm.threads.empty());
+}
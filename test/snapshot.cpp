@@ -0,0 +1,299 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "runtime/ffi.hpp"
+#include "runtime/interpreter.hpp"
+#include "runtime/snapshot.hpp"
+#include "tools/string_pool.hpp"
+
+using namespace rulejit;
+
+namespace {
+
+using I = Instruction;
+using O = OPCode;
+using Section = CodeManager::Section;
+
+f64 hyp(f64 a, f64 b) {
+    return std::sqrt(a * a + b * b);
+}
+
+// offsets in Snapshot::Header
+constexpr usize kMagicAt = 0, kRelocOffsetAt = 48, kRelocCntAt = 56;
+
+std::string readFile(const std::string& path) {
+    std::ifstream in{path, std::ios::binary};
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+void writeFile(const std::string& path, const std::string& bytes) {
+    std::ofstream out{path, std::ios::binary | std::ios::trunc};
+    out.write(bytes.data(), std::streamsize(bytes.size()));
+}
+
+template <typename T>
+T peek(const std::string& bytes, usize at) {
+    T v;
+    std::memcpy(&v, bytes.data() + at, sizeof(T));
+    return v;
+}
+
+template <typename T>
+void poke(std::string& bytes, usize at, T v) {
+    std::memcpy(bytes.data() + at, &v, sizeof(T));
+}
+
+// method (self, x) -> x + 7
+Section makeAdd() {
+    Section s;
+    s.info = {0, 4, 2, 1, {}};
+    s.info.pointerReg.set(0);
+    s.constant = {std::bit_cast<reg>(u64(7))};
+    s.code = {I::makeABo(O::LOADc, 3, 0), I::makeABC(O::ADDu, 2, 1, 3), I::makeABo(O::RET, 2, 1)};
+    return s;
+}
+
+/**
+ * @brief VM with one trait impl and one extern function, the same in saving and loading process
+ *
+ */
+struct World {
+    tools::StringPool sp;
+    TypeManager tm{&sp};
+    VTableManager vtm;
+    CodeManager cm;
+    VM vm{};
+    Interpreter in{&vm.ctx, &vm.globalMemory};
+    ExternRegistry externs{&cm};
+    ThreadVM* t;
+    const Section* method;
+    TraitToken trait = tm.addTrait({{sp.take("get")}, {}});
+    ImplToken impl = tm.addImpl({TypeToken{TypeManager::kI64}, trait, {{sp.take("get"), FunctionTemplateToken{0}}}});
+
+    World() {
+        vm.ctx.cm = &cm;
+        vm.ctx.tm = &tm;
+        vm.ctx.vtm = &vtm;
+        vm.registerRootScanner();
+        t = &vm.addThread();
+        externs.def<&hyp>("hyp");
+        method = load(makeAdd());
+        vtm.resolve(impl, tm, [this](FunctionTemplateToken) { return std::bit_cast<reg>(method); });
+    }
+
+    const Section* load(Section&& s) {
+        auto r = in.load(std::move(s));
+        EXPECT_TRUE(r.has_value());
+        return r ? *r : nullptr;
+    }
+
+    // (n) -> fib(n), calls itself through function value in CONST
+    void addFib() {
+        Section s;
+        s.name = "fib";
+        s.info = {0, 8, 1, 1, {}};
+        s.constant = {std::bit_cast<reg>(u64(2)), std::bit_cast<reg>(u64(1)), reg{}};
+        s.addressSlots = {{Section::AddressSlot::Kind::kFunction, false, 2}};
+        s.code = {I::makeABo(O::LOADc, 2, 0),   I::makeABC(O::Lu, 3, 0, 2),    I::makeABi(O::BEZ, 3, 1),
+                  I::makeABo(O::RET, 0, 1),     I::makeABo(O::LOADc, 2, 1),    I::makeABo(O::LOADc, 3, 2),
+                  I::makeABC(O::SUBu, 4, 0, 2), I::makeABC(O::CALLf, 3, 1, 1), I::makeABC(O::MOV, 1, 5, 0),
+                  I::makeABC(O::SUBu, 4, 4, 2), I::makeABC(O::CALLf, 3, 1, 1), I::makeABC(O::ADDu, 1, 1, 5),
+                  I::makeABo(O::RET, 1, 1)};
+        auto* f = const_cast<Section*>(load(std::move(s)));
+        f->constant.set(2, std::bit_cast<reg>(static_cast<const Section*>(f)));
+        cm.seal(f);
+    }
+
+    // (a, b) -> hyp(a, b)
+    void addCallHyp() {
+        Section s;
+        s.name = "callHyp";
+        s.info = {0, 8, 2, 1, {}};
+        s.constant = {std::bit_cast<reg>(externs.find("hyp"))};
+        s.addressSlots = {{Section::AddressSlot::Kind::kFunction, false, 0}};
+        s.code = {I::makeABo(O::LOADc, 3, 0), I::makeABC(O::MOV, 4, 0, 0), I::makeABC(O::MOV, 5, 1, 0),
+                  I::makeABC(O::CALLf, 3, 2, 1), I::makeABo(O::RET, 6, 1)};
+        load(std::move(s));
+    }
+
+    // () -> 42 through STATIC[0] = box(box(42)), initialized before saved
+    void addStatic() {
+        Section init;
+        init.info = {0, 2, 0, 1, {}};
+        init.info.pointerReg.set(0);
+        init.info.pointerReg.set(1);
+        init.constant = {std::bit_cast<reg>(u64(42))};
+        init.code = {I::makeABo(O::ALLOChc, 1, 0), I::makeABC(O::ALLOChr, 0, 1, 0), I::makeABo(O::RET, 0, 1)};
+        Section s;
+        s.name = "readStatic";
+        s.info = {0, 3, 0, 1, {}};
+        s.info.pointerReg.set(1);
+        s.info.pointerReg.set(2);
+        s.staticVar = {reg{}};
+        s.staticInits = {{0, load(std::move(init))}};
+        s.code = {I::makeABC(O::LOADstp, 1, 0, 0), I::makeABC(O::LOADaop, 2, 1, 0), I::makeABC(O::LOADao, 0, 2, 0),
+                  I::makeABo(O::RET, 0, 1)};
+        auto* f = load(std::move(s));
+        reg ret;
+        ASSERT_EQ(in.execute(*t, f, {}, {&ret, 1}), ExecResult::kReturned);
+    }
+
+    // (self) -> get(self, 5) through VTable of impl
+    void addCaller() {
+        Section s;
+        s.name = "caller";
+        s.info = {0, 8, 1, 1, {}};
+        s.info.pointerReg.set(0);
+        s.info.pointerReg.set(3);
+        s.constant = {reg{}, std::bit_cast<reg>(u64(5))};
+        s.implSlots = {{impl, 0}};
+        s.traitCallSites = {{0, 1, 1, 0}};
+        s.code = {I::makeABo(O::LOADc, 2, 0), I::makeABC(O::MOV, 3, 0, 0), I::makeABo(O::LOADc, 4, 1),
+                  I::makeABo(O::CALLv, 2, 0), I::makeABo(O::RET, 5, 1)};
+        auto r = in.load(std::move(s), [this](FunctionTemplateToken) { return std::bit_cast<reg>(method); });
+        EXPECT_TRUE(r.has_value());
+    }
+
+    auto restore(const std::string& path) { return Snapshot::load(path, cm, vm.globalMemory, externs, &vtm); }
+
+    reg call(const SnapshotImage& image, const char* name, std::vector<reg> args) {
+        const Section* f = image.find(name);
+        EXPECT_NE(f, nullptr);
+        reg ret{};
+        if (f != nullptr) {
+            EXPECT_EQ(in.execute(*t, f, args, {&ret, 1}), ExecResult::kReturned);
+        }
+        return ret;
+    }
+};
+
+class SnapshotTest : public testing::Test {
+  protected:
+    std::string path = testing::TempDir() + "rulejit_snapshot.img";
+    std::string broken = testing::TempDir() + "rulejit_snapshot_broken.img";
+
+    void SetUp() override {
+        World w;
+        w.addFib();
+        w.addCallHyp();
+        w.addStatic();
+        w.addCaller();
+        auto r = Snapshot::save(path, w.cm, w.vm.globalMemory, Snapshot::kDefaultBase, &w.vtm);
+        ASSERT_TRUE(r.has_value()) << r.error().reason;
+    }
+    void TearDown() override {
+        std::remove(path.c_str());
+        std::remove(broken.c_str());
+    }
+
+    // load modified copy of image, it should be refused without adding any section
+    const char* refuse(const std::string& bytes) {
+        writeFile(broken, bytes);
+        World w;
+        usize before = w.cm.all().size();
+        auto r = w.restore(broken);
+        EXPECT_FALSE(r.has_value());
+        EXPECT_EQ(w.cm.all().size(), before);
+        return r ? nullptr : r.error().reason;
+    }
+};
+
+}
+
+TEST_F(SnapshotTest, RestoredCodeRunsAtAnyAddress) {
+    World first, second;
+    auto a = first.restore(path);
+    ASSERT_TRUE(a.has_value()) << a.error().reason;
+    // first mapping holds the saved base, so heap of the second one is relocated
+    auto b = second.restore(path);
+    ASSERT_TRUE(b.has_value()) << b.error().reason;
+    EXPECT_FALSE((*a)->relocated);
+    EXPECT_TRUE((*b)->relocated);
+    EXPECT_NE((*a)->heap, (*b)->heap);
+
+    for (auto* w : {&first, &second}) {
+        auto& image = w == &first ? **a : **b;
+        // objects in heap image never move
+        w->vm.globalMemory.collectMinor();
+        w->vm.globalMemory.collectMajor();
+        EXPECT_EQ(w->call(image, "fib", {std::bit_cast<reg>(u64(19))}).as<u64>(), 4181);
+        EXPECT_EQ(w->call(image, "callHyp", {std::bit_cast<reg>(3.0), std::bit_cast<reg>(4.0)}).as<f64>(), 5.0);
+        EXPECT_EQ(w->call(image, "readStatic", {}).as<u64>(), 42);
+        reg self = std::bit_cast<reg>(helper::getHackedPtr(1, helper::PtrTag::kInt));
+        EXPECT_EQ(w->call(image, "caller", {self}).as<u64>(), 12);
+
+        // function value and VTable are of this process, static points into this mapping
+        const Section* fib = image.find("fib");
+        EXPECT_EQ(std::bit_cast<const Section*>(fib->constant[2]), fib);
+        EXPECT_EQ(std::bit_cast<const Section*>(image.find("callHyp")->constant[0]), w->externs.find("hyp"));
+        EXPECT_EQ(std::bit_cast<const VTable*>(image.find("caller")->constant[0]),
+                  w->vtm.find(TypeToken{TypeManager::kI64}, w->trait));
+        auto* outer = std::bit_cast<std::byte*>(image.find("readStatic")->staticVar[0]);
+        auto* inner = std::bit_cast<std::byte*>(image.find("readStatic")->staticVar[0].as<reg*>()[0]);
+        for (auto* p : {outer, inner}) {
+            EXPECT_GE(p, image.heap);
+            EXPECT_LT(p, image.heap + image.heapSize);
+        }
+        EXPECT_TRUE(image.find("readStatic")->staticInits.empty());
+    }
+}
+
+TEST_F(SnapshotTest, ExternNotRegisteredIsRefused) {
+    CodeManager cm;
+    VM vm{};
+    ExternRegistry externs{&cm};
+    auto r = Snapshot::load(path, cm, vm.globalMemory, externs);
+    ASSERT_FALSE(r.has_value());
+    EXPECT_STREQ(r.error().reason, "extern function not registered");
+    EXPECT_TRUE(cm.all().empty());
+}
+
+TEST_F(SnapshotTest, BadMagicIsRefused) {
+    std::string bytes = readFile(path);
+    poke(bytes, kMagicAt, peek<u64>(bytes, kMagicAt) ^ 1);
+    EXPECT_STREQ(refuse(bytes), "not an image of this build");
+}
+
+TEST_F(SnapshotTest, TruncatedImageIsRefused) {
+    std::string bytes = readFile(path);
+    EXPECT_STREQ(refuse(bytes.substr(0, bytes.size() - sizeof(u64))), "corrupted image");
+    EXPECT_STREQ(refuse(bytes.substr(0, 16)), "truncated image");
+}
+
+TEST_F(SnapshotTest, RelocationOutOfHeapIsRefused) {
+    std::string bytes = readFile(path);
+    ASSERT_GT(peek<u64>(bytes, kRelocCntAt), 0);
+    u64 at = peek<u64>(bytes, kRelocOffsetAt);
+    poke(bytes, at, u64(bytes.size()) * 2);
+    EXPECT_STREQ(refuse(bytes), "corrupted image");
+    // not aligned
+    poke(bytes, at, u64(4));
+    EXPECT_STREQ(refuse(bytes), "corrupted image");
+}
+
+TEST_F(SnapshotTest, CorruptedSectionsAreRefused) {
+    std::string bytes = readFile(path);
+    std::string more = bytes;
+    // name of readStatic longer than the rest of sections
+    usize name = bytes.find("readStatic");
+    ASSERT_EQ(peek<u64>(bytes, name - sizeof(u64)), 10);
+    poke(more, name - sizeof(u64), u64(1) << 40);
+    EXPECT_STREQ(refuse(more), "corrupted image");
+
+    // code of readStatic reads register out of frame, rejected by verifying again
+    u32 load = I::makeABC(O::LOADao, 0, 2, 0).raw;
+    usize at = bytes.find(std::string(reinterpret_cast<const char*>(&load), sizeof(load)));
+    ASSERT_NE(at, std::string::npos);
+    ASSERT_EQ(bytes.find(std::string(reinterpret_cast<const char*>(&load), sizeof(load)), at + 1),
+              std::string::npos);
+    poke(bytes, at, I::makeABC(O::LOADao, 0, 200, 0).raw);
+    EXPECT_STREQ(refuse(bytes), "section of image fails verification");
+}
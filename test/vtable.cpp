@@ -0,0 +1,102 @@
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "runtime/interpreter.hpp"
+#include "tools/string_pool.hpp"
+
+using namespace rulejit;
+
+namespace {
+
+using I = Instruction;
+using O = OPCode;
+
+// method (self, x) -> x + k
+CodeManager::Section makeAdd(u64 k) {
+    CodeManager::Section s;
+    s.info = {0, 4, 2, 1, {}};
+    s.info.pointerReg.set(0);
+    s.constant = {std::bit_cast<reg>(k)};
+    s.code = {I::makeABo(O::LOADc, 3, 0), I::makeABC(O::ADDu, 2, 1, 3), I::makeABo(O::RET, 2, 1)};
+    return s;
+}
+
+struct Traits {
+    tools::StringPool sp;
+    TypeManager tm{&sp};
+    VTableManager vtm;
+    CodeManager cm;
+    VM vm{};
+    Interpreter in{&vm.ctx, &vm.globalMemory};
+    // function value of each method template
+    std::vector<const CodeManager::Section*> methods;
+    TraitToken trait = tm.addTrait({{sp.take("get")}, {}});
+
+    Traits() {
+        vm.ctx.cm = &cm;
+        vm.ctx.tm = &tm;
+        vm.ctx.vtm = &vtm;
+    }
+
+    ImplToken impl(TypeToken type, u64 k) {
+        methods.push_back(*in.load(makeAdd(k)));
+        return tm.addImpl({type, trait, {{sp.take("get"), FunctionTemplateToken{u32(methods.size() - 1)}}}});
+    }
+
+    // (self) -> get(self, 5) through VTable of i
+    const CodeManager::Section* caller(ImplToken i) {
+        CodeManager::Section s;
+        s.info = {0, 8, 1, 1, {}};
+        s.info.pointerReg.set(0);
+        s.info.pointerReg.set(3);
+        s.constant = {reg{}, std::bit_cast<reg>(u64(5))};
+        s.implSlots = {{i, 0}};
+        s.traitCallSites = {{0, 1, 1, 0}};
+        s.code = {I::makeABo(O::LOADc, 2, 0), I::makeABC(O::MOV, 3, 0, 0), I::makeABo(O::LOADc, 4, 1),
+                  I::makeABo(O::CALLv, 2, 0), I::makeABo(O::RET, 5, 1)};
+        auto r = in.load(std::move(s), [this](FunctionTemplateToken f) { return std::bit_cast<reg>(methods[f]); });
+        return r ? *r : nullptr;
+    }
+
+    u64 run(ThreadVM& t, const CodeManager::Section* f) {
+        reg self = std::bit_cast<reg>(helper::getHackedPtr(1, helper::PtrTag::kInt));
+        reg ret{};
+        EXPECT_EQ(in.execute(t, f, {&self, 1}, {&ret, 1}), ExecResult::kReturned);
+        return ret.as<u64>();
+    }
+};
+
+}
+
+TEST(VTableTest, ImplIsResolvedWhenSectionAdded) {
+    Traits x;
+    ImplToken i = x.impl(TypeToken{TypeManager::kI64}, 7);
+    auto* f = x.caller(i);
+    ASSERT_NE(f, nullptr);
+    const VTable* vt = x.vtm.find(TypeToken{TypeManager::kI64}, x.trait);
+    ASSERT_NE(vt, nullptr);
+    EXPECT_EQ(std::bit_cast<const VTable*>(f->constant[0]), vt);
+    EXPECT_EQ(std::bit_cast<const CodeManager::Section*>(vt->get(0)), x.methods[0]);
+    // the same impl shares its VTable
+    EXPECT_EQ(std::bit_cast<const VTable*>(x.caller(i)->constant[0]), vt);
+}
+
+TEST(VTableTest, CallvDispatchesAndHitsInlineCache) {
+    Traits x;
+    ImplToken a = x.impl(TypeToken{TypeManager::kI64}, 7);
+    ImplToken b = x.impl(TypeToken{TypeManager::kU64}, 100);
+    auto* fa = x.caller(a);
+    auto* fb = x.caller(b);
+    ASSERT_NE(fa, nullptr);
+    ASSERT_NE(fb, nullptr);
+    ThreadVM& t = x.vm.threads.emplace_back();
+    EXPECT_EQ(x.run(t, fa), 12);
+    EXPECT_EQ(x.run(t, fb), 105);
+
+    auto& cache = t.inlineCaches[fa->traitCallSites[0].cacheId];
+    EXPECT_EQ(cache.cachedTable, x.vtm.find(TypeToken{TypeManager::kI64}, x.trait));
+    // receiver type unchanged, target comes from cache without reading VTable
+    cache.cachedTarget = std::bit_cast<reg>(x.methods[1]);
+    EXPECT_EQ(x.run(t, fa), 105);
+}